@@ -26,18 +26,26 @@
 
 class PathFilter;
 struct reflectorStatic;
+
+namespace es {
+struct MappedFile;
+}
 class ReflectorFriend;
 
 struct MainAppConfFriend : MainAppConf {
   using MainAppConf::extractSettings;
   using MainAppConf::generateLog;
   TexelConf texelSettings;
+  uint32 logThrottle = 0;
 };
 
 extern struct MainAppConfFriend mainSettings;
 
 struct CLISettings {
   std::string out;
+  std::string trace;
+  bool incremental = false;
+  bool contentHash = false;
 };
 
 extern struct CLISettings cliSettings;
@@ -111,6 +119,9 @@ struct APPContext : APPContextCopyData {
   std::string GetClassName(pugi::xml_node node) const;
   void GetMarkdownDoc(std::ostream &out, pugi::xml_node node) const;
   int ApplySetting(std::string_view key, std::string_view value);
+  // Identifies module, its version and settings affecting outputs
+  std::string OutputFingerprint() const;
+  std::string ManifestPath() const;
 
 private:
   void *dlHandle = nullptr;
@@ -153,6 +164,12 @@ struct AppContextShare : AppContext {
   const std::vector<std::string> &SupplementalFiles() override;
   std::function<void()> forEachFile;
   std::optional<std::vector<std::string>> supplementals;
+  // Path in system's filesystem, empty for archive entries
+  std::string inputPath;
+  // Created files, collected only when set
+  std::optional<std::vector<std::string>> outputFiles;
+  // Files opened by RequestFile or FindFile, collected only when set
+  std::optional<std::vector<std::string>> requestedFiles;
 };
 
 struct ZIPExtactContext;
@@ -179,3 +196,9 @@ std::unique_ptr<ZIPIOContext> MakeZIPContext(const std::string &file,
                                              const PathFilter &pathFilter,
                                              const PathFilter &moduleFilter);
 std::unique_ptr<ZIPIOContext> MakeZIPContext(const std::string &file);
+
+// Loaded modules and mapped archives are kept for later use, 0 disables
+void SetResidentModules(size_t capacity);
+void SetResidentMounts(size_t capacity);
+// Mapping is shared with previous calls while resident and file is unchanged
+std::shared_ptr<es::MappedFile> MountFile(const std::string &path);
@@ -0,0 +1,71 @@
+/*  Spike is universal dedicated module handler
+    This source contains manifest for incremental batch
+
+    Copyright 2024 Lukas Cone
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#pragma once
+#include "spike/util/settings.hpp"
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+struct AppContextShare;
+
+struct ManifestFingerprint {
+  uint64 size = 0;
+  int64 mtime = 0;
+  // Content crc, used only in content hash mode
+  uint32 crc = 0;
+
+  bool operator==(const ManifestFingerprint &) const = default;
+};
+
+// Maps input fingerprints to produced outputs from previous runs
+// Every entry is discarded when module, its version or settings differ
+class BatchManifest {
+public:
+  BatchManifest(std::string path_, std::string moduleId_, bool contentHash_);
+
+  // Input, its requested files and all of its recorded outputs didn't change
+  // since last run
+  // Failed check removes entry, so failed inputs are never skipped
+  bool IsUpToDate(AppContextShare *ctx);
+  void Record(AppContextShare *ctx);
+  void Save();
+
+  size_t NumSkipped() const { return skipped.size(); }
+
+private:
+  struct Entry {
+    ManifestFingerprint input;
+    std::vector<std::string> outputs;
+    // Companion files opened through RequestFile or FindFile
+    std::map<std::string, ManifestFingerprint> requested;
+  };
+
+  std::string path;
+  std::string moduleId;
+  bool contentHash;
+  std::map<std::string, Entry> entries;
+  // Fingerprints computed within this run
+  std::map<std::string, ManifestFingerprint> current;
+  std::set<std::string> skipped;
+  std::mutex mutex;
+
+  ManifestFingerprint Fingerprint(const std::string &file);
+};
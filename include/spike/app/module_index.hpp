@@ -0,0 +1,67 @@
+/*  Spike is universal dedicated module handler
+    This source contains index of available modules
+
+    Copyright 2024 Lukas Cone
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#pragma once
+#include "spike/util/settings.hpp"
+#include <map>
+#include <string>
+#include <vector>
+
+struct ModuleIndexEntry {
+  // Module command
+  std::string name;
+  uint64 size = 0;
+  int64 mtime = 0;
+  uint32 contextVersion = 0;
+  // Module must be loaded to fill following members
+  bool probed = false;
+  // Module is driven by batch.json
+  bool batchControl = false;
+  std::string header;
+  std::vector<std::string> filters;
+};
+
+// Persistent info of modules inside application folder, so they don't need
+// to be loaded just to find which one accepts inputs
+// Module is loaded again only when its file changes
+class ModuleIndex {
+public:
+  ModuleIndex(const std::string &appFolder_, const std::string &appName);
+
+  // Commands of modules whose input patterns accept given file
+  // Modules without patterns or driven by batch.json are never matched
+  std::vector<std::string> Match(const std::string &filePath);
+  // Writes index only when it changed
+  void Save();
+
+  const std::map<std::string, ModuleIndexEntry> &Entries() const {
+    return entries;
+  }
+
+private:
+  std::string appFolder;
+  std::string path;
+  // Indexed by module path relative to app folder
+  std::map<std::string, ModuleIndexEntry> entries;
+  bool modified = false;
+
+  void Probe();
+};
+
+// Loads module just to fill its index entry, defined in context.cpp
+void ProbeModule(const std::string &modulePath, ModuleIndexEntry &entry);
@@ -18,8 +18,12 @@
 #pragma once
 #include "cache.hpp"
 #include "spike/app_context.hpp"
+#include "spike/crypto/murmur3.hpp"
 #include "spike/format/ZIP.hpp"
 #include "spike/io/binwritter.hpp"
+#include <atomic>
+#include <map>
+#include <mutex>
 #include <optional>
 #include <set>
 #include <sstream>
@@ -48,9 +52,18 @@ struct ZIPExtactContext : AppExtractContext {
 
   std::string prefixPath;
   std::function<void()> forEachFile;
+  // Files with same contents share single local record
+  bool deduplicate = false;
 
 private:
   friend struct ZIPMerger;
+  struct StoredFile {
+    size_t localFileOffset;
+    size_t fileDataBegin;
+    size_t size;
+    uint32 crc;
+  };
+
   BinWritter records;
   std::string outputFile;
   std::stringstream entriesStream;
@@ -63,16 +76,21 @@ private:
   std::optional<CacheGenerator> cache;
   std::vector<uint64> fileOffsets;
   std::unique_ptr<NewTexelContext> texelContext;
+  Murmur3Hash128 curFileHash;
+  std::map<Hash128, StoredFile> storedFiles;
+  // Dropped duplicates leave data behind current position
+  size_t recordsEnd = 0;
   void FinishFile(bool final = false);
+  const StoredFile *DropDuplicate();
 };
 
+// Thread safe, merged records are copied concurrently into reserved ranges
 struct ZIPMerger {
-  ZIPMerger(const std::string &outFiles, const std::string &outEntries)
-      : entries(outEntries), records(outFiles), entriesFile(outEntries),
-        outFile(outFiles) {}
+  ZIPMerger(const std::string &outFiles, const std::string &outEntries);
   ZIPMerger() = default;
   ZIPMerger(const ZIPMerger &) = delete;
   ZIPMerger(ZIPMerger &&) = delete;
+  ~ZIPMerger();
   using cache_begin_cb = void (*)();
   void Merge(ZIPExtactContext &other, const std::string &recordsFile);
   void FinishMerge(cache_begin_cb cacheBeginCB);
@@ -84,6 +102,15 @@ private:
   std::string outFile;
   size_t numEntries = 0;
   CacheGenerator cache;
+  std::mutex entriesMutex;
+  // End of reserved data ranges
+  std::atomic_size_t recordsEnd = 0;
+  // Descriptor for positional writes, -1 when records are used instead
+  int outHandle = -1;
+
+  void CopyRecords(const std::string &recordsFile, size_t offset,
+                   size_t size);
+  void CloseHandle();
 };
 
 struct IOExtractContext : AppExtractContext, BinWritter {
@@ -91,8 +118,15 @@ struct IOExtractContext : AppExtractContext, BinWritter {
   std::set<std::string> folderTree;
   std::function<void()> forEachFile;
   std::unique_ptr<NewTexelContext> texelContext;
+  std::vector<std::string> *outputFiles = nullptr;
+  // Files with same contents are reflinked or hardlinked
+  bool deduplicate = false;
+  std::string curFile;
+  size_t curFileSize = 0;
+  Murmur3Hash128 curFileHash;
 
   IOExtractContext(const std::string &outDir_) : outDir(outDir_) {}
+  ~IOExtractContext();
 
   void NewFile(const std::string &path) override;
   void SendData(std::string_view data) override;
@@ -101,4 +135,10 @@ struct IOExtractContext : AppExtractContext, BinWritter {
   void GenerateFolders() override;
   NewTexelContext *NewImage(const std::string &path,
                             NewTexelContextCreate ctx) override;
+  void FinishFile();
 };
+
+// Total size of outputs that were deduplicated
+size_t DeduplicatedBytes();
+// Forgets outputs of previous batches, they might be changed since
+void ResetDeduplication();
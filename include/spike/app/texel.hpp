@@ -5,8 +5,9 @@
 
 struct TexelConf {
   TexelContextFormat outputFormat = TexelContextFormat::DDS_Legacy;
-  bool cubemapToEquirectangular = true;
+  bool cubemapToEquirectangular = false;
   bool processMipMaps = false;
+  bool generateMipMaps = false;
   void ReflectorTag();
 };
 
@@ -17,6 +17,7 @@
 
 #pragma once
 #include "io/fileinfo.hpp"
+#include "util/scratch.hpp"
 #include <cstring>
 #include <functional>
 #include <iosfwd>
@@ -38,6 +39,8 @@ struct NewTexelContextCreate;
 struct ExtractConf {
   bool makeZIP = true;
   bool folderPerArc = true;
+  bool deduplicate = false;
+  bool deduplicateZIP = false;
   void ReflectorTag();
 };
 
@@ -57,7 +60,9 @@ protected:
 };
 
 struct AppInfo_s {
-  static constexpr uint32 CONTEXT_VERSION = 10;
+  // Covers layouts of reflectorStatic and ReflectedEnum too, modules share
+  // reflected settings with application
+  static constexpr uint32 CONTEXT_VERSION = 12;
   uint32 contextVersion = CONTEXT_VERSION;
   // No RequestFile or FindFile is being called
   bool filteredLoad = false;
@@ -336,6 +341,10 @@ struct AppContext : AppContextLocator {
 
   virtual AppExtractContext *ExtractContext(std::string_view name) = 0;
 
+  // Bump allocator of current worker thread for temporary buffers
+  // Every allocation is freed after AppProcessFile returns
+  virtual ScratchArena &Scratch() = 0;
+
   template <class C> void GetType(C &out, size_t offset = 0) {
     auto buffer = GetBuffer(sizeof(C), offset);
     memcpy(static_cast<void *>(&out), buffer.data(), buffer.size());
@@ -18,11 +18,17 @@
 #include "type/flags.hpp"
 #include "type/pointer.hpp"
 #include "util/endian.hpp"
+#include "util/settings.hpp"
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <bit>
 #include <set>
+#include <smmintrin.h>
 #include <span>
 #include <stdexcept>
+#include <unordered_map>
+#include <vector>
 
 namespace clgen {
 enum class LookupFlag : uint8 {
@@ -44,6 +50,12 @@ struct LayoutLookup {
       : version(other.version), x64(other.x64), gnuLayout(other.gnuLayout),
         flags(flags_) {}
   LayoutLookup(const LayoutLookup &other) = default;
+
+  // Packs all lookup fields into single value, used as hashing key
+  uint32 Key() const {
+    return version | (uint32(x64) << 8) | (uint32(gnuLayout) << 9) |
+           (uint32(LookupFlags::ValueType(flags)) << 16);
+  }
 };
 
 struct ClassDataHeader {
@@ -88,45 +100,169 @@ template <size_t N> struct ClassData : ClassDataHeader {
   std::array<uint16, (N / 8) + (N % 8 ? 1 : 0)> swaps;
 };
 
-template <class IType> void EndianSwap(IType &interface) {
-  size_t numItems = interface.layout->vtable.size();
+// Contiguous fields of same swap width
+struct SwapRun {
+  uint16 offset;
+  uint16 count;
+  uint8 width;
+};
+
+// Layout swap tables compiled into list of swap runs
+struct SwapProgram {
+  std::vector<SwapRun> runs;
+  uint16 stride = 0;
+  // Whole class is a single array of same width, span can be swapped as one
+  // continuous run
+  bool uniform = false;
+
+  SwapProgram() = default;
+  template <size_t N> SwapProgram(const ClassData<N> &layout) {
+    stride = layout.totalSize;
+    std::vector<SwapRun> fields;
+
+    for (size_t i = 0; i < N; ++i) {
+      const int16 offset = layout.vtable[i];
+
+      if (offset < 0) {
+        continue;
+      }
+
+      const uint16 macroTile = layout.swaps[i / 8];
+      const uint16 swapType = (macroTile >> (2 * (i % 8))) & 3;
+
+      if (swapType) {
+        fields.push_back({uint16(offset), 1, uint8(1 << swapType)});
+      }
+    }
 
-  for (size_t i = 0; i < numItems; ++i) {
-    const int16 offset = interface.m(i);
+    std::stable_sort(fields.begin(), fields.end(),
+                     [](auto &a, auto &b) { return a.offset < b.offset; });
 
-    if (offset < 0) {
-      continue;
+    for (auto &f : fields) {
+      if (!runs.empty()) {
+        SwapRun &last = runs.back();
+
+        if (last.width == f.width &&
+            last.offset + last.count * last.width == f.offset) {
+          last.count++;
+          continue;
+        }
+      }
+
+      runs.push_back(f);
     }
 
-    const size_t macro = i / 8;
-    const size_t micro = i % 8;
-    const uint16 macroTile = interface.layout->swaps.at(macro);
-    const uint16 swapType = (macroTile >> (2 * micro)) & 3;
+    uniform = runs.size() == 1 && runs.front().offset == 0 &&
+              runs.front().count * runs.front().width == stride;
+  }
 
-    switch (swapType) {
-    case 1: {
-      uint16 *data = reinterpret_cast<uint16 *>(interface.data + offset);
-      FByteswapper(*data);
-      break;
+  void Apply(char *data, size_t numItems) const {
+    if (uniform) {
+      SwapBlock(data, numItems * runs.front().count, runs.front().width);
+      return;
     }
-    case 2: {
-      uint32 *data = reinterpret_cast<uint32 *>(interface.data + offset);
-      FByteswapper(*data);
-      break;
+
+    for (size_t i = 0; i < numItems; i++, data += stride) {
+      for (auto &r : runs) {
+        SwapBlock(data + r.offset, r.count, r.width);
+      }
     }
-    case 3: {
-      uint64 *data = reinterpret_cast<uint64 *>(interface.data + offset);
-      FByteswapper(*data);
-      break;
+  }
+
+  static void SwapBlock(char *data, size_t count, uint8 width) {
+    size_t numBytes = count * width;
+    const __m128i mask = width == 2   ? _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9,
+                                                      8, 11, 10, 13, 12, 15, 14)
+                         : width == 4 ? _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11,
+                                                      10, 9, 8, 15, 14, 13, 12)
+                                      : _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15,
+                                                      14, 13, 12, 11, 10, 9, 8);
+
+    for (; numBytes >= 16; numBytes -= 16, data += 16) {
+      __m128i *item = reinterpret_cast<__m128i *>(data);
+      _mm_storeu_si128(item, _mm_shuffle_epi8(_mm_loadu_si128(item), mask));
     }
-    default:
-      break;
+
+    for (; numBytes; numBytes -= width, data += width) {
+      switch (width) {
+      case 2:
+        FByteswapper(*reinterpret_cast<uint16 *>(data));
+        break;
+      case 4:
+        FByteswapper(*reinterpret_cast<uint32 *>(data));
+        break;
+      default:
+        FByteswapper(*reinterpret_cast<uint64 *>(data));
+        break;
+      }
     }
   }
+};
+
+// Layout lookups are cached per thread and keyed on layout addresses
+// Owner of layout storage that is destroyed before program exit (unlike
+// static layout tables) must call InvalidateLayoutCaches
+std::atomic<uint32> PC_EXTERN &LayoutGeneration();
+
+inline void InvalidateLayoutCaches() {
+  LayoutGeneration().fetch_add(1, std::memory_order_relaxed);
+}
+
+// Clears thread cache when layouts were invalidated since its last use
+template <class C> void SyncLayoutCache(C &cache, uint32 &generation) {
+  if (const uint32 current =
+          LayoutGeneration().load(std::memory_order_relaxed);
+      generation != current) {
+    cache.clear();
+    generation = current;
+  }
+}
+
+// Swap program is compiled only once per layout and thread
+template <size_t N>
+const SwapProgram &GetSwapProgram(const ClassData<N> *layout) {
+  thread_local std::unordered_map<const ClassData<N> *, SwapProgram> programs;
+  thread_local uint32 generation = 0;
+  SyncLayoutCache(programs, generation);
+  auto found = programs.find(layout);
+
+  if (found == programs.end()) {
+    found = programs.emplace(layout, SwapProgram(*layout)).first;
+  }
+
+  return found->second;
+}
+
+template <class IType> void EndianSwap(IType &interface) {
+  GetSwapProgram(interface.layout).Apply(interface.data, 1);
 }
 
 template <size_t N>
 auto GetLayout(const std::set<ClassData<N>> &layouts, LayoutLookup layout) {
+  struct CacheKey {
+    const void *layouts;
+    uint32 lookup;
+
+    bool operator==(const CacheKey &) const = default;
+  };
+
+  struct CacheHash {
+    size_t operator()(const CacheKey &key) const {
+      return std::hash<const void *>{}(key.layouts) ^
+             (size_t(key.lookup) * 0x9E3779B97F4A7C15ULL);
+    }
+  };
+
+  thread_local std::unordered_map<CacheKey, const ClassData<N> *, CacheHash>
+      cache;
+  thread_local uint32 generation = 0;
+  SyncLayoutCache(cache, generation);
+  const CacheKey key{&layouts, layout.Key()};
+
+  if (auto found = cache.find(key); found != cache.end()) {
+    return found->second;
+  }
+
   auto item = std::find_if(layouts.begin(), layouts.end(),
                            [&](auto &item) { return item == layout; });
 
@@ -134,7 +270,10 @@ auto GetLayout(const std::set<ClassData<N>> &layouts, LayoutLookup layout) {
     throw std::runtime_error("Specified layout was not found!");
   }
 
-  return item.operator->();
+  const ClassData<N> *retVal = item.operator->();
+  cache.emplace(key, retVal);
+
+  return retVal;
 }
 
 template <class IType> struct Iterator : IType {
@@ -241,4 +380,13 @@ template <class Type> struct LayoutedSpan {
   Iterator<Type> end() { return dataBegin + count; }
   Type at(size_t id) { return dataBegin + id; }
 };
+
+// Swaps whole span at once with precompiled layout program
+template <class IType> void EndianSwap(LayoutedSpan<IType> &span) {
+  if (!span.count || !span.dataBegin.data) {
+    return;
+  }
+
+  GetSwapProgram(span.dataBegin.layout).Apply(span.dataBegin.data, span.count);
+}
 } // namespace clgen
@@ -0,0 +1,49 @@
+/*  MurmurHash3 x64 128 bit hasher
+
+    Copyright 2024 Lukas Cone
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#pragma once
+#include "spike/util/settings.hpp"
+#include "spike/util/supercore.hpp"
+#include <compare>
+#include <string_view>
+
+struct Hash128 {
+  uint64 low = 0;
+  uint64 high = 0;
+
+  auto operator<=>(const Hash128 &) const = default;
+};
+
+// Incremental variant, data can be fed in chunks of any size
+class Murmur3Hash128 {
+public:
+  Murmur3Hash128(uint64 seed = 0) : h1(seed), h2(seed) {}
+
+  void PC_EXTERN Update(const char *data, size_t size);
+  void Update(std::string_view data) { Update(data.data(), data.size()); }
+  Hash128 PC_EXTERN Finish() const;
+
+private:
+  uint64 h1;
+  uint64 h2;
+  uint64 totalSize = 0;
+  // Bytes that don't fill whole block yet
+  char tail[16];
+  size_t tailSize = 0;
+
+  void Block(const char *data);
+};
@@ -17,18 +17,84 @@
 
 #pragma once
 #include "encryptor.hpp"
+#include "spike/io/binreader_stream.hpp"
 #include "spike/util/supercore.hpp"
+#include <numeric>
+#include <smmintrin.h>
+#include <string>
 
 class XOREncoder : public IEncryptor {
   std::string_view key;
+  // Key repeated to lcm(key size, 16) bytes, padded by another 16 bytes
+  // to allow unaligned loads at any phase
+  std::string pattern;
+  size_t period = 0;
 
 public:
-  void Encode(char *buffer, size_t size) const {
-    for (size_t ii = 0; ii < size; ii++)
-      buffer[ii] ^= key[ii % key.size()];
+  // Encodes buffer, that starts at offset bytes from the beginning of
+  // encoded data, allows chunks to be processed separately
+  void Encode(char *buffer, size_t size, size_t offset) const {
+    if (key.empty()) {
+      return;
+    }
+
+    size_t phase = offset % period;
+    size_t ii = 0;
+
+    for (; ii + 64 <= size; ii += 64) {
+      for (size_t r = 0; r < 4; r++) {
+        __m128i *item = reinterpret_cast<__m128i *>(buffer + ii + r * 16);
+        const __m128i mask = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(pattern.data() + phase));
+        _mm_storeu_si128(item, _mm_xor_si128(_mm_loadu_si128(item), mask));
+        phase += 16;
+
+        if (phase >= period) {
+          phase -= period;
+        }
+      }
+    }
+
+    for (; ii < size; ii++) {
+      buffer[ii] ^= pattern[phase];
+
+      if (++phase == period) {
+        phase = 0;
+      }
+    }
   }
 
+  void Encode(char *buffer, size_t size) const { Encode(buffer, size, 0); }
+
   void Decode(char *buffer, size_t size) const { Encode(buffer, size); }
+  void Decode(char *buffer, size_t size, size_t offset) const {
+    Encode(buffer, size, offset);
+  }
+
+  // Reads and decodes size bytes from stream in fixed chunks
+  // lmBody(const char *data, size_t size)
+  template <class lmBody>
+  void Decode(BinReaderRef rd, size_t size, lmBody &&fc,
+              size_t offset = 0) const {
+    char buffer[0x10000];
+
+    while (size) {
+      const size_t chunkSize = std::min(size, sizeof(buffer));
+      rd.ReadBuffer(buffer, chunkSize);
+      Encode(buffer, chunkSize, offset);
+      fc(static_cast<const char *>(buffer), chunkSize);
+      size -= chunkSize;
+      offset += chunkSize;
+    }
+  }
+
+  void SetKey(std::string_view iKey) {
+    key = iKey;
+    pattern.clear();
+    period = std::lcm(key.size(), size_t(16));
 
-  void SetKey(std::string_view iKey) { key = iKey; }
+    for (size_t i = 0; i < period + 16 && !key.empty(); i++) {
+      pattern.push_back(key[i % key.size()]);
+    }
+  }
 };
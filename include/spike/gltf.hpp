@@ -21,9 +21,13 @@
 #include "io/binwritter_stream.hpp"
 #include "type/matrix44.hpp"
 #include "type/vectors_simd.hpp"
+#include "util/multi_thread.hpp"
+#include <fstream>
+#include <memory>
 #include <optional>
 #include <span>
 #include <sstream>
+#include <streambuf>
 
 using namespace fx;
 
@@ -33,16 +37,121 @@ class IndexArray;
 class PrimitiveDescriptor;
 } // namespace uni
 
+// Chunked arena for buffer view data
+// Oldest chunks are moved into temporary file, once memoryBudget is exceeded
+// Reading and seeking works for whole content, output seeked into moved
+// chunks is written through Write
+class GLTF_EXTERN GLTFStreamBuffer : public std::streambuf {
+public:
+  static constexpr size_t CHUNK_SIZE = 0x100000;
+  static constexpr size_t DEFAULT_BUDGET = 0x8000000;
+
+  explicit GLTFStreamBuffer(size_t memoryBudget_ = DEFAULT_BUDGET)
+      : memoryBudget(memoryBudget_) {}
+  GLTFStreamBuffer(const GLTFStreamBuffer &) = delete;
+  GLTFStreamBuffer(GLTFStreamBuffer &&o) { *this = std::move(o); }
+  GLTFStreamBuffer &operator=(GLTFStreamBuffer &&o);
+  ~GLTFStreamBuffer();
+
+  size_t Size() const;
+
+  // lmBody(const char *data, size_t size)
+  template <class lmBody>
+  void Read(size_t offset, size_t size, lmBody &&fc) const {
+    std::unique_ptr<char[]> scratch;
+
+    while (size) {
+      std::string_view data = Peek(offset, size, scratch);
+      fc(data.data(), data.size());
+      offset += data.size();
+      size -= data.size();
+    }
+  }
+
+  // Overwrites already written data, including spilled chunks
+  void Write(size_t offset, const char *data, size_t size);
+
+  void WriteTo(BinWritterRef wr) const {
+    Read(0, Size(), [&](const char *data, size_t size) {
+      wr.WriteBuffer(data, size);
+    });
+  }
+
+  // Copy of whole content
+  std::string ToString() const {
+    std::string retVal;
+    retVal.reserve(Size());
+    Read(0, Size(),
+         [&](const char *data, size_t size) { retVal.append(data, size); });
+    return retVal;
+  }
+
+  size_t memoryBudget;
+
+protected:
+  int_type overflow(int_type ch) override;
+  std::streamsize xsputn(const char *data, std::streamsize size) override;
+  int_type underflow() override;
+  pos_type seekoff(off_type offset, std::ios_base::seekdir dir,
+                   std::ios_base::openmode mode) override;
+  pos_type seekpos(pos_type pos, std::ios_base::openmode mode) override;
+
+private:
+  std::vector<std::unique_ptr<char[]>> chunks;
+  std::unique_ptr<std::fstream> spill;
+  std::string spillPath;
+  size_t numSpilled = 0;
+  size_t currentChunk = 0;
+  size_t size = 0;
+  // Output position inside spilled chunks, put area is empty meanwhile
+  bool putSpilled = false;
+  size_t putPosition = 0;
+  // Stream offset of eback(), get area is a copy for spilled chunks
+  size_t getBegin = 0;
+  std::unique_ptr<char[]> getScratch;
+
+  size_t Tell() const;
+  size_t ReadTell() const;
+  void SetGet(size_t position);
+  void SetChunk(size_t index, size_t offset);
+  bool NextChunk();
+  void Spill();
+  std::string_view Peek(size_t offset, size_t size,
+                        std::unique_ptr<char[]> &scratch) const;
+};
+
+// Stream of GLTFStreamBuffer
+// Keeps str() of std::stringstream, that was used before
+class GLTFStreamIO : public std::iostream {
+public:
+  explicit GLTFStreamIO(GLTFStreamBuffer *buffer) : std::iostream(buffer) {}
+
+  std::string str() const {
+    return static_cast<GLTFStreamBuffer *>(rdbuf())->ToString();
+  }
+};
+
+// Region of stream that starts with a new accessor
+struct GLTFStreamSegment {
+  size_t unpaddedBegin;
+  size_t begin;
+  size_t alignment;
+  size_t accessor;
+};
+
 struct GLTFStream : gltf::BufferView {
-  std::stringstream str;
+  GLTFStreamBuffer arena;
+  GLTFStreamIO str{&arena};
   BinWritterRef wr{str};
   size_t slot;
   size_t index;
+  std::vector<GLTFStreamSegment> segments;
   GLTFStream() = delete;
   GLTFStream(const GLTFStream &) = delete;
   GLTFStream(GLTFStream &&o)
       : gltf::BufferView{std::move(static_cast<gltf::BufferView &>(o))},
-        str{std::move(o.str)}, wr{str}, slot(o.slot), index(o.index) {}
+        arena{std::move(o.arena)}, wr{str}, slot(o.slot), index(o.index),
+        segments(std::move(o.segments)) {}
   GLTFStream &operator=(GLTFStream &&) = delete;
   GLTFStream &operator=(const GLTFStream &) = delete;
   GLTFStream(size_t slot_) : slot(slot_) {}
@@ -51,10 +160,16 @@ struct GLTFStream : gltf::BufferView {
 
 struct GLTF : gltf::Document {
   GLTF(gltf::Document &&doc) : gltf::Document(std::move(doc)) {}
+  // Loads .gltf as text, anything else as GLB with binary chunk mapped
+  explicit GLTF_EXTERN GLTF(const std::string &path);
   GLTF() { scenes.emplace_back(); }
+  GLTF(const GLTF &) = delete;
+  GLTF(GLTF &&) = default;
+  GLTF &operator=(GLTF &&) = default;
 
   GLTFStream &NewStream(const std::string &name, size_t stride = 0) {
     auto &stream = streams.emplace_back(streams.size(), stride);
+    stream.arena.memoryBudget = streamMemoryBudget;
     stream.name = name;
     stream.index = bufferViews.size();
     bufferViews.emplace_back();
@@ -76,18 +191,39 @@ struct GLTF : gltf::Document {
     }
     auto &acc = accessors.back();
     acc.bufferView = where.index;
+    const size_t unpaddedBegin = where.wr.Tell();
     where.wr.ApplyPadding(alignment);
     acc.byteOffset = where.wr.Tell() + strideOffset;
+    where.segments.push_back({unpaddedBegin, where.wr.Tell(), alignment,
+                              accessors.size() - 1});
     return std::make_pair(std::ref(acc), accessors.size() - 1);
   }
 
   void GLTF_EXTERN FinishAndSave(BinWritterRef wr, const std::string &docPath);
   void GLTF_EXTERN StripBuffers();
 
+  // Memory budget for every new stream before it spills into temp file
+  size_t streamMemoryBudget = GLTFStreamBuffer::DEFAULT_BUDGET;
+
 private:
   std::vector<GLTFStream> streams;
 };
 
+struct VertexCacheStats {
+  size_t numPrimitives = 0;
+  size_t numTriangles = 0;
+  size_t missesBefore = 0;
+  size_t missesAfter = 0;
+
+  // Average cache miss ratio, vertex transforms per triangle
+  float ACMRBefore() const {
+    return numTriangles ? float(missesBefore) / numTriangles : 0;
+  }
+  float ACMRAfter() const {
+    return numTriangles ? float(missesAfter) / numTriangles : 0;
+  }
+};
+
 struct SavedIndices {
   size_t accessorIndex;
   uint32 minIndex;
@@ -125,6 +261,53 @@ struct GLTFModel : GLTF {
   [[deprecated("Use SaveVertices")]] size_t GLTF_EXTERN
   WriteNormals16(const uni::PrimitiveDescriptor &d, size_t numVertices);
 
+  // Creates empty model with same export settings.
+  // Forks can be filled concurrently and merged back in stable order.
+  GLTFModel GLTF_EXTERN Fork() const;
+
+  // Appends fork's buffers and accessors, output is same as if
+  // fork's primitives were saved directly into this model.
+  // Forks may only write buffers, meshes, nodes and other objects created in
+  // fork must be moved out before merge, otherwise es::RuntimeError is thrown.
+  // Returns index of fork's first accessor within this model,
+  // accessor indices returned by fork must be offset by it.
+  size_t GLTF_EXTERN Merge(GLTFModel &&fork);
+
+  // Reorders triangles of every indexed triangle primitive for post transform
+  // vertex cache, then reorders vertices by first use for fetch locality.
+  // Strips are converted into lists, their old index data is left unused
+  // until StripBuffers.
+  // Vertices are remapped only when primitive's attribute accessors are not
+  // shared with other primitives and has no morph targets.
+  // Primitives are processed in parallel.
+  VertexCacheStats GLTF_EXTERN OptimizeMeshes();
+
+  // Encodes numPrimitives primitives concurrently, each into own fork,
+  // then merges forks in index order.
+  // fc(GLTFModel &fork, size_t index)
+  // Returns accessor offsets for every primitive index.
+  template <class lmBody>
+  std::vector<size_t> SaveParallel(size_t numPrimitives, lmBody &&fc) {
+    std::vector<GLTFModel> forks;
+    forks.reserve(numPrimitives);
+
+    for (size_t i = 0; i < numPrimitives; i++) {
+      forks.emplace_back(Fork());
+    }
+
+    RunThreadedQueueEx(numPrimitives,
+                       [&](size_t index) { fc(forks.at(index), index); });
+
+    std::vector<size_t> retVal;
+    retVal.reserve(numPrimitives);
+
+    for (auto &f : forks) {
+      retVal.push_back(Merge(std::move(f)));
+    }
+
+    return retVal;
+  }
+
   GLTFStream &SkinStream() {
     if (ibmStream < 0) {
       auto &newStream = NewStream("ibms");
@@ -226,13 +409,47 @@ struct StripResult {
   std::vector<Vector4A16> values;
 };
 
+// Max deviation of interpolated keys from original samples
+struct KeyframeTolerance {
+  // Distance for translation, scale and other linear tracks
+  float linear = 0.0001f;
+  // Angle in radians for rotation tracks
+  float angular = 0.0001f;
+};
+
+// Douglas-Peucker key reduction, rotations are interpolated with slerp
+StripResult GLTF_EXTERN ReduceKeys(std::span<const float> times,
+                                   std::span<const Vector4A16> values,
+                                   bool rotation,
+                                   const KeyframeTolerance &tolerance = {});
 StripResult GLTF_EXTERN StripValues(std::span<float> times, size_t upperLimit,
-                                    const uni::MotionTrack *tck);
-std::array<StripResult, 3>
-    GLTF_EXTERN StripValuesBlock(std::span<float> times, size_t upperLimit,
-                                 const uni::MotionTrack *tck);
+                                    const uni::MotionTrack *tck,
+                                    const KeyframeTolerance &tolerance = {});
+std::array<StripResult, 3> GLTF_EXTERN
+StripValuesBlock(std::span<float> times, size_t upperLimit,
+                 const uni::MotionTrack *tck,
+                 const KeyframeTolerance &tolerance = {});
+// Runs StripValues for every track in parallel
+std::vector<StripResult> GLTF_EXTERN
+StripTracks(std::span<float> times, size_t upperLimit,
+            std::span<const uni::MotionTrack *> tracks,
+            const KeyframeTolerance &tolerance = {});
 size_t GLTF_EXTERN FindTimeEndIndex(std::span<float> times, float duration);
 
+// Number of vertex transforms for triangle list with FIFO post transform cache
+size_t GLTF_EXTERN AnalyzeVertexCache(std::span<const uint32> indices,
+                                      size_t numVertices,
+                                      size_t cacheSize = 16);
+
+// Reorders triangle list for post transform vertex cache (Forsyth)
+void GLTF_EXTERN OptimizeVertexCache(std::span<uint32> indices,
+                                     size_t numVertices);
+
+// Renumbers vertices in order of first use
+// Returns remap table, where remap[oldIndex] = newIndex
+std::vector<uint32> GLTF_EXTERN OptimizeVertexFetch(std::span<uint32> indices,
+                                                    size_t numVertices);
+
 inline bool fltcmp(float f0, float f1, float epsilon = FLT_EPSILON) {
   return (f1 <= f0 + epsilon) && (f1 >= f0 - epsilon);
 }
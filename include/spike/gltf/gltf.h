@@ -9,7 +9,9 @@
 #pragma once
 #include "spike/util/detail/sc_architecture.hpp"
 #include <array>
+#include <memory>
 #include <nlohmann/json_fwd.hpp>
+#include <span>
 #include <unordered_map>
 
 #ifdef GLTF_EXPORT
@@ -206,6 +208,14 @@ namespace gltf
 
         std::vector<uint8_t> data{};
 
+        // View into Document::mappedStorage, set by LoadFromBinaryMapped instead of data
+        std::span<const uint8_t> mapped{};
+
+        FX_GLTF_NODISCARD std::span<const uint8_t> GetData() const noexcept
+        {
+            return data.empty() ? mapped : std::span<const uint8_t>(data);
+        }
+
         FX_GLTF_NODISCARD bool GLTF_EXTERN IsEmbeddedResource() const noexcept;
 
         void GLTF_EXTERN SetEmbeddedResource();
@@ -468,6 +478,9 @@ namespace gltf
         int32_t scene{ -1 };
         std::vector<std::string> extensionsUsed{};
         std::vector<std::string> extensionsRequired{};
+
+        // Keeps file mapping alive for Buffer::mapped views
+        std::shared_ptr<const void> mappedStorage{};
     };
 
     struct ReadQuotas
@@ -485,6 +498,10 @@ namespace gltf
 
     Document GLTF_EXTERN LoadFromBinary(std::string const & documentFilePath, ReadQuotas const & readQuotas = {});
 
+    // Maps GLB file and parses only JSON chunk, binary chunk is exposed via Buffer::mapped
+    // MaxFileSize and MaxBufferByteLength quotas are applied to JSON chunk only
+    Document GLTF_EXTERN LoadFromBinaryMapped(std::string const & documentFilePath, ReadQuotas const & readQuotas = {});
+
     void GLTF_EXTERN Save(Document const & document, std::ostream & output, std::string const & documentRootPath, bool useBinaryFormat);
 
     void GLTF_EXTERN Save(Document const & document, std::string const & documentFilePath, bool useBinaryFormat);
@@ -499,6 +516,8 @@ namespace gltf
 
     void GLTF_EXTERN StreamBinaryFull(Document & document, std::istream & input, size_t inputSize, std::ostream & output, const std::string & documentRootPath);
 
+    void GLTF_EXTERN StreamBinaryFull(Document & document, std::span<const uint8_t> input, std::ostream & output, const std::string & documentRootPath);
+
     FX_GLTF_NODISCARD StreamState GLTF_EXTERN StreamBinaryHeaders(Document & document, std::ostream & output, size_t inputSize);
     void GLTF_EXTERN StreamBinaryFinish(const Document & document, const StreamState & state, std::ostream & output, const std::string & documentRootPath);
     void GLTF_EXTERN to_json(nlohmann::json & json, Document const & document);
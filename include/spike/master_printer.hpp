@@ -42,6 +42,13 @@
     es::print::FlushAll();                                                     \
   }
 
+// For high frequency messages, see FlushThrottled
+#define printthrottled(...)                                                    \
+  {                                                                            \
+    es::print::Get(es::print::MPType::MSG) << __VA_ARGS__ << std::endl;        \
+    es::print::FlushThrottled();                                               \
+  }
+
 namespace es::print {
 using print_func = void (*)(const char *);
 enum class MPType { PREV, MSG, WRN, ERR, INF };
@@ -53,13 +60,24 @@ struct Queuer {
 
 using queue_func = void (*)(const Queuer &);
 
-// Calling this will lock other threads that will try to access stream until
-// FlushAll is called!
+// Returns line buffer of calling thread, no locking is involved
+// Line is sent after FlushAll is called
 std::ostream PC_EXTERN &Get(MPType type = MPType::PREV);
 void PC_EXTERN AddPrinterFunction(print_func func, bool useColor = true);
 void PC_EXTERN AddQueuer(queue_func func);
-// Unlocks other threads access to Get
+// Pushes line into ring buffer of calling thread
+// Unless async drain is enabled, line is delivered right away
 void PC_EXTERN FlushAll();
+// Same as FlushAll, but line is dropped when other throttled line was sent
+// within throttle interval. Number of dropped lines is appended to next one.
+void PC_EXTERN FlushThrottled();
+// 0 = disabled (default)
+void PC_EXTERN SetThrottleInterval(uint32 milliseconds);
+// When enabled, lines are delivered only by DrainQueues (or when ring of
+// calling thread is full). Disabling will deliver all pending lines.
+void PC_EXTERN SetAsyncDrain(bool yn);
+// Delivers pending lines of all threads into printer functions and queuers
+void PC_EXTERN DrainQueues();
 void PC_EXTERN PrintThreadID(bool yn);
 
 template <class... C> void Print(es::print::MPType type, C... args) {
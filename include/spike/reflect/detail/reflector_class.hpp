@@ -16,6 +16,7 @@
 */
 
 #pragma once
+#include "reflector_hash.hpp"
 #include "reflector_type.hpp"
 #include "spike/util/settings.hpp"
 #include <map>
@@ -175,6 +176,8 @@ struct reflectorStatic {
   const uint32 classSize;
   const JenHash baseClass{};
   const VectorMethods *vectorMethods = nullptr;
+  // Member name and alias hash lookup
+  const ReflHashTable *memberTable = nullptr;
 
   constexpr reflectorStatic(uint32 nTypes, const ReflType *types,
                             const char *const *typeNames, uint32 totalSize)
@@ -245,6 +248,37 @@ struct reflectorStatic {
         static ReflDesc typeDescs_[]{members.description...};
         typeDescs = typeDescs_;
       }
+
+      constexpr size_t maxKeys = sizeof...(C) * 2;
+      static uint16 displacements_[ReflHashTable::NumBuckets(maxKeys)];
+      static uint16 slots_[ReflHashTable::NumSlots(maxKeys)];
+      static ReflHashTable memberTable_{
+          ReflHashTable::NumBuckets(maxKeys),
+          ReflHashTable::NumSlots(maxKeys),
+          displacements_,
+          slots_,
+      };
+      uint32 keys[maxKeys];
+      uint16 indices[maxKeys];
+      size_t numKeys = 0;
+
+      for (auto &t : types_) {
+        indices[numKeys] = t.index;
+        keys[numKeys++] = t.valueNameHash.raw();
+      }
+
+      if (typeAliasHashes) {
+        for (uint16 t = 0; t < sizeof...(C); t++) {
+          if (typeAliasHashes[t].raw()) {
+            indices[numKeys] = t;
+            keys[numKeys++] = typeAliasHashes[t].raw();
+          }
+        }
+      }
+
+      if (memberTable_.Build(keys, indices, numKeys)) {
+        memberTable = &memberTable_;
+      }
     }
 
     if constexpr (constexpr REFType type = _getType<ClassType>::TYPE;
@@ -256,7 +290,8 @@ struct reflectorStatic {
   static RegistryType PC_EXTERN &Registry();
 };
 
-static_assert(sizeof(reflectorStatic) == 88);
+// Part of module ABI, any layout change must bump AppInfo_s::CONTEXT_VERSION
+static_assert(sizeof(reflectorStatic) == 96);
 
 struct ReflectedInstance {
 private:
@@ -16,6 +16,7 @@
 */
 
 #pragma once
+#include "reflector_hash.hpp"
 #include "spike/crypto/jenkinshash.hpp"
 #include "spike/util/settings.hpp"
 #include <map>
@@ -35,6 +36,8 @@ struct ReflectedEnum {
   const char *const *names;
   const uint64 *values;
   const char *const *descriptions = nullptr;
+  // Member name hash lookup
+  const ReflHashTable *nameTable = nullptr;
 
   template <class... C, size_t cs, class guard>
   ReflectedEnum(const guard *, const char (&enumName_)[cs], C... members)
@@ -55,12 +58,36 @@ struct ReflectedEnum {
       descriptions = descriptions_;
     }
 
+    if constexpr (sizeof...(C) > 0) {
+      static uint16 displacements_[ReflHashTable::NumBuckets(sizeof...(C))];
+      static uint16 slots_[ReflHashTable::NumSlots(sizeof...(C))];
+      static ReflHashTable nameTable_{
+          ReflHashTable::NumBuckets(sizeof...(C)),
+          ReflHashTable::NumSlots(sizeof...(C)),
+          displacements_,
+          slots_,
+      };
+      const uint32 keys[]{JenHash(std::string_view(members.name)).raw()...};
+      uint16 indices[sizeof...(C)];
+
+      for (uint16 i = 0; i < sizeof...(C); i++) {
+        indices[i] = i;
+      }
+
+      if (nameTable_.Build(keys, indices, sizeof...(C))) {
+        nameTable = &nameTable_;
+      }
+    }
+
     Registry()[enumHash] = this;
   }
 
   static RegistryType PC_EXTERN &Registry();
 };
 
+// Part of module ABI, any layout change must bump AppInfo_s::CONTEXT_VERSION
+static_assert(sizeof(ReflectedEnum) == 56);
+
 template <class E> const ReflectedEnum *GetReflectedEnum();
 
 #define DECL_EMEMBER(type, ...) type,
@@ -0,0 +1,63 @@
+/*  Perfect hash tables for reflected names
+
+    Copyright 2018-2024 Lukas Cone
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#pragma once
+#include "spike/type/detail/sc_type.hpp"
+#include "spike/util/settings.hpp"
+#include <algorithm>
+#include <bit>
+
+// Hash and displace perfect hash over 32 bit keys
+// Built once at registration time, lookups are O(1) and allocation free
+// Found index is only a candidate, caller must compare the key
+struct ReflHashTable {
+  uint32 numBuckets;
+  uint32 numSlots;
+  uint16 *displacements;
+  // Stored index + 1, 0 for empty slot
+  uint16 *slots;
+
+  static constexpr uint32 NumBuckets(size_t numKeys) {
+    return std::bit_ceil(std::max(numKeys, size_t(1)));
+  }
+
+  static constexpr uint32 NumSlots(size_t numKeys) {
+    return std::bit_ceil(std::max(numKeys, size_t(1)) * 2);
+  }
+
+  static constexpr uint32 Mix(uint32 x) {
+    x ^= x >> 16;
+    x *= 0x7feb352d;
+    x ^= x >> 15;
+    x *= 0x846ca68b;
+    x ^= x >> 16;
+    return x;
+  }
+
+  // Returns candidate index or -1
+  int32 Find(uint32 key) const {
+    const uint32 displacement = displacements[Mix(key) & (numBuckets - 1)];
+    const uint32 slot =
+        Mix(key ^ (displacement * 0x9e3779b9)) & (numSlots - 1);
+    return int32(slots[slot]) - 1;
+  }
+
+  // Duplicate keys are skipped, first occurrence is kept
+  // Returns false when no displacement was found for some bucket
+  bool PC_EXTERN Build(const uint32 *keys, const uint16 *indices,
+                       size_t numKeys);
+};
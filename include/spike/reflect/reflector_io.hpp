@@ -17,7 +17,9 @@
 
 #pragma once
 #include "reflector.hpp"
-#include "spike/io/bincore_fwd.hpp"
+#include "spike/io/binreader_stream.hpp"
+#include "spike/io/binwritter_stream.hpp"
+#include <span>
 
 class ReflectorBinUtil {
   friend class ReflectorBinUtilFriend;
@@ -26,4 +28,23 @@ class ReflectorBinUtil {
 public:
   static int PC_EXTERN Save(const Reflector &ri, BinWritterRef wr);
   static int PC_EXTERN Load(Reflector &ri, BinReaderRef rd);
+
+  // Output is same as calling Save for every item
+  template <class C>
+  static int SaveArray(std::span<const C> items, BinWritterRef wr) {
+    return SaveArray(GetReflectedClass<C>(), items.data(), sizeof(C),
+                     items.size(), wr);
+  }
+
+  template <class C> static int LoadArray(std::span<C> items, BinReaderRef rd) {
+    return LoadArray(GetReflectedClass<C>(), items.data(), sizeof(C),
+                     items.size(), rd);
+  }
+
+  static int PC_EXTERN SaveArray(const reflectorStatic *refl,
+                                 const void *items, size_t stride,
+                                 size_t numItems, BinWritterRef wr);
+  static int PC_EXTERN LoadArray(const reflectorStatic *refl, void *items,
+                                 size_t stride, size_t numItems,
+                                 BinReaderRef rd);
 };
@@ -1,6 +1,6 @@
 /*  Base 128 encoder (based on LEB128)
 
-    Copyright 2020-2023 Lukas Cone
+    Copyright 2020-2024 Lukas Cone
 
     Licensed under the Apache License, Version 2.0 (the "License");
     you may not use this file except in compliance with the License.
@@ -18,6 +18,8 @@
 #pragma once
 #include "spike/io/binreader_stream.hpp"
 #include "spike/io/binwritter_stream.hpp"
+#include "spike/util/settings.hpp"
+#include <span>
 
 struct bint128 {
   int64 value;
@@ -54,13 +56,19 @@ struct bint128 {
 
   void Write(BinWritterRef wr) const {
     // there shouldn't be a sign flag for values lower than
-    // -72'057'594'037'927'936
-    bool sign = value < 0 && !(~(value >> 56));
+    // -36'028'797'018'963'968, sign flag wouldn't fit into 8th byte
+    bool sign = value < 0 && !(~value >> 55);
     uint64 valueCopy = sign ? ~value : value;
     uint8 lastValue = 0;
     size_t lastIndex = 0;
 
     while (true) {
+      // 9th byte is always stored whole
+      if (lastIndex == 8) {
+        wr.Write(static_cast<uint8>(valueCopy));
+        return;
+      }
+
       lastValue = static_cast<uint8>(valueCopy);
       valueCopy >>= 7;
 
@@ -72,16 +80,12 @@ struct bint128 {
       lastIndex++;
     }
 
-    if (lastIndex < 8) {
-      auto signMask = sign ? 0x40 : 0;
-      if (lastValue & 0x40) {
-        wr.Write<uint8>(lastValue | 0x80);
-        wr.Write<uint8>(signMask);
-      } else {
-        wr.Write<uint8>(lastValue | signMask);
-      }
+    auto signMask = sign ? 0x40 : 0;
+    if (lastValue & 0x40) {
+      wr.Write<uint8>(lastValue | 0x80);
+      wr.Write<uint8>(signMask);
     } else {
-      wr.Write(lastValue);
+      wr.Write<uint8>(lastValue | signMask);
     }
   }
 };
@@ -133,3 +137,22 @@ struct buint128 {
     }
   }
 };
+
+// Largest encoded size of a single bint128 or buint128
+static constexpr size_t VARINT_MAX_SIZE = 9;
+
+// Bulk variants of buint128 (uint64) and bint128 (int64) Read
+// Decodes output.size() values, returns number of consumed bytes
+// Throws es::UnexpectedEOS for truncated input
+size_t PC_EXTERN DecodeVarints(std::span<const uint8> input,
+                               std::span<uint64> output);
+size_t PC_EXTERN DecodeVarints(std::span<const uint8> input,
+                               std::span<int64> output);
+
+// Bulk variants of buint128 and bint128 Write, output is byte identical
+// Returns number of written bytes
+// Throws es::LengthError when output is too small
+size_t PC_EXTERN EncodeVarints(std::span<const uint64> input,
+                               std::span<uint8> output);
+size_t PC_EXTERN EncodeVarints(std::span<const int64> input,
+                               std::span<uint8> output);
@@ -16,14 +16,47 @@
 */
 
 #pragma once
+#include "settings.hpp"
 #include <algorithm>
 #include <chrono>
 #include <future>
 #include <thread>
 #include <vector>
 
+// Set for threads of queues below and for batch workers
+bool PC_EXTERN &ThreadedQueueWorker();
+
+class ThreadedQueueWorkerScope {
+public:
+  ThreadedQueueWorkerScope() : previous(ThreadedQueueWorker()) {
+    ThreadedQueueWorker() = true;
+  }
+  ThreadedQueueWorkerScope(const ThreadedQueueWorkerScope &) = delete;
+  ~ThreadedQueueWorkerScope() { ThreadedQueueWorker() = previous; }
+
+private:
+  bool previous;
+};
+
 // lmBody(size_t index)
-template <class lmBody> void RunThreadedQueue(size_t numTasks, lmBody &&fc) {
+// serialInWorker: tasks run on calling thread, when it's already a worker of
+// queue or batch, so short nested tasks don't spawn threads for every worker
+template <class lmBody>
+void RunThreadedQueue(size_t numTasks, lmBody &&fc,
+                      bool serialInWorker = false) {
+  if (serialInWorker && ThreadedQueueWorker()) {
+    for (size_t i = 0; i < numTasks; i++) {
+      fc(i);
+    }
+
+    return;
+  }
+
+  auto Work = [&fc](size_t index) {
+    ThreadedQueueWorkerScope scope;
+    return fc(index);
+  };
+
   const size_t numHWThreads = std::thread::hardware_concurrency();
   const size_t numThreads = std::min(numHWThreads, numTasks);
   size_t curTask = 0;
@@ -31,7 +64,7 @@ template <class lmBody> void RunThreadedQueue(size_t numTasks, lmBody &&fc) {
   std::vector<future_type> workingThreads(numThreads);
 
   for (auto &wt : workingThreads) {
-    wt = std::async(std::launch::async, fc, curTask);
+    wt = std::async(std::launch::async, Work, curTask);
     curTask++;
   }
 
@@ -43,7 +76,7 @@ template <class lmBody> void RunThreadedQueue(size_t numTasks, lmBody &&fc) {
 
       if ((wt.wait_for(std::chrono::milliseconds(2)) ==
            std::future_status::ready)) {
-        wt = std::async(std::launch::async, fc, curTask);
+        wt = std::async(std::launch::async, Work, curTask);
         curTask++;
       }
     }
@@ -55,13 +88,26 @@ template <class lmBody> void RunThreadedQueue(size_t numTasks, lmBody &&fc) {
 }
 
 // lmBody(size_t index)
-template <class lmBody> void RunThreadedQueueEx(size_t numTasks, lmBody &&fc) {
+// serialInWorker: same as for RunThreadedQueue
+template <class lmBody>
+void RunThreadedQueueEx(size_t numTasks, lmBody &&fc,
+                        bool serialInWorker = false) {
+  if (serialInWorker && ThreadedQueueWorker()) {
+    for (size_t i = 0; i < numTasks; i++) {
+      fc(i);
+    }
+
+    return;
+  }
+
   const size_t numHWThreads = std::thread::hardware_concurrency();
   const size_t numThreads = std::min(numHWThreads, numTasks);
   size_t curTask = 0;
   std::vector<std::pair<std::future<void>, std::thread>> threads(numThreads);
 
   auto Invoke = [&](size_t index, std::promise<void> &&state) {
+    ThreadedQueueWorkerScope scope;
+
     try {
       fc(index);
     } catch (...) {
@@ -0,0 +1,111 @@
+/*  Resettable bump allocator for temporary buffers
+
+    Copyright 2024 Lukas Cone
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#pragma once
+#include "settings.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+// Memory is never freed per allocation, only by Rewind or Reset
+// Not thread safe, every worker thread has its own ThreadScratch
+class ScratchArena {
+public:
+  // Position of arena, allocations made after Mark are freed by Rewind
+  struct Marker {
+    size_t block;
+    size_t offset;
+  };
+
+  ScratchArena() = default;
+  ScratchArena(const ScratchArena &) = delete;
+  ScratchArena &operator=(const ScratchArena &) = delete;
+
+  void *Allocate(size_t size, size_t alignment) {
+    if (current < blocks.size()) {
+      Block &block = blocks[current];
+      const size_t begin = AlignedOffset(block.data.get(), offset, alignment);
+
+      if (begin + size <= block.size) {
+        offset = begin + size;
+        return block.data.get() + begin;
+      }
+    }
+
+    return AllocateSlow(size, alignment);
+  }
+
+  // Items are default initialized
+  template <class T> std::span<T> Allocate(size_t numItems) {
+    static_assert(std::is_trivially_destructible_v<T>,
+                  "Destructors are never called for scratch items");
+    T *items = static_cast<T *>(Allocate(sizeof(T) * numItems, alignof(T)));
+    std::uninitialized_default_construct_n(items, numItems);
+    return {items, numItems};
+  }
+
+  template <class T> std::span<T> Allocate(size_t numItems, const T &value) {
+    std::span<T> items = Allocate<T>(numItems);
+    std::fill(items.begin(), items.end(), value);
+    return items;
+  }
+
+  Marker Mark() const { return {current, offset}; }
+  void Rewind(Marker marker) {
+    current = marker.block;
+    offset = marker.offset;
+  }
+
+  // Frees every allocation, blocks are joined into single one
+  void PC_EXTERN Reset();
+
+private:
+  struct Block {
+    std::unique_ptr<char[]> data;
+    size_t size;
+  };
+
+  static size_t AlignedOffset(const char *data, size_t offset,
+                              size_t alignment) {
+    const uintptr_t address = reinterpret_cast<uintptr_t>(data) + offset;
+    return offset + (-address & (alignment - 1));
+  }
+
+  std::vector<Block> blocks;
+  size_t current = 0;
+  size_t offset = 0;
+
+  void PC_EXTERN *AllocateSlow(size_t size, size_t alignment);
+};
+
+// Allocations made within scope are freed at its end
+class ScratchScope {
+public:
+  ScratchScope(ScratchArena &arena_) : arena(arena_), marker(arena_.Mark()) {}
+  ScratchScope(const ScratchScope &) = delete;
+  ~ScratchScope() { arena.Rewind(marker); }
+
+private:
+  ScratchArena &arena;
+  ScratchArena::Marker marker;
+};
+
+// Arena of calling thread
+ScratchArena PC_EXTERN &ThreadScratch();
@@ -0,0 +1,53 @@
+/*  Scoped zone tracing with Chrome trace export
+
+    Copyright 2024 Lukas Cone
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#pragma once
+#include "macroLoop.hpp"
+#include "settings.hpp"
+#include <iosfwd>
+
+// name must be a string literal, zone lasts until end of current scope
+#define TRACE_ZONE(name)                                                       \
+  es::trace::Zone _LOOPER_CAT2(traceZone_, __LINE__) { name }
+
+namespace es::trace {
+// Disabled by default, zones are not recorded while disabled
+void PC_EXTERN Enable(bool yn);
+bool PC_EXTERN IsEnabled();
+// Monotonic clock in nanoseconds
+uint64 PC_EXTERN Now();
+// Appends zone into thread local buffer
+void PC_EXTERN Record(const char *name, uint64 begin, uint64 end);
+// Following must be called after traced threads finished their work
+// Writes Chrome/Perfetto trace event JSON
+void PC_EXTERN WriteChromeTrace(std::ostream &str);
+// Prints count, total, mean and max time per zone name
+void PC_EXTERN PrintSummary();
+
+struct Zone {
+  const char *name;
+  uint64 begin;
+
+  Zone(const char *name_) : name(name_), begin(IsEnabled() ? Now() : 0) {}
+  Zone(const Zone &) = delete;
+  ~Zone() {
+    if (begin) {
+      Record(name, begin, Now());
+    }
+  }
+};
+} // namespace es::trace
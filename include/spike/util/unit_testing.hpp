@@ -19,8 +19,15 @@
 #include "macroLoop.hpp"
 #include "spike/master_printer.hpp"
 #include "supercore.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
 #include <ostream>
+#include <string>
 #include <type_traits>
+#include <vector>
 #pragma GCC diagnostic ignored "-Wsign-compare"
 
 #define _CHECK_FAILED_TMP(...)                                                 \
@@ -147,3 +154,150 @@ void PrintCheckFailed(const A &aVal, const B &bVal, const char *aName,
                                << " out of " << VA_NARGS(__VA_ARGS__)          \
                                << " successed.");                              \
   resultVar = _tstVal
+
+// Measures repeated execution of body
+// bytes: number of bytes processed by single execution, 0 = no throughput
+#define TEST_BENCH(name, bytes, ...) es::RunBench(name, bytes, [&] __VA_ARGS__)
+
+namespace es {
+#if defined(__GNUC__) || defined(__clang__)
+template <class C> void DoNotOptimize(const C &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline void ClobberMemory() { asm volatile("" : : : "memory"); }
+#else
+template <class C> void DoNotOptimize(const C &value) {
+  const volatile char *sink = reinterpret_cast<const volatile char *>(&value);
+  (void)*sink;
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+}
+
+inline void ClobberMemory() {
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+}
+#endif
+
+struct BenchResult {
+  std::string name;
+  size_t iterations;
+  double minNs;
+  double medianNs;
+  double p99Ns;
+  size_t bytesPerIteration;
+
+  double MBPerSecond() const {
+    return bytesPerIteration ? bytesPerIteration / medianNs * 1e9 / 0x100000
+                             : 0;
+  }
+};
+
+inline std::vector<BenchResult> &BenchResults() {
+  static std::vector<BenchResult> results;
+  return results;
+}
+
+// Measuring time per benchmark, SPIKE_BENCH_TIME env overrides it
+inline size_t BenchTimeMS() {
+  static const size_t time = [] {
+    const char *env = std::getenv("SPIKE_BENCH_TIME");
+    return env ? std::strtoull(env, nullptr, 10) : 500;
+  }();
+  return time;
+}
+
+template <class fc>
+const BenchResult &RunBench(const char *name, size_t bytesPerIteration,
+                            fc &&body) {
+  using clock = std::chrono::steady_clock;
+  auto Measure = [&](size_t count) {
+    auto begin = clock::now();
+
+    for (size_t i = 0; i < count; i++) {
+      body();
+      ClobberMemory();
+    }
+
+    return std::chrono::duration<double, std::nano>(clock::now() - begin)
+        .count();
+  };
+
+  const double budgetNs = BenchTimeMS() * 1e6;
+  const double minBatchNs = std::max(budgetNs / 100, 1e4);
+  size_t batchSize = 1;
+
+  // Warmup, also scales batch size so clock resolution doesn't matter
+  while (Measure(batchSize) < minBatchNs && batchSize < (size_t(1) << 30)) {
+    batchSize *= 2;
+  }
+
+  std::vector<double> samples;
+  double totalNs = 0;
+
+  while ((totalNs < budgetNs || samples.size() < 10) &&
+         samples.size() < 10000) {
+    const double batchNs = Measure(batchSize);
+    totalNs += batchNs;
+    samples.push_back(batchNs / batchSize);
+  }
+
+  std::sort(samples.begin(), samples.end());
+
+  BenchResult result{
+      name,
+      samples.size() * batchSize,
+      samples.front(),
+      samples[samples.size() / 2],
+      samples[std::min(samples.size() - 1, samples.size() * 99 / 100)],
+      bytesPerIteration,
+  };
+
+  char buffer[256];
+  snprintf(buffer, sizeof(buffer),
+           "%-40s min %12.1f ns, median %12.1f ns, p99 %12.1f ns", name,
+           result.minNs, result.medianNs, result.p99Ns);
+
+  if (bytesPerIteration) {
+    printline(buffer << ", " << result.MBPerSecond() << " MB/s");
+  } else {
+    printline(buffer);
+  }
+
+  BenchResults().emplace_back(std::move(result));
+
+  return BenchResults().back();
+}
+
+// Writes all results as JSON, keys and order are stable between runs
+inline void WriteBenchResults(std::ostream &str) {
+  str << "{\"benchmarks\":[";
+  bool first = true;
+
+  for (auto &r : BenchResults()) {
+    if (!first) {
+      str << ',';
+    }
+
+    first = false;
+    str << "\n{\"name\":\"";
+
+    for (char c : r.name) {
+      if (c == '"' || c == '\\') {
+        str << '\\';
+      }
+
+      str << c;
+    }
+
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer),
+             "\",\"iterations\":%zu,\"min_ns\":%.3f,\"median_ns\":%.3f,"
+             "\"p99_ns\":%.3f,\"bytes_per_iteration\":%zu,\"mb_per_s\":%.3f}",
+             r.iterations, r.minNs, r.medianNs, r.p99Ns, r.bytesPerIteration,
+             r.MBPerSecond());
+    str << buffer;
+  }
+
+  str << "\n]}\n";
+}
+} // namespace es
@@ -4,6 +4,8 @@
 #include "spike/io/binreader.hpp"
 #include "spike/io/stat.hpp"
 #include "spike/master_printer.hpp"
+#include "spike/util/multi_thread.hpp"
+#include "spike/util/trace.hpp"
 #include <cinttypes>
 #include <deque>
 #include <future>
@@ -100,6 +102,8 @@ struct MultiThreadManagerImpl {
 };
 
 void WorkerThread::operator()() {
+  ThreadedQueueWorkerScope workerScope;
+
   while (true) {
     {
       auto item = manager.Pop();
@@ -110,6 +114,8 @@ void WorkerThread::operator()() {
         break;
       }
 
+      TRACE_ZONE("Batch::WorkerItem");
+
       if constexpr (CATCH_EXCEPTIONS) {
         item();
 
@@ -231,6 +237,7 @@ void Batch::AddBatch(nlohmann::json &batch, const std::string &batchPath) {
 }
 
 void Batch::AddFile(std::string path) {
+  TRACE_ZONE("Batch::AddFile");
   auto type = FileType(path);
   switch (type) {
   case FileType_e::Directory: {
@@ -242,7 +249,10 @@ void Batch::AddFile(std::string path) {
       barData->Update(numFolders, numFiles, foundFiles);
     };
     scanner.Clear();
-    scanner.Scan(path);
+    {
+      TRACE_ZONE("Batch::ScanDirectory");
+      scanner.Scan(path);
+    }
     scanBar->Finish();
     if (keepFinishLines) {
       ReleaseLogLines(scanBar);
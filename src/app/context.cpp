@@ -16,14 +16,19 @@
 */
 
 #include "spike/app/context.hpp"
+#include "spike/app/module_index.hpp"
+#include "spike/crypto/crc32.hpp"
+#include "spike/io/binreader.hpp"
 #include "spike/io/binwritter.hpp"
 #include "spike/io/directory_scanner.hpp"
 #include "spike/master_printer.hpp"
+#include "spike/reflect/reflector_io.hpp"
 #include "spike/reflect/reflector_xml.hpp"
 #include "spike/type/tchar.hpp"
 #include "spike/util/pugiex.hpp"
 #include <algorithm>
 #include <chrono>
+#include <list>
 #include <sstream>
 #include <thread>
 
@@ -57,6 +62,83 @@ auto dlerror() {
 MainAppConfFriend mainSettings{};
 CLISettings cliSettings{};
 
+class ReflectorFriend : public Reflector {
+public:
+  using Reflector::GetReflectedInstance;
+};
+
+static void *OpenModule(const std::string &modulePath) {
+#if defined(_MSC_VER) || defined(__MINGW64__)
+  auto modPath = ToTSTRING(modulePath);
+  return LoadLibrary(modPath.data());
+#else
+  return dlopen(modulePath.data(), RTLD_NOW);
+#endif
+}
+
+void ProbeModule(const std::string &modulePath, ModuleIndexEntry &entry) {
+  void *handle = OpenModule(modulePath);
+
+  if (!handle) {
+    throw std::runtime_error(std::string("Cannot open module: ") + dlerror());
+  }
+
+  auto InitModule = reinterpret_cast<decltype(AppInitModule) *>(
+      dlsym(handle, "AppInitModule"));
+
+  if (!InitModule) {
+    dlclose(handle);
+    throw std::runtime_error("Module has no AppInitModule");
+  }
+
+  const AppInfo_s *info = InitModule();
+  entry.contextVersion = info->contextVersion;
+
+  // Layout of info differs in other versions
+  if (entry.contextVersion == AppInfo_s::CONTEXT_VERSION) {
+    entry.batchControl = !info->batchControlFilters.empty();
+    entry.header = info->header;
+    entry.filters.assign(info->filters.begin(), info->filters.end());
+  }
+
+  dlclose(handle);
+}
+
+struct ResidentModule {
+  std::string name;
+  std::string path;
+  // Extra reference, module stays loaded between contexts
+  void *dlHandle;
+  // Module settings right after first load
+  std::string defaultSettings;
+};
+
+// Most recently used first
+static std::list<ResidentModule> residentModules;
+static size_t residentModulesCapacity = 0;
+
+void SetResidentModules(size_t capacity) {
+  residentModulesCapacity = capacity;
+
+  while (residentModules.size() > capacity) {
+    dlclose(residentModules.back().dlHandle);
+    residentModules.pop_back();
+  }
+}
+
+static ResidentModule *FindResidentModule(std::string_view moduleName) {
+  auto found = std::find_if(
+      residentModules.begin(), residentModules.end(),
+      [&](const ResidentModule &item) { return item.name == moduleName; });
+
+  if (found == residentModules.end()) {
+    return nullptr;
+  }
+
+  residentModules.splice(residentModules.begin(), residentModules, found);
+  return &residentModules.front();
+}
+
 // NOTE: ReflDesc flags, used for guis and logs
 // MAX:n - Maximum number limit (numbers only)
 // MIN:n - Minimum number limit (numbers only)
@@ -74,10 +156,25 @@ REFLECT(CLASS(MainAppConfFriend),
                ReflDesc{"Prints more information per level.", "MAX:3"}),
         MEMBERNAME(extractSettings, "extract-settings"),
         MEMBERNAME(compressSettings, "compress-settings"),
-        MEMBERNAME(texelSettings, "texel-settings"))
+        MEMBERNAME(texelSettings, "texel-settings"),
+        MEMBERNAME(logThrottle, "log-throttle",
+                   ReflDesc{"Minimum interval in milliseconds between per file "
+                            "messages, skipped messages are counted. 0 = print "
+                            "all."}))
 
 REFLECT(CLASS(CLISettings),
-        MEMBER(out, ReflDesc{"Output folder for processed files", "FOLDER"}))
+        MEMBER(out, ReflDesc{"Output folder for processed files", "FOLDER"}),
+        MEMBER(trace, ReflDesc{"Write Chrome trace of processing stages into "
+                               "specified file and print timing summary at "
+                               "exit."}),
+        MEMBER(incremental,
+               ReflDesc{"Skip inputs that didn't change since previous run "
+                        "and whose outputs still exist. State is kept in "
+                        "manifest file inside output folder or application "
+                        "location."}),
+        MEMBERNAME(contentHash, "content-hash",
+                   ReflDesc{"Incremental mode compares input contents instead "
+                            "of modification times."}))
 
 REFLECT(
     CLASS(ExtractConf),
@@ -88,7 +185,14 @@ REFLECT(
             "output dir."}),
     MEMBERNAME(makeZIP, "create-zip", "Z",
                ReflDesc{"Pack extracted files inside ZIP file named after "
-                        "input archive. Your HDD will thank you."}), )
+                        "input archive. Your HDD will thank you."}),
+    MEMBER(deduplicate,
+           ReflDesc{"Store files with identical contents only once. Folder "
+                    "outputs are reflinked or hardlinked."}),
+    MEMBERNAME(deduplicateZIP, "deduplicate-zip",
+               ReflDesc{"Store files with identical contents only once inside "
+                        "ZIP, entries share single local record. Some ZIP "
+                        "tools reject such archives."}), )
 
 REFLECT(
     CLASS(CompressConf),
@@ -142,7 +246,10 @@ REFLECT(CLASS(TexelConf),
         MEMBERNAME(cubemapToEquirectangular, "single-cube",
                    ReflDesc{"Convert cubemaps into equirectangular layout"}),
         MEMBERNAME(processMipMaps, "process-mipmaps",
-                   ReflDesc{"Save only largest mipmap for each mipmap chain"}))
+                   ReflDesc{"Save only largest mipmap for each mipmap chain"}),
+        MEMBERNAME(generateMipMaps, "generate-mipmaps",
+                   ReflDesc{"Generate missing mipmap chain for uncompressed "
+                            "DDS outputs, requires process-mipmaps"}))
 
 struct ReflectedInstanceFriend : ReflectedInstance {
   const reflectorStatic *Refl() const { return rfStatic; }
@@ -173,8 +280,13 @@ APPContext::APPContext(const char *moduleName_, const std::string &appFolder_,
                        const std::string &appName_)
     : appFolder(appFolder_), appName(appName_) {
   moduleName = moduleName_;
+  ResidentModule *resident = FindResidentModule(moduleName);
 
   auto modulePath = [&] {
+    if (resident) {
+      return resident->path;
+    }
+
     DirectoryScanner esmScan;
     esmScan.AddFilter((std::string(1, '^') + moduleName) + "*.spk$");
     esmScan.Scan(appFolder);
@@ -259,12 +371,8 @@ APPContext::APPContext(const char *moduleName_, const std::string &appFolder_,
     printinfo("Module open: " << modulePath);
   }
 
-#if defined(_MSC_VER) || defined(__MINGW64__)
-  auto modPath = ToTSTRING(modulePath);
-  dlHandle = LoadLibrary(modPath.data());
-#else
-  dlHandle = dlopen(modulePath.data(), RTLD_NOW);
-#endif
+  dlHandle = OpenModule(modulePath);
+
   if (!dlHandle) {
     postError();
   }
@@ -280,6 +388,22 @@ APPContext::APPContext(const char *moduleName_, const std::string &appFolder_,
 
   info_->internalSettings = &mainSettings;
 
+  if (resident && info->settings) {
+    // Module was never unloaded, drop settings of previous context
+    std::stringstream str(resident->defaultSettings);
+    ReflectorBinUtil::Load(*info->settings, BinReaderRef(str));
+  } else if (!resident && residentModulesCapacity) {
+    std::stringstream str;
+
+    if (info->settings) {
+      ReflectorBinUtil::Save(*info->settings, BinWritterRef(str));
+    }
+
+    residentModules.push_front(
+        {moduleName, modulePath, OpenModule(modulePath), std::move(str).str()});
+    SetResidentModules(residentModulesCapacity);
+  }
+
   tryAssign(AdditionalHelp, "AppAdditionalHelp");
   tryAssign(InitContext, "AppInitContext");
   tryAssign(FinishContext, "AppFinishContext");
@@ -320,11 +444,6 @@ APPContext::~APPContext() {
   }
 }
 
-class ReflectorFriend : public Reflector {
-public:
-  using Reflector::GetReflectedInstance;
-};
-
 class ReflectorMemberFriend : public ReflectorMember {
 public:
   using ReflectorMember::operator=;
@@ -421,6 +540,45 @@ int APPContext::ApplySetting(std::string_view key, std::string_view value) {
   }
 }
 
+std::string APPContext::OutputFingerprint() const {
+  std::stringstream str;
+  BinWritterRef wr(str);
+  const ReflectorFriend *settings[]{
+      info->settings,
+      &TexelSettings(),
+      &ExtractSettings(),
+      &CompressSettings(),
+  };
+
+  for (auto s : settings) {
+    if (s) {
+      ReflectorBinUtil::Save(*s, wr);
+    }
+  }
+
+  const std::string buffer = str.str();
+  char settingsHash[16];
+  snprintf(settingsHash, sizeof(settingsHash), "%08X",
+           crc32b(0, buffer.data(), buffer.size()));
+
+  return std::string(moduleName) + ' ' + std::string(info->header) + ' ' +
+         settingsHash;
+}
+
+std::string APPContext::ManifestPath() const {
+  if (!cliSettings.out.empty()) {
+    std::string retVal = cliSettings.out;
+
+    if (retVal.back() != '/') {
+      retVal.push_back('/');
+    }
+
+    return retVal + ".spike_" + moduleName + ".manifest";
+  }
+
+  return appFolder + appName + '_' + moduleName + ".manifest";
+}
+
 void APPContext::PrintCLIHelp() const {
   printline("Options:" << std::endl);
 
@@ -612,6 +770,8 @@ void APPContext::GetMarkdownDoc(std::ostream &out, pugi::xml_node node) const {
 }
 
 void APPContext::SetupModule() {
+  es::print::SetThrottleInterval(mainSettings.logThrottle);
+
   if (mainSettings.generateLog) {
     es::print::PrintThreadID(true);
     CreateLog();
@@ -27,6 +27,8 @@
 #include "spike/io/fileinfo.hpp"
 #include "spike/io/stat.hpp"
 #include "spike/master_printer.hpp"
+#include "spike/util/trace.hpp"
+#include <filesystem>
 #include <list>
 #include <mutex>
 #include <optional>
@@ -129,6 +131,10 @@ struct AppContextShareImpl : AppContextShare {
       outFile = BinWritter(filePath);
     }
 
+    if (outputFiles) {
+      outputFiles->push_back(filePath);
+    }
+
     if (forEachFile) {
       forEachFile();
     }
@@ -155,6 +161,8 @@ struct AppContextShareImpl : AppContextShare {
 
   JenHash Hash() override { return JenHash(FullPath()); }
 
+  ScratchArena &Scratch() override { return ThreadScratch(); }
+
   std::string FullPath() override {
     return std::string(basePath.GetFullPath()) +
            std::string(workingFile.GetFullPath());
@@ -178,6 +186,7 @@ struct SimpleIOContext : AppContextShareImpl {
                   std::optional<std::vector<std::string>> supplementals_) {
     mainFile.Open(path);
     workingFile.Load(path);
+    inputPath = path;
     supplementals = std::move(supplementals_);
 
     if (!cliSettings.out.empty()) {
@@ -212,8 +221,13 @@ struct SimpleIOContext : AppContextShareImpl {
 
       outPath.append(".zip");
 
+      if (outputFiles) {
+        outputFiles->push_back(outPath);
+      }
+
       auto uniq = std::make_unique<ZIPExtactContext>(outPath);
       uniq->forEachFile = forEachFile;
+      uniq->deduplicate = mainSettings.extractSettings.deduplicateZIP;
       ectx = std::move(uniq);
     } else {
       if (!mainSettings.extractSettings.folderPerArc) {
@@ -225,6 +239,12 @@ struct SimpleIOContext : AppContextShareImpl {
       mkdirs(outPath);
       auto uniq = std::make_unique<IOExtractContext>(outPath);
       uniq->forEachFile = forEachFile;
+      uniq->deduplicate = mainSettings.extractSettings.deduplicate;
+
+      if (outputFiles) {
+        uniq->outputFiles = &*outputFiles;
+      }
+
       ectx = std::move(uniq);
     }
 
@@ -252,6 +272,11 @@ private:
 
 std::istream *SimpleIOContext::OpenFile(const std::string &path) {
   std::lock_guard<std::mutex> guard(simpleIOLock);
+
+  if (requestedFiles) {
+    requestedFiles->push_back(path);
+  }
+
   for (size_t b = 0; b < 32; b++) {
     uint32 bit = 1 << b;
     if (!(usedFiles & bit)) {
@@ -416,6 +441,7 @@ struct ZIPIOContextInstance : AppContextShareImpl {
         uniq->prefixPath.push_back('/');
       }
       uniq->forEachFile = forEachFile;
+      uniq->deduplicate = mainSettings.extractSettings.deduplicateZIP;
       ectx = std::move(uniq);
     } else {
       std::string outPath;
@@ -431,6 +457,7 @@ struct ZIPIOContextInstance : AppContextShareImpl {
 
       auto uniq = std::make_unique<IOExtractContext>(outPath);
       uniq->forEachFile = forEachFile;
+      uniq->deduplicate = mainSettings.extractSettings.deduplicate;
       ectx = std::move(uniq);
     }
 
@@ -462,19 +489,76 @@ std::shared_ptr<AppContextShare> ZIPIOContext::Instance(ZIPIOEntry entry) {
 
 static std::mutex ZIPLock;
 
+struct ResidentMount {
+  std::string path;
+  uint64 size;
+  std::filesystem::file_time_type mtime;
+  std::shared_ptr<es::MappedFile> file;
+};
+
+// Most recently used first
+static std::list<ResidentMount> residentMounts;
+static size_t residentMountsCapacity = 0;
+static std::mutex residentMountsMutex;
+
+void SetResidentMounts(size_t capacity) {
+  std::lock_guard<std::mutex> lg(residentMountsMutex);
+  residentMountsCapacity = capacity;
+
+  // Mounts still in use are released with their last context
+  while (residentMounts.size() > capacity) {
+    residentMounts.pop_back();
+  }
+}
+
+std::shared_ptr<es::MappedFile> MountFile(const std::string &path) {
+  std::lock_guard<std::mutex> lg(residentMountsMutex);
+
+  if (!residentMountsCapacity) {
+    return std::make_shared<es::MappedFile>(path);
+  }
+
+  std::error_code ec;
+  const uint64 size = std::filesystem::file_size(path, ec);
+  const auto mtime = std::filesystem::last_write_time(path, ec);
+  auto found = std::find_if(
+      residentMounts.begin(), residentMounts.end(),
+      [&](const ResidentMount &item) { return item.path == path; });
+
+  if (found != residentMounts.end()) {
+    if (!ec && found->size == size && found->mtime == mtime) {
+      residentMounts.splice(residentMounts.begin(), residentMounts, found);
+      return found->file;
+    }
+
+    residentMounts.erase(found);
+  }
+
+  auto file = std::make_shared<es::MappedFile>(path);
+
+  if (!ec) {
+    residentMounts.push_front({path, size, mtime, file});
+
+    if (residentMounts.size() > residentMountsCapacity) {
+      residentMounts.pop_back();
+    }
+  }
+
+  return file;
+}
+
 struct ZIPDataHolder {
   virtual ~ZIPDataHolder() = default;
 };
 
 struct ZIPIOContext_implbase : ZIPIOContext {
-  ZIPIOContext_implbase(const std::string &file) : zipMount(file) {}
+  ZIPIOContext_implbase(const std::string &file) : zipMount(MountFile(file)) {}
   std::istream *OpenFile(const ZipEntry &entry) override;
   std::string GetChunk(const ZipEntry &entry, size_t offset,
                        size_t size) const override;
   void DisposeFile(std::istream *str) override;
 
   void Merge(ZIPExtactContext *eCtx, const std::string &records) override {
-    std::lock_guard<std::mutex> lg(mergerMtx);
     merger->Merge(*eCtx, records);
   }
 
@@ -493,7 +577,7 @@ struct ZIPIOContext_implbase : ZIPIOContext {
 
 protected:
   std::list<std::spanstream> openedFiles;
-  es::MappedFile zipMount;
+  std::shared_ptr<es::MappedFile> zipMount;
   std::optional<ZIPMerger> merger;
   std::mutex mergerMtx;
 };
@@ -520,7 +604,7 @@ struct ZIPFileStream : ZIPDataHolder {
 };
 
 std::istream *ZIPIOContext_implbase::OpenFile(const ZipEntry &entry) {
-  auto dataBegin = static_cast<char *>(zipMount.data) + entry.offset;
+  auto dataBegin = static_cast<char *>(zipMount->data) + entry.offset;
   auto dataEnd = dataBegin + entry.size;
 
   std::lock_guard<std::mutex> guard(ZIPLock);
@@ -531,7 +615,7 @@ std::istream *ZIPIOContext_implbase::OpenFile(const ZipEntry &entry) {
 
 std::string ZIPIOContext_implbase::GetChunk(const ZipEntry &entry,
                                             size_t offset, size_t size) const {
-  auto dataBegin = static_cast<char *>(zipMount.data) + entry.offset + offset;
+  auto dataBegin = static_cast<char *>(zipMount->data) + entry.offset + offset;
   auto dataEnd = dataBegin + size;
 
   return {dataBegin, dataEnd};
@@ -632,7 +716,8 @@ AppContextFoundStream ZIPIOContext_impl::FindFile(const std::string &,
 // Warning: Unaligned accesses
 // Note: Multiple central directories? (unlikely)
 void ZIPIOContext_impl::Read() {
-  auto curEnd = static_cast<char *>(zipMount.data) + zipMount.fileSize -
+  TRACE_ZONE("ZIPIOContext::Read");
+  auto curEnd = static_cast<char *>(zipMount->data) + zipMount->fileSize -
                 (sizeof(ZIPCentralDir) - 2);
   auto curLocator = reinterpret_cast<const ZIPCentralDir *>(curEnd);
 
@@ -679,8 +764,8 @@ void ZIPIOContext_impl::Read() {
     }
 
     std::spanstream entriesSpan(
-        std::span<char>(curEnd,
-                        static_cast<char *>(zipMount.data) + zipMount.fileSize),
+        std::span<char>(curEnd, static_cast<char *>(zipMount->data) +
+                                    zipMount->fileSize),
         std::ios::binary | std::ios::in);
     BinReaderRef rd(entriesSpan);
     ZIP64CentralDir x64CentraDir;
@@ -695,13 +780,13 @@ void ZIPIOContext_impl::Read() {
     dirSize = curLocator->dirSize;
   }
 
-  auto entriesBegin = static_cast<char *>(zipMount.data) + dirOffset;
+  auto entriesBegin = static_cast<char *>(zipMount->data) + dirOffset;
   auto entriesEnd = entriesBegin + dirSize;
   std::spanstream entriesSpan(std::span<char>(entriesBegin, entriesEnd),
                               std::ios::binary | std::ios::in);
   BinReaderRef rd(entriesSpan);
   std::spanstream localStreamSpan(
-      std::span<char>(static_cast<char *>(zipMount.data), entriesBegin),
+      std::span<char>(static_cast<char *>(zipMount->data), entriesBegin),
       std::ios::binary | std::ios::in);
   BinReaderRef localRd(localStreamSpan);
 
@@ -833,11 +918,13 @@ struct ZIPIOContextCached : ZIPIOContext_implbase {
     return {cache.Iter(type)};
   }
 
-  ZIPIOContextCached(const std::string &file, es::MappedFile &&cacheFile)
+  ZIPIOContextCached(const std::string &file,
+                     std::shared_ptr<es::MappedFile> cacheFile)
       : ZIPIOContext_implbase(file), cacheMount(std::move(cacheFile)) {
-    cache.Mount(cacheMount.data);
+    TRACE_ZONE("ZIPIOContext::LoadCache");
+    cache.Mount(cacheMount->data);
     auto &cacheHdr = reinterpret_cast<const CacheBaseHeader &>(cache.Header());
-    auto zipData = static_cast<const char *>(zipMount.data);
+    auto zipData = static_cast<const char *>(zipMount->data);
     auto zipHeader = reinterpret_cast<const CacheBaseHeader *>(
         zipData + cacheHdr.zipCheckupOffset);
 
@@ -848,7 +935,7 @@ struct ZIPIOContextCached : ZIPIOContext_implbase {
 
 private:
   Cache cache;
-  es::MappedFile cacheMount;
+  std::shared_ptr<es::MappedFile> cacheMount;
 };
 
 std::unique_ptr<ZIPIOContext> MakeZIPContext(const std::string &file,
@@ -859,9 +946,9 @@ std::unique_ptr<ZIPIOContext> MakeZIPContext(const std::string &file,
 
 std::unique_ptr<ZIPIOContext> MakeZIPContext(const std::string &file) {
   std::string cacheFile = file + ".cache";
-  es::MappedFile mf;
+  std::shared_ptr<es::MappedFile> mf;
   try {
-    mf = es::MappedFile(cacheFile);
+    mf = MountFile(cacheFile);
   } catch (const std::exception &e) {
     printwarning("Failed loading cache: " << e.what());
     return std::make_unique<ZIPIOContext_impl>(file);
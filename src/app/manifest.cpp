@@ -0,0 +1,219 @@
+/*  Spike is universal dedicated module handler
+    This source contains manifest for incremental batch
+
+    Copyright 2024 Lukas Cone
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "spike/app/manifest.hpp"
+#include "nlohmann/json.hpp"
+#include "spike/app/context.hpp"
+#include "spike/crypto/crc32.hpp"
+#include "spike/io/binreader.hpp"
+#include "spike/io/binwritter.hpp"
+#include "spike/io/stat.hpp"
+#include "spike/master_printer.hpp"
+#include <algorithm>
+#include <filesystem>
+
+BatchManifest::BatchManifest(std::string path_, std::string moduleId_,
+                             bool contentHash_)
+    : path(std::move(path_)), moduleId(std::move(moduleId_)),
+      contentHash(contentHash_) {
+  if (FileType(path) != FileType_e::File) {
+    return;
+  }
+
+  auto LoadFingerprint = [](const nlohmann::json &item) {
+    ManifestFingerprint retVal;
+    retVal.size = item.at("size");
+    retVal.mtime = item.at("mtime");
+    retVal.crc = item.at("crc");
+    return retVal;
+  };
+
+  // Damaged manifest is discarded, every input is processed
+  try {
+    BinReader rd(path);
+    nlohmann::json manifest = nlohmann::json::parse(rd.BaseStream());
+
+    if (manifest.value("module", std::string{}) != moduleId ||
+        manifest.value("content_hash", false) != contentHash) {
+      printinfo("Module or settings changed since last run, every input will "
+                "be processed.");
+      return;
+    }
+
+    for (auto &[input, item] : manifest.at("entries").items()) {
+      Entry &entry = entries[input];
+      entry.input = LoadFingerprint(item);
+      entry.outputs = item.at("outputs");
+
+      for (auto &[requested, rItem] : item.at("requested").items()) {
+        entry.requested.emplace(requested, LoadFingerprint(rItem));
+      }
+    }
+  } catch (const std::exception &e) {
+    printwarning("Cannot load manifest " << path << ": " << e.what());
+    entries.clear();
+  }
+}
+
+static bool FileExists(const std::string &file) {
+  return FileType(file) == FileType_e::File;
+}
+
+ManifestFingerprint BatchManifest::Fingerprint(const std::string &file) {
+  const std::filesystem::path filePath(file);
+  std::error_code ec;
+  ManifestFingerprint retVal;
+  retVal.size = std::filesystem::file_size(filePath, ec);
+
+  if (ec) {
+    throw es::FileNotFoundError(file);
+  }
+
+  if (!contentHash) {
+    const auto writeTime = std::filesystem::last_write_time(filePath, ec);
+    retVal.mtime = writeTime.time_since_epoch().count();
+    return retVal;
+  }
+
+  if (retVal.size) {
+    es::MappedFile mappedFile(file);
+    retVal.crc = crc32b(0, static_cast<const char *>(mappedFile.data),
+                        mappedFile.fileSize);
+  }
+
+  return retVal;
+}
+
+bool BatchManifest::IsUpToDate(AppContextShare *ctx) {
+  // Batch groups depend on supplemental files, they are always processed
+  if (ctx->inputPath.empty() || ctx->supplementals) {
+    return false;
+  }
+
+  const std::string &input = ctx->inputPath;
+
+  {
+    std::lock_guard<std::mutex> lg(mutex);
+
+    if (skipped.contains(input)) {
+      return true;
+    } else if (current.contains(input)) {
+      return false;
+    }
+  }
+
+  const ManifestFingerprint fingerprint = Fingerprint(input);
+  Entry entry;
+
+  {
+    std::lock_guard<std::mutex> lg(mutex);
+    current.emplace(input, fingerprint);
+    auto found = entries.find(input);
+
+    if (found == entries.end()) {
+      return false;
+    }
+
+    entry = std::move(found->second);
+    entries.erase(found);
+  }
+
+  // Entry is put back only when it's still valid
+  auto RequestedUpToDate = [&](auto &item) {
+    return FileExists(item.first) && Fingerprint(item.first) == item.second;
+  };
+
+  const bool upToDate =
+      entry.input == fingerprint &&
+      std::all_of(entry.outputs.begin(), entry.outputs.end(), FileExists) &&
+      std::all_of(entry.requested.begin(), entry.requested.end(),
+                  RequestedUpToDate);
+
+  if (!upToDate) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lg(mutex);
+  entries.emplace(input, std::move(entry));
+  skipped.emplace(input);
+
+  return true;
+}
+
+void BatchManifest::Record(AppContextShare *ctx) {
+  if (ctx->inputPath.empty() || ctx->supplementals || !ctx->outputFiles) {
+    return;
+  }
+
+  std::map<std::string, ManifestFingerprint> requested;
+
+  if (ctx->requestedFiles) {
+    for (auto &file : *ctx->requestedFiles) {
+      if (file != ctx->inputPath) {
+        requested.try_emplace(file, Fingerprint(file));
+      }
+    }
+  }
+
+  std::lock_guard<std::mutex> lg(mutex);
+  auto found = current.find(ctx->inputPath);
+
+  if (found != current.end()) {
+    entries[ctx->inputPath] = {found->second, *ctx->outputFiles,
+                               std::move(requested)};
+  }
+}
+
+void BatchManifest::Save() {
+  std::lock_guard<std::mutex> lg(mutex);
+  nlohmann::json manifest;
+  manifest["module"] = moduleId;
+  manifest["content_hash"] = contentHash;
+  nlohmann::json &jEntries = manifest["entries"];
+  jEntries = nlohmann::json::object();
+
+  auto SaveFingerprint = [](const ManifestFingerprint &fingerprint) {
+    return nlohmann::json{{"size", fingerprint.size},
+                          {"mtime", fingerprint.mtime},
+                          {"crc", fingerprint.crc}};
+  };
+
+  for (auto &[input, entry] : entries) {
+    nlohmann::json item = SaveFingerprint(entry.input);
+    item["outputs"] = entry.outputs;
+    nlohmann::json &jRequested = item["requested"];
+    jRequested = nlohmann::json::object();
+
+    for (auto &[requested, fingerprint] : entry.requested) {
+      jRequested[requested] = SaveFingerprint(fingerprint);
+    }
+
+    jEntries[input] = std::move(item);
+  }
+
+  // Written into temporary file first, interrupted save keeps old manifest
+  const std::string tmpPath = path + ".tmp";
+  mkdirs(tmpPath);
+
+  {
+    BinWritter_t<BinCoreOpenMode::Text> wr(tmpPath);
+    wr.BaseStream() << manifest.dump(1);
+  }
+
+  std::filesystem::rename(tmpPath, path);
+}
@@ -0,0 +1,179 @@
+/*  Spike is universal dedicated module handler
+    This source contains index of available modules
+
+    Copyright 2024 Lukas Cone
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "spike/app/module_index.hpp"
+#include "nlohmann/json.hpp"
+#include "spike/app_context.hpp"
+#include "spike/io/binreader.hpp"
+#include "spike/io/binwritter.hpp"
+#include "spike/io/directory_scanner.hpp"
+#include "spike/io/fileinfo.hpp"
+#include "spike/io/stat.hpp"
+#include "spike/master_printer.hpp"
+#include <filesystem>
+#include <set>
+
+static bool SameFile(const ModuleIndexEntry &a, const ModuleIndexEntry &b) {
+  return a.size == b.size && a.mtime == b.mtime;
+}
+
+ModuleIndex::ModuleIndex(const std::string &appFolder_,
+                         const std::string &appName)
+    : appFolder(appFolder_), path(appFolder + appName + ".modules") {
+  std::map<std::string, ModuleIndexEntry> stored;
+
+  if (FileType(path) == FileType_e::File) {
+    try {
+      BinReader rd(path);
+      nlohmann::json index = nlohmann::json::parse(rd.BaseStream());
+
+      // Index made by different application version is rebuilt
+      if (index.value("context_version", 0u) == AppInfo_s::CONTEXT_VERSION) {
+        for (auto &[modulePath, item] : index["modules"].items()) {
+          ModuleIndexEntry &entry = stored[modulePath];
+          entry.size = item["size"];
+          entry.mtime = item["mtime"];
+          entry.contextVersion = item["context_version"];
+          entry.batchControl = item["batch_control"];
+          entry.header = item["header"];
+          entry.filters = item["filters"];
+          entry.probed = true;
+        }
+      }
+    } catch (const std::exception &e) {
+      printwarning("Cannot load module index " << path << ": " << e.what());
+      stored.clear();
+    }
+  }
+
+  // Listing is cheap, modules are loaded only by Match
+  DirectoryScanner sc;
+  sc.AddFilter(std::string_view(".spk$"));
+  sc.Scan(appFolder);
+
+  for (auto &m : sc) {
+    AFileInfo modulePath(m);
+    // Relative, so index is valid for any app invocation path
+    std::string key =
+        m.starts_with(appFolder) ? m.substr(appFolder.size()) : m;
+    auto moduleName = modulePath.GetFilename();
+    ModuleIndexEntry entry;
+    entry.name = moduleName.substr(0, moduleName.find_first_of('.'));
+    std::error_code ec;
+    entry.size = std::filesystem::file_size(m, ec);
+    entry.mtime = std::filesystem::last_write_time(m, ec)
+                      .time_since_epoch()
+                      .count();
+
+    if (auto found = stored.find(key);
+        found != stored.end() && SameFile(found->second, entry)) {
+      found->second.name = std::move(entry.name);
+      entries.emplace(std::move(key), std::move(found->second));
+      stored.erase(found);
+    } else {
+      entries.emplace(std::move(key), std::move(entry));
+      modified = true;
+    }
+  }
+
+  // Removed modules
+  modified |= !stored.empty();
+}
+
+void ModuleIndex::Probe() {
+  for (auto &[modulePath, entry] : entries) {
+    if (entry.probed) {
+      continue;
+    }
+
+    try {
+      ProbeModule(appFolder + modulePath, entry);
+    } catch (const std::exception &e) {
+      printwarning("Cannot index module " << modulePath << ": " << e.what());
+    }
+
+    // Broken modules are indexed too, they are not loaded again until changed
+    entry.probed = true;
+    modified = true;
+  }
+}
+
+std::vector<std::string> ModuleIndex::Match(const std::string &filePath) {
+  Probe();
+  AFileInfo fileInfo(filePath);
+  auto fileName = fileInfo.GetFilenameExt();
+  std::set<std::string> matched;
+
+  for (auto &[modulePath, entry] : entries) {
+    if (entry.contextVersion != AppInfo_s::CONTEXT_VERSION ||
+        entry.batchControl || entry.filters.empty()) {
+      continue;
+    }
+
+    PathFilter filter;
+
+    for (auto &f : entry.filters) {
+      filter.AddFilter(std::string_view(f));
+    }
+
+    if (filter.IsFiltered(fileName)) {
+      matched.emplace(entry.name);
+    }
+  }
+
+  return {matched.begin(), matched.end()};
+}
+
+void ModuleIndex::Save() {
+  if (!modified) {
+    return;
+  }
+
+  nlohmann::json index;
+  index["context_version"] = AppInfo_s::CONTEXT_VERSION;
+  nlohmann::json &modules = index["modules"];
+  modules = nlohmann::json::object();
+
+  for (auto &[modulePath, entry] : entries) {
+    if (!entry.probed) {
+      continue;
+    }
+
+    modules[modulePath] = {{"size", entry.size},
+                           {"mtime", entry.mtime},
+                           {"context_version", entry.contextVersion},
+                           {"batch_control", entry.batchControl},
+                           {"header", entry.header},
+                           {"filters", entry.filters}};
+  }
+
+  try {
+    // Written into temporary file first, interrupted save keeps old index
+    const std::string tmpPath = path + ".tmp";
+
+    {
+      BinWritter_t<BinCoreOpenMode::Text> wr(tmpPath);
+      wr.BaseStream() << index.dump(1);
+    }
+
+    std::filesystem::rename(tmpPath, path);
+    modified = false;
+  } catch (const std::exception &e) {
+    printwarning("Cannot save module index " << path << ": " << e.what());
+  }
+}
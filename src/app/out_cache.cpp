@@ -21,6 +21,7 @@
 #include "spike/except.hpp"
 #include "spike/io/binwritter_stream.hpp"
 #include "spike/io/fileinfo.hpp"
+#include "spike/util/trace.hpp"
 #include <algorithm>
 #include <barrier>
 #include <cinttypes>
@@ -570,6 +571,7 @@ void CacheGenerator::AddFile(std::string_view fileName, size_t zipOffset,
 }
 
 void CacheGenerator::WaitAndWrite(BinWritterRef wr) {
+  TRACE_ZONE("CacheGenerator::WaitAndWrite");
   workThread->isDone = true;
   workThread->generator.allowThreads = true;
   es::Dispose(workThread->walStreamIn);
@@ -25,8 +25,28 @@
 #include "spike/io/binreader.hpp"
 #include "spike/io/fileinfo.hpp"
 #include "spike/io/stat.hpp"
+#include "spike/util/trace.hpp"
+#include <atomic>
 #include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <memory>
 #include <mutex>
+#include <utility>
+
+#if !defined(_MSC_VER) && !defined(__MINGW64__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif
+
+static std::atomic_size_t deduplicatedBytes;
+
+size_t DeduplicatedBytes() { return deduplicatedBytes; }
 
 void ZIPExtactContext::FinishZIP(cache_begin_cb cacheBeginCB) {
   FinishFile(true);
@@ -88,15 +108,42 @@ void ZIPExtactContext::FinishZIP(cache_begin_cb cacheBeginCB) {
 
   records.Write(zCentral);
   records.BaseStream().flush();
+  const size_t zipSize = records.Tell();
 
   if (cache) {
     cacheBeginCB();
-    cache->meta.zipSize = records.Tell();
+    cache->meta.zipSize = zipSize;
     BinWritter cacheWr(outputFile + ".cache");
     cache->WaitAndWrite(cacheWr);
     records.Seek(cache->meta.zipCheckupOffset);
     records.Write(cache->meta);
   }
+
+  // Dropped duplicate at the end left its data past central directory
+  if (zipSize < recordsEnd) {
+    es::Dispose(records);
+    std::filesystem::resize_file(outputFile, zipSize);
+  }
+}
+
+const ZIPExtactContext::StoredFile *ZIPExtactContext::DropDuplicate() {
+  if (!deduplicate || !curFileSize) {
+    return nullptr;
+  }
+
+  auto found = storedFiles.find(curFileHash.Finish());
+
+  if (found == storedFiles.end() || found->second.size != curFileSize ||
+      found->second.crc != zLocalFile.crc) {
+    return nullptr;
+  }
+
+  const size_t recordEnd = records.Tell();
+  recordsEnd = std::max(recordsEnd, recordEnd);
+  deduplicatedBytes += recordEnd - curLocalFileOffset;
+  records.Seek(curLocalFileOffset);
+
+  return &found->second;
 }
 
 void ZIPExtactContext::FinishFile(bool final) {
@@ -128,11 +175,26 @@ void ZIPExtactContext::FinishFile(bool final) {
   }
 
   numEntries++;
-  records.Push();
-  records.Seek(curLocalFileOffset);
-  records.Write(zLocalFile);
-  const size_t fileDataBegin =
-      records.Tell() + zLocalFile.extraFieldSize + zLocalFile.fileNameSize;
+  size_t localFileOffset = curLocalFileOffset;
+  size_t fileDataBegin;
+
+  if (const StoredFile *stored = DropDuplicate()) {
+    localFileOffset = stored->localFileOffset;
+    fileDataBegin = stored->fileDataBegin;
+  } else {
+    records.Push();
+    records.Seek(curLocalFileOffset);
+    records.Write(zLocalFile);
+    fileDataBegin =
+        records.Tell() + zLocalFile.extraFieldSize + zLocalFile.fileNameSize;
+    records.Pop();
+
+    if (deduplicate && curFileSize) {
+      storedFiles.emplace(curFileHash.Finish(),
+                          StoredFile{curLocalFileOffset, fileDataBegin,
+                                     curFileSize, zLocalFile.crc});
+    }
+  }
 
   if (cache) {
     if (curFileName.size() > 0) {
@@ -145,8 +207,6 @@ void ZIPExtactContext::FinishFile(bool final) {
     fileOffsets.push_back(fileDataBegin);
   }
 
-  records.Pop();
-
   ZIPFile zFile{};
   zFile.id = ZIPFile::ID;
   zFile.madeBy = 10;
@@ -159,7 +219,7 @@ void ZIPExtactContext::FinishFile(bool final) {
   zFile.fileNameSize = zLocalFile.fileNameSize;
   zFile.crc = zLocalFile.crc;
   const bool useFileExtendedData =
-      SafeCast(zFile.localHeaderOffset, curLocalFileOffset);
+      SafeCast(zFile.localHeaderOffset, localFileOffset);
 
   const bool useFileExtra = useFileExtendedData || useLocalExtendedData;
   ZIP64Extra extra;
@@ -174,7 +234,7 @@ void ZIPExtactContext::FinishFile(bool final) {
     }
 
     if (useFileExtendedData) {
-      extra.localHeaderOffset = curLocalFileOffset;
+      extra.localHeaderOffset = localFileOffset;
       zFile.extraFieldSize += 8;
     }
   }
@@ -230,6 +290,7 @@ void ZIPExtactContext::NewFile(const std::string &path) {
   zLocalFile.fileNameSize = prefixPath.size() + pathSv.size();
   zLocalFile.crc = 0;
   curFileSize = 0;
+  curFileHash = {};
 
   curFileName = pathSv;
   curLocalFileOffset = records.Tell();
@@ -246,6 +307,10 @@ void ZIPExtactContext::SendData(std::string_view data) {
   curFileSize += data.size();
   zLocalFile.crc = crc32b(zLocalFile.crc, data.data(), data.size());
   records.WriteContainer(data);
+
+  if (deduplicate) {
+    curFileHash.Update(data);
+  }
 }
 
 bool ZIPExtactContext::RequiresFolders() const { return false; }
@@ -273,13 +338,152 @@ NewTexelContext *ZIPExtactContext::NewImage(const std::string &path,
   return texelContext.get();
 }
 
-void IOExtractContext::NewFile(const std::string &path) {
+// Finished folder outputs by their contents, shared by all contexts
+static struct {
+  std::mutex mutex;
+  std::map<Hash128, std::string> files;
+  std::map<std::string, Hash128> hashes;
+
+  // Returns path of file with same contents or registers new one
+  std::optional<std::string> FindOrAdd(const Hash128 &hash,
+                                       const std::string &path) {
+    std::lock_guard<std::mutex> lg(mutex);
+    auto [found, inserted] = files.try_emplace(hash, path);
+
+    if (inserted) {
+      hashes.insert_or_assign(path, hash);
+      return std::nullopt;
+    }
+
+    return found->second;
+  }
+
+  // File is about to be overwritten, it cannot be linked anymore
+  void Forget(const std::string &path) {
+    std::lock_guard<std::mutex> lg(mutex);
+    auto found = hashes.find(path);
+
+    if (found != hashes.end()) {
+      files.erase(found->second);
+      hashes.erase(found);
+    }
+  }
+
+  void Clear() {
+    std::lock_guard<std::mutex> lg(mutex);
+    files.clear();
+    hashes.clear();
+  }
+} folderOutputs;
+
+void ResetDeduplication() {
+  folderOutputs.Clear();
+  deduplicatedBytes = 0;
+}
+
+static bool SameContents(const std::string &original,
+                         const std::string &duplicate, size_t size) {
+  try {
+    es::MappedFile originalFile(original);
+    es::MappedFile duplicateFile(duplicate);
+
+    return originalFile.fileSize == size && duplicateFile.fileSize == size &&
+           !memcmp(originalFile.data, duplicateFile.data, size);
+  } catch (const std::exception &) {
+    return false;
+  }
+}
+
+// Replaces duplicate with reflink of original
+// Hardlink is used when filesystem doesn't support reflinks
+static bool LinkOutput(const std::string &original,
+                       const std::string &duplicate, size_t size) {
+  std::error_code ec;
+
+  if (std::filesystem::file_size(original, ec) != size || ec) {
+    return false;
+  }
+
+  // Equal hashes only nominate candidate, collision must not replace output
+  if (!SameContents(original, duplicate, size)) {
+    return false;
+  }
+
+#ifdef __linux__
+  if (const int srcFd = ::open(original.c_str(), O_RDONLY); srcFd >= 0) {
+    const int dstFd = ::open(duplicate.c_str(), O_WRONLY);
+    const bool cloned = dstFd >= 0 && ::ioctl(dstFd, FICLONE, srcFd) == 0;
+
+    if (dstFd >= 0) {
+      ::close(dstFd);
+    }
+
+    ::close(srcFd);
+
+    if (cloned) {
+      return true;
+    }
+  }
+#endif
+
+  // Duplicate is replaced only after link succeeds
+  const std::string linkPath = duplicate + ".dedup";
+  std::filesystem::create_hard_link(original, linkPath, ec);
+
+  if (ec) {
+    return false;
+  }
+
+  std::filesystem::rename(linkPath, duplicate, ec);
+
+  if (ec) {
+    std::filesystem::remove(linkPath, ec);
+    return false;
+  }
+
+  return true;
+}
+
+IOExtractContext::~IOExtractContext() { FinishFile(); }
+
+void IOExtractContext::FinishFile() {
   Close_();
+
+  if (curFile.empty()) {
+    return;
+  }
+
+  const std::string duplicate = std::exchange(curFile, {});
+
+  if (!curFileSize) {
+    return;
+  }
+
+  auto original = folderOutputs.FindOrAdd(curFileHash.Finish(), duplicate);
+
+  if (original && LinkOutput(*original, duplicate, curFileSize)) {
+    deduplicatedBytes += curFileSize;
+  }
+}
+
+void IOExtractContext::NewFile(const std::string &path) {
+  FinishFile();
   if (path.empty()) [[unlikely]] {
     throw es::RuntimeError("NewFile path is empty");
   }
   AFileInfo cfleWrap(path);
   std::string cfle(cfleWrap.GetFullPath());
+
+  if (deduplicate) {
+    // Never write through link made by deduplication
+    curFile = outDir + cfle;
+    folderOutputs.Forget(curFile);
+    std::error_code ec;
+    std::filesystem::remove(curFile, ec);
+    curFileSize = 0;
+    curFileHash = {};
+  }
+
   try {
     Open(outDir + cfle);
   } catch (const es::FileInvalidAccessError &) {
@@ -287,12 +491,23 @@ void IOExtractContext::NewFile(const std::string &path) {
     Open(outDir + cfle);
   }
 
+  if (outputFiles) {
+    outputFiles->push_back(outDir + cfle);
+  }
+
   if (forEachFile) {
     forEachFile();
   }
 }
 
-void IOExtractContext::SendData(std::string_view data) { WriteContainer(data); }
+void IOExtractContext::SendData(std::string_view data) {
+  WriteContainer(data);
+
+  if (deduplicate) {
+    curFileSize += data.size();
+    curFileHash.Update(data);
+  }
+}
 
 bool IOExtractContext::RequiresFolders() const { return true; }
 
@@ -331,17 +546,129 @@ NewTexelContext *IOExtractContext::NewImage(const std::string &path,
   return texelContext.get();
 }
 
-static std::mutex ZIPLock;
+static constexpr size_t COPY_BUFFER_SIZE = 0x80000;
+
+ZIPMerger::ZIPMerger(const std::string &outFiles, const std::string &outEntries)
+    : entries(outEntries), records(outFiles), entriesFile(outEntries),
+      outFile(outFiles) {
+#if !defined(_MSC_VER) && !defined(__MINGW64__)
+  outHandle = ::open(outFiles.c_str(), O_WRONLY);
+
+  if (outHandle < 0) {
+    throw es::FileInvalidAccessError(outFiles);
+  }
+#endif
+}
+
+ZIPMerger::~ZIPMerger() { CloseHandle(); }
+
+void ZIPMerger::CloseHandle() {
+#if !defined(_MSC_VER) && !defined(__MINGW64__)
+  if (outHandle >= 0) {
+    ::close(outHandle);
+    outHandle = -1;
+  }
+#endif
+}
+
+#if defined(_MSC_VER) || defined(__MINGW64__)
+static std::mutex recordsLock;
+
+void ZIPMerger::CopyRecords(const std::string &recordsFile, size_t offset,
+                            size_t size) {
+  auto buffer = std::make_unique_for_overwrite<char[]>(COPY_BUFFER_SIZE);
+  BinReader rd(recordsFile);
+  std::lock_guard<std::mutex> guard(recordsLock);
+  records.Seek(offset);
+
+  while (size) {
+    const size_t chunkSize = std::min(size, COPY_BUFFER_SIZE);
+    rd.ReadBuffer(buffer.get(), chunkSize);
+    records.WriteBuffer(buffer.get(), chunkSize);
+    size -= chunkSize;
+  }
+}
+#else
+void ZIPMerger::CopyRecords(const std::string &recordsFile, size_t offset,
+                            size_t size) {
+  struct Handle {
+    int fd;
+    ~Handle() {
+      if (fd >= 0) {
+        ::close(fd);
+      }
+    }
+  } input{::open(recordsFile.c_str(), O_RDONLY)};
+
+  if (input.fd < 0) {
+    throw es::FileNotFoundError(recordsFile);
+  }
+
+  off_t inOffset = 0;
+  off_t outOffset = offset;
+
+#ifdef __linux__
+  // Data never leaves kernel, or is reflinked on supporting filesystems
+  while (size) {
+    const ssize_t copied =
+        ::copy_file_range(input.fd, &inOffset, outHandle, &outOffset, size, 0);
+
+    if (copied <= 0) {
+      break;
+    }
+
+    size -= copied;
+  }
+#endif
+
+  // Fallback for cross filesystem copies on older kernels
+  std::unique_ptr<char[]> buffer;
+
+  if (size) {
+    buffer = std::make_unique_for_overwrite<char[]>(COPY_BUFFER_SIZE);
+  }
+
+  while (size) {
+    const ssize_t numRead = ::pread(
+        input.fd, buffer.get(), std::min(size, COPY_BUFFER_SIZE), inOffset);
+
+    if (numRead <= 0) {
+      throw es::FileInvalidAccessError(recordsFile);
+    }
+
+    for (ssize_t written = 0; written < numRead;) {
+      const ssize_t numWritten = ::pwrite(outHandle, buffer.get() + written,
+                                          numRead - written, outOffset);
+
+      if (numWritten <= 0) {
+        throw es::FileInvalidAccessError(outFile);
+      }
+
+      written += numWritten;
+      outOffset += numWritten;
+    }
+
+    inOffset += numRead;
+    size -= numRead;
+  }
+}
+#endif
 
 void ZIPMerger::Merge(ZIPExtactContext &other, const std::string &recordsFile) {
+  TRACE_ZONE("ZIPMerger::Merge");
   if (!other.curFileName.empty()) {
     other.FinishFile();
   }
 
+  const size_t recordsSize = other.records.Tell();
+  es::Dispose(other.records);
+  // Every worker copies into its own range without waiting for others
+  const size_t filesSize = recordsEnd.fetch_add(recordsSize);
+  CopyRecords(recordsFile, filesSize, recordsSize);
+
   BinReaderRef localEntries(other.entriesStream);
-  char buffer[0x80000];
-  std::lock_guard<std::mutex> guard(ZIPLock);
-  const size_t filesSize = records.Tell();
+  char buffer[0x10000];
+  std::lock_guard<std::mutex> guard(entriesMutex);
 
   numEntries += other.numEntries;
 
@@ -405,25 +732,10 @@ void ZIPMerger::Merge(ZIPExtactContext &other, const std::string &recordsFile) {
   }
 
   es::Dispose(other.entriesStream);
-
-  const size_t recordsSize = other.records.Tell();
-  es::Dispose(other.records);
-  BinReader rd(recordsFile);
-  const size_t numBlocks = recordsSize / sizeof(buffer);
-  const size_t restBytes = recordsSize % sizeof(buffer);
-
-  for (size_t b = 0; b < numBlocks; b++) {
-    rd.ReadBuffer(buffer, sizeof(buffer));
-    records.WriteBuffer(buffer, sizeof(buffer));
-  }
-
-  if (restBytes) {
-    rd.ReadBuffer(buffer, restBytes);
-    records.WriteBuffer(buffer, restBytes);
-  }
 }
 
 void ZIPMerger::FinishMerge(cache_begin_cb cacheBeginCB) {
+  CloseHandle();
   size_t entriesSize = entries.Tell();
   es::Dispose(entries);
   char buffer[0x80000];
@@ -431,7 +743,8 @@ void ZIPMerger::FinishMerge(cache_begin_cb cacheBeginCB) {
   const size_t numBlocks = entriesSize / sizeof(buffer);
   const size_t restBytes = entriesSize % sizeof(buffer);
   bool forcex64 = false;
-  const size_t dirOffset = records.Tell();
+  const size_t dirOffset = recordsEnd;
+  records.Seek(dirOffset);
 
   auto SafeCast = [&](auto &where, auto &&what) {
     const uint64 limit =
@@ -15,6 +15,13 @@
 #include "spike/reflect/reflector.hpp"
 #include "spike/uni/format.hpp"
 #include "spike/util/endian.hpp"
+#include "spike/util/multi_thread.hpp"
+#include "spike/util/trace.hpp"
+#include <bit>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <smmintrin.h>
 #include <sstream>
 #include <variant>
 
@@ -1307,18 +1314,21 @@ void DecodeToRGBA(const char *data, NewTexelContextCreate ctx,
       uint32 bwidth = (ctx.width + 3) / 4;
       uint32 bheight = (ctx.height + 3) / 4;
       uint32 bnumBlocks = bwidth * bheight;
-      std::vector<char> tmpBuffer(bwidth * bheight * 8);
+      ScratchScope scope(ThreadScratch());
+      std::span<uint64> tmpBlocks =
+          ThreadScratch().Allocate<uint64>(bnumBlocks);
+      char *tmpBuffer = reinterpret_cast<char *>(tmpBlocks.data());
       for (size_t p = 0; p < bnumBlocks; p++) {
-        memcpy(tmpBuffer.data() + p * 8, data + tiler->get(p) * 8, 8);
+        memcpy(tmpBuffer + p * 8, data + tiler->get(p) * 8, 8);
       }
 
       if (ctx.baseFormat.tile == TexelTile::N3DS) {
         for (uint32 b = 0; b < bnumBlocks; b++) {
-          FByteswapper(reinterpret_cast<uint64 *>(tmpBuffer.data())[b]);
+          FByteswapper(tmpBlocks[b]);
         }
       }
 
-      pvr::PVRTDecompressETC(tmpBuffer.data(), ctx.width, ctx.height,
+      pvr::PVRTDecompressETC(tmpBuffer, ctx.width, ctx.height,
                              reinterpret_cast<uint8_t *>(outData.data()),
                              0x100);
     } else {
@@ -1333,22 +1343,25 @@ void DecodeToRGBA(const char *data, NewTexelContextCreate ctx,
       uint32 bwidth = (ctx.width + 3) / 4;
       uint32 bheight = (ctx.height + 3) / 4;
       uint32 bnumBlocks = bwidth * bheight;
-      std::vector<char> tmpBuffer(bwidth * bheight * 16);
+      ScratchScope scope(ThreadScratch());
+      std::span<uint64> tmpBlocks =
+          ThreadScratch().Allocate<uint64>(bnumBlocks * 2);
+      char *tmpBuffer = reinterpret_cast<char *>(tmpBlocks.data());
       for (size_t p = 0; p < bnumBlocks; p++) {
-        memcpy(tmpBuffer.data() + p * 16, data + tiler->get(p) * 16, 16);
+        memcpy(tmpBuffer + p * 16, data + tiler->get(p) * 16, 16);
       }
 
       for (uint32 b = 0; b < bnumBlocks * 2; b++) {
         b++;
-        FByteswapper(reinterpret_cast<uint64 *>(tmpBuffer.data())[b]);
+        FByteswapper(tmpBlocks[b]);
       }
 
-      pvr::PVRTDecompressETC(tmpBuffer.data(), ctx.width, ctx.height,
+      pvr::PVRTDecompressETC(tmpBuffer, ctx.width, ctx.height,
                              reinterpret_cast<uint8_t *>(outData.data()),
                              0x102);
 
       for (uint32 p = 0; p < bnumBlocks; p++) {
-        uint8 *iData = reinterpret_cast<uint8 *>(tmpBuffer.data() + p * 16);
+        uint8 *iData = reinterpret_cast<uint8 *>(tmpBuffer + p * 16);
 
         uint32 x = p % bwidth;
         uint32 y = p / bwidth;
@@ -1557,13 +1570,12 @@ void Reencode(NewTexelContextCreate ctx, uint32 numDesiredChannels,
               const char *data, std::span<char> outData_) {
   const uint32 numInputChannels = FormatChannels(ctx.baseFormat.type);
   const uint32 numTexels = ctx.width * ctx.height;
-  std::string tempBuffer;
+  ScratchScope scope(ThreadScratch());
   std::span<char> outData = outData_;
   uint32 outDataOffset = numTexels * (numDesiredChannels - numInputChannels);
 
   if (numDesiredChannels < numInputChannels) {
-    tempBuffer.resize(numTexels * numInputChannels);
-    outData = tempBuffer;
+    outData = ThreadScratch().Allocate<char>(numTexels * numInputChannels);
     outDataOffset = 0;
   }
 
@@ -1708,6 +1720,103 @@ void Reencode(NewTexelContextCreate ctx, uint32 numDesiredChannels,
   }
 }
 
+// Lookups between 8 bit sRGB and linear values
+struct SRGBTables {
+  static constexpr uint32 LINEAR_STEPS = 4096;
+  float toLinear[256];
+  uint8 fromLinear[LINEAR_STEPS];
+
+  SRGBTables() {
+    for (uint32 i = 0; i < 256; i++) {
+      const float c = i / 255.f;
+      toLinear[i] = c <= 0.04045f ? c / 12.92f
+                                  : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+
+    for (uint32 i = 0; i < LINEAR_STEPS; i++) {
+      const float c = i / float(LINEAR_STEPS - 1);
+      const float s = c <= 0.0031308f
+                          ? c * 12.92f
+                          : 1.055f * std::pow(c, 1 / 2.4f) - 0.055f;
+      fromLinear[i] = uint8(std::clamp(s, 0.f, 1.f) * 255 + 0.5f);
+    }
+  }
+};
+
+// Box filtered 2x2 reduction of 8 bit per channel texels
+// sRGB color channels are averaged in linear space, alpha is kept linear
+void DownsampleMip(const char *src, uint32 width, uint32 height,
+                   uint32 numChannels, bool srgb, char *dst) {
+  static const SRGBTables srgbTables;
+  const uint32 dstWidth = std::max(1U, width / 2);
+  const uint32 dstHeight = std::max(1U, height / 2);
+  const uint32 numSRGB = !srgb ? 0 : numChannels == 4 ? 3 : numChannels;
+  const uint32 rowsPerTask = std::max(1U, 0x4000 / dstWidth);
+  const uint32 numTasks = (dstHeight + rowsPerTask - 1) / rowsPerTask;
+
+  auto Load = [&](uint32 x, uint32 y) {
+    const char *texel = src + (y * width + x) * numChannels;
+
+    if (numSRGB) {
+      alignas(16) float values[4]{};
+
+      for (uint32 c = 0; c < numChannels; c++) {
+        const uint8 value = texel[c];
+        values[c] =
+            c < numSRGB ? srgbTables.toLinear[value] : value * (1 / 255.f);
+      }
+
+      return _mm_load_ps(values);
+    }
+
+    int32 value = 0;
+    memcpy(&value, texel, numChannels);
+    return _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(value)));
+  };
+
+  RunThreadedQueueEx(numTasks, [&](size_t task) {
+    const uint32 rowBegin = task * rowsPerTask;
+    const uint32 rowEnd = std::min(rowBegin + rowsPerTask, dstHeight);
+    const __m128 quarter = _mm_set1_ps(0.25f);
+
+    for (uint32 y = rowBegin; y < rowEnd; y++) {
+      const uint32 y0 = std::min(y * 2, height - 1);
+      const uint32 y1 = std::min(y * 2 + 1, height - 1);
+      char *outTexel = dst + y * dstWidth * numChannels;
+
+      for (uint32 x = 0; x < dstWidth; x++, outTexel += numChannels) {
+        const uint32 x0 = std::min(x * 2, width - 1);
+        const uint32 x1 = std::min(x * 2 + 1, width - 1);
+        const __m128 sum =
+            _mm_add_ps(_mm_add_ps(Load(x0, y0), Load(x1, y0)),
+                       _mm_add_ps(Load(x0, y1), Load(x1, y1)));
+        const __m128 average = _mm_mul_ps(sum, quarter);
+
+        if (numSRGB) {
+          alignas(16) float values[4];
+          _mm_store_ps(values, average);
+
+          for (uint32 c = 0; c < numChannels; c++) {
+            outTexel[c] =
+                c < numSRGB
+                    ? srgbTables.fromLinear[uint32(
+                          values[c] * (SRGBTables::LINEAR_STEPS - 1) + 0.5f)]
+                    : uint8(values[c] * 255 + 0.5f);
+          }
+
+          continue;
+        }
+
+        __m128i packed = _mm_cvtps_epi32(average);
+        packed = _mm_packus_epi32(packed, packed);
+        packed = _mm_packus_epi16(packed, packed);
+        const int32 texel = _mm_cvtsi128_si32(packed);
+        memcpy(outTexel, &texel, numChannels);
+      }
+    }
+  });
+}
+
 struct NewTexelContextQOI : NewTexelContextImpl {
   qoi_desc qoiDesc{};
   std::string yasBuffer;
@@ -1740,6 +1849,7 @@ struct NewTexelContextQOI : NewTexelContextImpl {
 
   void SendRasterData(const void *data, TexelInputLayout layout,
                       TexelInputFormat *) override {
+    TRACE_ZONE("Texel::EncodeQOI");
     if (layout.mipMap > 0) {
       return;
     }
@@ -1813,6 +1923,7 @@ struct NewTexelContextDDS : NewTexelContextImpl {
   std::vector<std::vector<bool>> mipmaps;
   std::string yasBuffer;
   bool mustDecode;
+  bool generateMips = false;
   uint8 numChannels;
 
   NewTexelContextDDS(NewTexelContextCreate ctx_, bool isBase = false)
@@ -1859,6 +1970,7 @@ struct NewTexelContextDDS : NewTexelContextImpl {
 
       SetDDSFormat(dds, baseFmt);
       dds.ComputeBPP();
+      SetupMipGeneration(baseFmt.type);
       yasBuffer.resize(dds.ComputeBufferSize(ddsMips));
       for (int32 i = 0; i < ctx.numFaces; i++) {
         dds.caps01 -= static_cast<DDS_HeaderEnd::Caps01Flags>(i + 10);
@@ -1866,6 +1978,40 @@ struct NewTexelContextDDS : NewTexelContextImpl {
     }
   }
 
+  // Replaces single mipmap with full chain, that is generated from level 0
+  void SetupMipGeneration(TexelInputFormatType outputType) {
+    using F = TexelInputFormatType;
+    generateMips =
+        mainSettings.texelSettings.processMipMaps &&
+        mainSettings.texelSettings.generateMipMaps && ctx.numMipmaps < 2 &&
+        ctx.depth < 2 &&
+        (outputType == F::R8 || outputType == F::RG8 ||
+         outputType == F::RGB8 || outputType == F::RGBA8);
+
+    if (!generateMips) {
+      return;
+    }
+
+    const uint32 numMips =
+        std::bit_width(uint32(std::max(ctx.width, ctx.height)));
+    dds.NumMipmaps(numMips);
+    mipmaps.resize(numMips, mipmaps.front());
+  }
+
+  void GenerateMipmaps(char *level0, uint32 layer) {
+    uint32 width = ctx.width;
+    uint32 height = ctx.height;
+
+    for (uint32 m = 1; m < dds.mipMapCount; m++) {
+      DownsampleMip(level0 + ddsMips.offsets[m - 1], width, height,
+                    dds.bpp / 8, ctx.baseFormat.srgb,
+                    level0 + ddsMips.offsets[m]);
+      width = std::max(1U, width / 2);
+      height = std::max(1U, height / 2);
+      mipmaps.at(m).at(layer) = true;
+    }
+  }
+
   bool ShouldWrite() const {
     for (auto &l : mipmaps) {
       for (bool m : l) {
@@ -1880,6 +2026,7 @@ struct NewTexelContextDDS : NewTexelContextImpl {
 
   void SendRasterData(const void *data, TexelInputLayout layout,
                       TexelInputFormat *) override {
+    TRACE_ZONE("Texel::EncodeDDS");
     if (!ShouldDoMipmaps() && layout.mipMap > 0) {
       return;
     }
@@ -1933,6 +2080,10 @@ struct NewTexelContextDDS : NewTexelContextImpl {
       RetileData(static_cast<const char *>(data), mctx, rData);
     }
 
+    if (generateMips && layout.mipMap == 0) {
+      GenerateMipmaps(rData, layer);
+    }
+
     if (ShouldWrite()) {
       outCtx->NewFile(std::string(pathOverride.ChangeExtension2("dds")));
       outCtx->SendData(
@@ -1948,6 +2099,7 @@ struct NewTexelContextDDS : NewTexelContextImpl {
   }
 
   void Finish() override {
+    TRACE_ZONE("Texel::FinishDDS");
     if (!ShouldWrite()) {
       throw es::RuntimeError("Incomplete dds file");
     }
@@ -1987,6 +2139,7 @@ struct NewTexelContextDDSLegacy : NewTexelContextDDS {
 
     SetDDSLegacyFormat(dds, baseFmt);
     dds.ComputeBPP();
+    SetupMipGeneration(baseFmt.type);
     dds.ComputeBufferSize(ddsMips);
 
     for (int32 i = 0; i < ctx.numFaces; i++) {
@@ -2019,6 +2172,7 @@ struct NewTexelContextDDSLegacy : NewTexelContextDDS {
 
   void SendRasterData(const void *data, TexelInputLayout layout,
                       TexelInputFormat *) override {
+    TRACE_ZONE("Texel::EncodeDDSLegacy");
     if (!ShouldDoMipmaps() && layout.mipMap > 0) {
       return;
     }
@@ -2077,6 +2231,10 @@ struct NewTexelContextDDSLegacy : NewTexelContextDDS {
       RetileData(static_cast<const char *>(data), mctx, rData);
     }
 
+    if (generateMips && layout.mipMap == 0) {
+      GenerateMipmaps(rData, layer);
+    }
+
     if (ShouldWrite(layout.layer)) {
       std::string suffix;
 
@@ -2096,6 +2254,7 @@ struct NewTexelContextDDSLegacy : NewTexelContextDDS {
   }
 
   void Finish() override {
+    TRACE_ZONE("Texel::FinishDDSLegacy");
     if (!ShouldWrite(-1)) {
       throw es::RuntimeError("Incomplete dds file");
     }
@@ -2272,6 +2431,7 @@ struct NewTexelContextPNG : NewTexelContextImpl {
 
   void SendRasterData(const void *data, TexelInputLayout layout,
                       TexelInputFormat *) override {
+    TRACE_ZONE("Texel::EncodePNG");
     if (layout.mipMap > 0) {
       return;
     }
@@ -2344,12 +2504,298 @@ struct NewTexelContextPNG : NewTexelContextImpl {
   void Finish() override {}
 };
 
+std::unique_ptr<NewTexelContextImpl>
+CreateTexelContext(NewTexelContextCreate ctx);
+
+// Direction to cubemap face lookup for equirectangular projection
+// Output is (faceSize * 4) x (faceSize * 2)
+// Entries are precomputed only up to MAX_TABLE_FACE (8 B * 8 * face^2),
+// bigger faces have their rows computed during resampling
+struct EquirectTable {
+  static constexpr uint32 MAX_TABLE_FACE = 1024;
+
+  struct Entry {
+    // Index of top left sample texel within 6 consecutive faces
+    uint32 offset;
+    // Bilinear weights in 1/65535 units
+    uint16 fx;
+    uint16 fy;
+  };
+
+  uint32 faceSize;
+  // Neighbour sample steps, zero for 1x1 faces
+  uint32 stepX;
+  uint32 stepY;
+  std::vector<Entry> entries;
+
+  EquirectTable(uint32 faceSize_)
+      : faceSize(faceSize_), stepX(faceSize > 1), stepY(stepX * faceSize) {
+    if (faceSize > MAX_TABLE_FACE) {
+      return;
+    }
+
+    const uint32 width = faceSize * 4;
+    const uint32 height = faceSize * 2;
+    entries.resize(width * height);
+
+    RunThreadedQueueEx(height, [&](size_t y) {
+      MakeRow(y, entries.data() + y * width);
+    });
+  }
+
+  // Fills faceSize * 4 entries of output row y
+  void MakeRow(uint32 y, Entry *row) const {
+    const uint32 width = faceSize * 4;
+    const uint32 height = faceSize * 2;
+    const float lat = 1.5707964f - (y + 0.5f) * 3.1415927f / height;
+    const float cosLat = std::cos(lat);
+    const float sinLat = std::sin(lat);
+
+    for (uint32 x = 0; x < width; x++) {
+      const float lon = (x + 0.5f) * 6.2831855f / width - 3.1415927f;
+      row[x] =
+          MakeEntry(cosLat * std::sin(lon), sinLat, cosLat * std::cos(lon));
+    }
+  }
+
+  // D3D cubemap face selection, faces are ordered as CubemapFace - 1
+  Entry MakeEntry(float x, float y, float z) const {
+    const float ax = std::abs(x);
+    const float ay = std::abs(y);
+    const float az = std::abs(z);
+    uint32 face;
+    float sc, tc, ma;
+
+    if (ax >= ay && ax >= az) {
+      face = x > 0 ? 0 : 1;
+      sc = x > 0 ? -z : z;
+      tc = -y;
+      ma = ax;
+    } else if (ay >= az) {
+      face = y > 0 ? 2 : 3;
+      sc = x;
+      tc = y > 0 ? z : -z;
+      ma = ay;
+    } else {
+      face = z > 0 ? 4 : 5;
+      sc = z > 0 ? x : -x;
+      tc = -y;
+      ma = az;
+    }
+
+    const float maxCoord = float(faceSize - 1);
+    auto Coord = [&](float c, uint32 &base) {
+      const float texel = std::clamp(
+          ((c / ma + 1) * 0.5f) * faceSize - 0.5f, 0.f, maxCoord);
+      base = std::min(uint32(texel), faceSize - 1 - stepX);
+      return uint16((texel - base) * 0xffff + 0.5f);
+    };
+
+    uint32 px, py;
+    Entry retVal;
+    retVal.fx = Coord(sc, px);
+    retVal.fy = Coord(tc, py);
+    retVal.offset = (face * faceSize + py) * faceSize + px;
+
+    return retVal;
+  }
+};
+
+std::shared_ptr<const EquirectTable> GetEquirectTable(uint32 faceSize) {
+  static std::mutex tablesMutex;
+  static std::map<uint32, std::shared_ptr<const EquirectTable>> tables;
+  std::lock_guard<std::mutex> lg(tablesMutex);
+  auto found = tables.find(faceSize);
+
+  if (found != tables.end()) {
+    return found->second;
+  }
+
+  // Tables take up to 64 MB, keep only few resolutions
+  if (tables.size() > 3) {
+    tables.clear();
+  }
+
+  auto table = std::make_shared<const EquirectTable>(faceSize);
+  tables.emplace(faceSize, table);
+
+  return table;
+}
+
+// Bilinear resampling of 6 consecutive faces (with 4 bytes of padding) into
+// equirectangular image
+void ResampleEquirect(const EquirectTable &table, const char *faces,
+                      uint32 numChannels, char *outData) {
+  const uint32 width = table.faceSize * 4;
+  const uint32 height = table.faceSize * 2;
+
+  auto Load = [&](uint32 index) {
+    int32 texel;
+    memcpy(&texel, faces + index * numChannels, sizeof(texel));
+    return _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(texel)));
+  };
+
+  RunThreadedQueueEx(height, [&](size_t y) {
+    const EquirectTable::Entry *entries;
+
+    if (table.entries.empty()) {
+      thread_local std::vector<EquirectTable::Entry> rowEntries;
+      rowEntries.resize(width);
+      table.MakeRow(y, rowEntries.data());
+      entries = rowEntries.data();
+    } else {
+      entries = table.entries.data() + y * width;
+    }
+
+    char *outRow = outData + y * width * numChannels;
+    const __m128 weightScale = _mm_set1_ps(1.f / 0xffff);
+
+    for (uint32 x = 0; x < width; x++) {
+      const EquirectTable::Entry entry = entries[x];
+      const __m128 fx = _mm_mul_ps(_mm_set1_ps(entry.fx), weightScale);
+      const __m128 fy = _mm_mul_ps(_mm_set1_ps(entry.fy), weightScale);
+      const __m128 t00 = Load(entry.offset);
+      const __m128 t10 = Load(entry.offset + table.stepX);
+      const __m128 t01 = Load(entry.offset + table.stepY);
+      const __m128 t11 = Load(entry.offset + table.stepY + table.stepX);
+      const __m128 top = _mm_add_ps(t00, _mm_mul_ps(_mm_sub_ps(t10, t00), fx));
+      const __m128 bottom =
+          _mm_add_ps(t01, _mm_mul_ps(_mm_sub_ps(t11, t01), fx));
+      const __m128 result =
+          _mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), fy));
+      __m128i packed = _mm_cvtps_epi32(result);
+      packed = _mm_packus_epi32(packed, packed);
+      packed = _mm_packus_epi16(packed, packed);
+      const int32 texel = _mm_cvtsi128_si32(packed);
+      memcpy(outRow + x * numChannels, &texel, numChannels);
+    }
+  });
+}
+
+// Equirect output is always 8 bit and without mipmaps,
+// HDR cubemaps are kept native to not lose range and precision
+bool IsHDRFormat(TexelInputFormatType fmt) {
+  return fmt == TexelInputFormatType::RGBA16 ||
+         fmt == TexelInputFormatType::BC6 ||
+         fmt == TexelInputFormatType::RGB9E5;
+}
+
+bool UseEquirect(NewTexelContextCreate ctx) {
+  return mainSettings.texelSettings.cubemapToEquirectangular &&
+         ctx.numFaces == 6 && ctx.width == ctx.height && ctx.depth < 2 &&
+         ctx.width <= 4096 && !IsHDRFormat(ctx.baseFormat.type) &&
+         FormatChannels(ctx.baseFormat.type) > 0;
+}
+
+// Decodes cubemap faces and sends them as single equirectangular image into
+// underlying context
+struct NewTexelContextEquirect : NewTexelContextImpl {
+  std::unique_ptr<NewTexelContextImpl> output;
+  std::shared_ptr<const EquirectTable> table;
+  std::vector<std::string> faceBuffers;
+  std::vector<uint8> faceMasks;
+  std::string decodeBuffer;
+  uint32 numChannels;
+  uint32 faceStride;
+
+  static constexpr uint8 ALL_FACES = 0x3f;
+
+  NewTexelContextEquirect(NewTexelContextCreate ctx_)
+      : NewTexelContextImpl(ctx_),
+        numChannels(FormatChannels(ctx.baseFormat.type)),
+        faceStride(uint32(ctx.width) * ctx.width * numChannels) {
+    faceBuffers.resize(ctx.arraySize);
+    faceMasks.resize(ctx.arraySize);
+
+    static const TexelInputFormatType decodedTypes[]{
+        TexelInputFormatType::R8, TexelInputFormatType::RG8,
+        TexelInputFormatType::RGB8, TexelInputFormatType::RGBA8};
+    NewTexelContextCreate octx{
+        .width = uint16(ctx.width * 4),
+        .height = uint16(ctx.height * 2),
+        .baseFormat =
+            {
+                .type = decodedTypes[numChannels - 1],
+                .srgb = ctx.baseFormat.srgb,
+                .premultAlpha = ctx.baseFormat.premultAlpha,
+            },
+        .numFaces = -1,
+        .arraySize = ctx.arraySize,
+        .formatOverride = ctx.formatOverride,
+    };
+
+    output = CreateTexelContext(octx);
+  }
+
+  void SendRasterData(const void *data, TexelInputLayout layout,
+                      TexelInputFormat *) override {
+    TRACE_ZONE("Texel::Equirect");
+    if (layout.mipMap > 0 || layout.face == CubemapFace::NONE) {
+      return;
+    }
+
+    const uint8 faceIndex = uint8(layout.face) - 1;
+    uint8 &faceMask = faceMasks.at(layout.layer);
+
+    if (faceMask & (1 << faceIndex)) {
+      // face already filled
+      return;
+    }
+
+    auto &buffer = faceBuffers.at(layout.layer);
+
+    if (buffer.empty()) {
+      buffer.resize(faceStride * 6 + sizeof(int32));
+    }
+
+    // Block decoders need whole blocks
+    const uint32 paddedSize = (ctx.width + 3) & ~3;
+    decodeBuffer.resize(paddedSize * paddedSize * numChannels);
+    Reencode(ctx, numChannels, static_cast<const char *>(data), decodeBuffer);
+    memcpy(buffer.data() + faceStride * faceIndex, decodeBuffer.data(),
+           faceStride);
+    faceMask |= 1 << faceIndex;
+
+    if (faceMask != ALL_FACES) {
+      return;
+    }
+
+    if (!table) {
+      table = GetEquirectTable(ctx.width);
+    }
+
+    std::string equirect(faceStride * 8, 0);
+    ResampleEquirect(*table, buffer.data(), numChannels, equirect.data());
+    es::Dispose(buffer);
+
+    output->outCtx = outCtx;
+    output->pathOverride = pathOverride;
+    output->SendRasterData(equirect.data(), {.layer = layout.layer});
+  }
+
+  bool ShouldDoMipmaps() override { return false; }
+
+  void Finish() override {
+    for (uint8 m : faceMasks) {
+      if (m != ALL_FACES) {
+        throw es::RuntimeError("Incomplete cubemap");
+      }
+    }
+
+    output->Finish();
+  }
+};
+
 std::unique_ptr<NewTexelContextImpl>
 CreateTexelContext(NewTexelContextCreate ctx) {
   if (ctx.formatOverride == TexelContextFormat::Config) {
     ctx.formatOverride = OutputFormat();
   }
 
+  if (UseEquirect(ctx)) {
+    return std::make_unique<NewTexelContextEquirect>(ctx);
+  }
+
   switch (ctx.formatOverride) {
   case TexelContextFormat::DDS:
     return std::make_unique<NewTexelContextDDS>(ctx);
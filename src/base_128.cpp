@@ -0,0 +1,300 @@
+/*  a source for base_128
+
+    Copyright 2024 Lukas Cone
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "spike/type/base_128.hpp"
+#include "spike/except.hpp"
+#include <bit>
+#include <smmintrin.h>
+
+namespace {
+constexpr uint64 GROUP_MASK = 0x7f7f7f7f7f7f7f7f;
+constexpr uint64 CONTINUE_MASK = 0x8080808080808080;
+
+uint64 Load64(const uint8 *data) {
+  uint64 retVal;
+  memcpy(&retVal, data, sizeof(retVal));
+  return retVal;
+}
+
+void Store64(uint8 *data, uint64 value) { memcpy(data, &value, sizeof(value)); }
+
+// Mask for low numBytes in [1, 8]
+uint64 BytesMask(size_t numBytes) { return ~uint64(0) >> (64 - numBytes * 8); }
+
+// Joins 7 bit groups from every byte into 56 bit value
+uint64 Compact7(uint64 x) {
+  x = ((x & 0x7f007f007f007f00) >> 1) | (x & 0x007f007f007f007f);
+  x = ((x & 0x3fff00003fff0000) >> 2) | (x & 0x00003fff00003fff);
+  return ((x & 0x0fffffff00000000) >> 4) | (x & 0x000000000fffffff);
+}
+
+// Inverse of Compact7, value must be lower than 1 << 56
+uint64 Spread7(uint64 x) {
+  x = ((x & 0x00fffffff0000000) << 4) | (x & 0x000000000fffffff);
+  x = ((x & 0x0fffc0000fffc000) << 2) | (x & 0x00003fff00003fff);
+  return ((x & 0x3f803f803f803f80) << 1) | (x & 0x007f007f007f007f);
+}
+
+// Terminating byte of bint128 holds only 6 bits and sign flag, 9th byte is
+// always stored whole
+template <bool SIGNED>
+uint64 DecodeScalar(const uint8 *&cur, const uint8 *end) {
+  uint64 value = 0;
+
+  for (size_t id = 0; id < 9; id++) {
+    if (cur == end) {
+      throw es::UnexpectedEOS();
+    }
+
+    const uint8 cNum = *cur++;
+
+    if (id == 8) {
+      value |= uint64(cNum) << 56;
+    } else if (cNum & 0x80) {
+      value |= uint64(cNum & 0x7f) << (7 * id);
+      continue;
+    } else if constexpr (SIGNED) {
+      value |= uint64(cNum & 0x3f) << (7 * id);
+
+      if (cNum & 0x40) {
+        value = ~value;
+      }
+    } else {
+      value |= uint64(cNum) << (7 * id);
+    }
+
+    break;
+  }
+
+  return value;
+}
+
+// At least 9 bytes must be readable
+template <bool SIGNED> uint64 DecodeOne(const uint8 *data, size_t numBytes) {
+  if (numBytes > 8) {
+    return Compact7(Load64(data) & GROUP_MASK) | uint64(data[8]) << 56;
+  }
+
+  uint64 groups = Load64(data) & BytesMask(numBytes) & GROUP_MASK;
+
+  if constexpr (SIGNED) {
+    const uint64 signBit = uint64(0x40) << ((numBytes - 1) * 8);
+    const bool sign = groups & signBit;
+    groups = Compact7(groups & ~signBit);
+    return sign ? ~groups : groups;
+  } else {
+    return Compact7(groups);
+  }
+}
+
+// Expands 8 single byte values
+template <bool SIGNED> void Widen8(__m128i bytes, void *output) {
+  __m128i *out = static_cast<__m128i *>(output);
+
+  if constexpr (SIGNED) {
+    const __m128i flag = _mm_set1_epi8(0x40);
+    const __m128i sign = _mm_cmpeq_epi8(_mm_and_si128(bytes, flag), flag);
+    bytes = _mm_xor_si128(_mm_and_si128(bytes, _mm_set1_epi8(0x3f)), sign);
+    _mm_storeu_si128(out, _mm_cvtepi8_epi64(bytes));
+    _mm_storeu_si128(out + 1, _mm_cvtepi8_epi64(_mm_srli_si128(bytes, 2)));
+    _mm_storeu_si128(out + 2, _mm_cvtepi8_epi64(_mm_srli_si128(bytes, 4)));
+    _mm_storeu_si128(out + 3, _mm_cvtepi8_epi64(_mm_srli_si128(bytes, 6)));
+  } else {
+    _mm_storeu_si128(out, _mm_cvtepu8_epi64(bytes));
+    _mm_storeu_si128(out + 1, _mm_cvtepu8_epi64(_mm_srli_si128(bytes, 2)));
+    _mm_storeu_si128(out + 2, _mm_cvtepu8_epi64(_mm_srli_si128(bytes, 4)));
+    _mm_storeu_si128(out + 3, _mm_cvtepu8_epi64(_mm_srli_si128(bytes, 6)));
+  }
+}
+
+template <bool SIGNED, class T>
+size_t Decode(std::span<const uint8> input, std::span<T> output) {
+  const uint8 *cur = input.data();
+  const uint8 *const end = cur + input.size();
+  const size_t numValues = output.size();
+  size_t index = 0;
+
+  // Any value fits into 16 bytes, continuation flags are gathered at once
+  while (index < numValues && end - cur >= 16) {
+    const __m128i bytes =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(cur));
+    const uint32 continuation = _mm_movemask_epi8(bytes);
+
+    if (!(continuation & 0xff) && numValues - index >= 8) {
+      Widen8<SIGNED>(bytes, output.data() + index);
+      index += 8;
+      cur += 8;
+
+      if (!continuation && numValues - index >= 8) {
+        Widen8<SIGNED>(_mm_srli_si128(bytes, 8), output.data() + index);
+        index += 8;
+        cur += 8;
+      }
+
+      continue;
+    }
+
+    const size_t numBytes =
+        std::min(size_t(std::countr_one(continuation)) + 1, size_t(9));
+    output[index++] = static_cast<T>(DecodeOne<SIGNED>(cur, numBytes));
+    cur += numBytes;
+  }
+
+  while (index < numValues) {
+    output[index++] = static_cast<T>(DecodeScalar<SIGNED>(cur, end));
+  }
+
+  return cur - input.data();
+}
+
+// Writes up to 16 bytes
+size_t EncodeOne(uint64 value, uint8 *out) {
+  const size_t numBits = std::bit_width(value);
+
+  if (numBits > 56) {
+    Store64(out, Spread7(value & 0x00ffffffffffffff) | CONTINUE_MASK);
+    out[8] = static_cast<uint8>(value >> 56);
+    return 9;
+  }
+
+  const size_t numBytes = std::max((numBits + 6) / 7, size_t(1));
+  Store64(out, Spread7(value) | (CONTINUE_MASK & (BytesMask(numBytes) >> 8)));
+  return numBytes;
+}
+
+size_t EncodeOne(int64 value, uint8 *out) {
+  // Values lower than -(1 << 55) are stored without sign flag
+  const bool sign = value < 0 && !(~value >> 55);
+  const uint64 valueCopy = sign ? ~value : value;
+  const size_t numBits = std::bit_width(valueCopy);
+
+  if (numBits > 56) {
+    return EncodeOne(valueCopy, out);
+  }
+
+  const size_t numGroups = std::max((numBits + 6) / 7, size_t(1));
+  const uint64 groups = Spread7(valueCopy);
+  const uint8 signMask = sign ? 0x40 : 0;
+  const size_t lastShift = (numGroups - 1) * 8;
+
+  // Sign flag doesn't fit into last group
+  if ((groups >> lastShift) & 0x40) {
+    Store64(out, groups | (CONTINUE_MASK & BytesMask(numGroups)));
+    out[numGroups] = signMask;
+    return numGroups + 1;
+  }
+
+  Store64(out, groups | (CONTINUE_MASK & (BytesMask(numGroups) >> 8)) |
+                   uint64(signMask) << lastShift);
+  return numGroups;
+}
+
+// Moves lowest byte of both 64 bit lanes into bytes [2 * slot, 2 * slot + 1]
+__m128i GatherLowBytes(__m128i values, size_t slot) {
+  const size_t shift = slot * 16;
+  const uint64 mask = ~(uint64(0xffff) << shift) | (uint64(0x0800) << shift);
+  return _mm_shuffle_epi8(values, _mm_set_epi64x(-1, int64(mask)));
+}
+
+// Packs 8 values into bytes when all of them fit into a single byte
+template <bool SIGNED> bool Narrow8(const void *input, uint8 *out) {
+  const __m128i *in = static_cast<const __m128i *>(input);
+  __m128i values[4];
+  __m128i ranges = _mm_setzero_si128();
+
+  for (size_t i = 0; i < 4; i++) {
+    values[i] = _mm_loadu_si128(in + i);
+
+    if constexpr (SIGNED) {
+      // [-64, 63] range is shifted into [0, 127]
+      ranges = _mm_or_si128(ranges,
+                            _mm_add_epi64(values[i], _mm_set1_epi64x(64)));
+    } else {
+      ranges = _mm_or_si128(ranges, values[i]);
+    }
+  }
+
+  if (!_mm_testz_si128(ranges, _mm_set1_epi64x(~int64(0x7f)))) {
+    return false;
+  }
+
+  __m128i bytes = _mm_setzero_si128();
+
+  for (size_t i = 0; i < 4; i++) {
+    bytes = _mm_or_si128(bytes, GatherLowBytes(values[i], i));
+  }
+
+  if constexpr (SIGNED) {
+    const __m128i sign = _mm_cmpgt_epi8(_mm_setzero_si128(), bytes);
+    bytes = _mm_or_si128(_mm_xor_si128(bytes, sign),
+                         _mm_and_si128(sign, _mm_set1_epi8(0x40)));
+  }
+
+  _mm_storel_epi64(reinterpret_cast<__m128i *>(out), bytes);
+
+  return true;
+}
+
+template <bool SIGNED, class T>
+size_t Encode(std::span<const T> input, std::span<uint8> output) {
+  uint8 *cur = output.data();
+  uint8 *const end = cur + output.size();
+  const size_t numValues = input.size();
+  size_t index = 0;
+
+  while (index < numValues && end - cur >= 16) {
+    if (numValues - index >= 8 &&
+        Narrow8<SIGNED>(input.data() + index, cur)) {
+      index += 8;
+      cur += 8;
+      continue;
+    }
+
+    cur += EncodeOne(input[index++], cur);
+  }
+
+  while (index < numValues) {
+    uint8 buffer[16];
+    const size_t numBytes = EncodeOne(input[index++], buffer);
+
+    if (size_t(end - cur) < numBytes) {
+      throw es::LengthError("Output buffer is too small for varints.");
+    }
+
+    memcpy(cur, buffer, numBytes);
+    cur += numBytes;
+  }
+
+  return cur - output.data();
+}
+} // namespace
+
+size_t DecodeVarints(std::span<const uint8> input, std::span<uint64> output) {
+  return Decode<false>(input, output);
+}
+
+size_t DecodeVarints(std::span<const uint8> input, std::span<int64> output) {
+  return Decode<true>(input, output);
+}
+
+size_t EncodeVarints(std::span<const uint64> input, std::span<uint8> output) {
+  return Encode<false>(input, output);
+}
+
+size_t EncodeVarints(std::span<const int64> input, std::span<uint8> output) {
+  return Encode<true>(input, output);
+}
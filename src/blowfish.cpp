@@ -17,6 +17,7 @@
 
 #include "spike/crypto/blowfish2.h"
 #include "spike/except.hpp"
+#include "spike/util/multi_thread.hpp"
 #include <cstring>
 #include <random>
 
@@ -27,6 +28,10 @@
 #define BF_XOR(_item, _item2, _pid) _item.d ^= BF_SBKEY(_item2) ^ pboxes[_pid]
 #define BF_NUMPBOXES 18
 #define BF_NUMSBOXES 1024
+// Number of independent blocks processed per round to hide sbox load latency
+#define BF_INTERLEAVE 4
+// Minimum number of blocks per thread (1 MB)
+#define BF_THREAD_BLOCKS 0x20000
 
 static const uint32 BF_PBOXES[] = {
     0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344, 0xa4093822, 0x299f31d0,
@@ -215,6 +220,8 @@ public:
 
   virtual void EncodeBlock(uint64 &block) const;
   virtual void DecodeBlock(uint64 &block) const;
+  virtual void EncodeBlocks(uint64 *blocks, size_t numBlocks) const;
+  virtual void DecodeBlocks(uint64 *blocks, size_t numBlocks) const;
   virtual ~BlowfishContext() = default;
   void CreateVector();
 };
@@ -283,6 +290,97 @@ void BlowfishContext::DecodeBlock(uint64 &block) const {
   std::swap(_val0, _val1);
 }
 
+template <bool reversed>
+static uint32 BFFeistel(const uint32 *sboxes, uint32 value) {
+  const uint8 b0 = reversed ? value : value >> 24;
+  const uint8 b1 = value >> (reversed ? 8 : 16);
+  const uint8 b2 = value >> (reversed ? 16 : 8);
+  const uint8 b3 = reversed ? value >> 24 : value;
+
+  return ((sboxes[b0] + sboxes[256 + b1]) ^ sboxes[512 + b2]) +
+         sboxes[768 + b3];
+}
+
+// Runs numLanes independent blocks through rounds in lockstep
+template <size_t numLanes, bool reversed, bool decode>
+static void BFProcessLanes(const uint32 *pboxes, const uint32 *sboxes,
+                           uint64 *blocks) {
+  uint32 left[numLanes];
+  uint32 right[numLanes];
+
+  for (size_t l = 0; l < numLanes; l++) {
+    left[l] = static_cast<uint32>(blocks[l]) ^ pboxes[decode ? 17 : 0];
+    right[l] = static_cast<uint32>(blocks[l] >> 32);
+  }
+
+  for (size_t p = 1; p < 17; p += 2) {
+    const uint32 pbox0 = pboxes[decode ? 17 - p : p];
+    const uint32 pbox1 = pboxes[decode ? 16 - p : p + 1];
+
+    for (size_t l = 0; l < numLanes; l++) {
+      right[l] ^= BFFeistel<reversed>(sboxes, left[l]) ^ pbox0;
+    }
+
+    for (size_t l = 0; l < numLanes; l++) {
+      left[l] ^= BFFeistel<reversed>(sboxes, right[l]) ^ pbox1;
+    }
+  }
+
+  for (size_t l = 0; l < numLanes; l++) {
+    right[l] ^= pboxes[decode ? 0 : 17];
+    blocks[l] = right[l] | (static_cast<uint64>(left[l]) << 32);
+  }
+}
+
+template <bool reversed, bool decode>
+static void BFProcessBlocks(const uint32 *pboxes, const uint32 *sboxes,
+                            uint64 *blocks, size_t numBlocks) {
+  size_t b = 0;
+
+  for (; b + BF_INTERLEAVE <= numBlocks; b += BF_INTERLEAVE) {
+    BFProcessLanes<BF_INTERLEAVE, reversed, decode>(pboxes, sboxes,
+                                                    blocks + b);
+  }
+
+  for (; b < numBlocks; b++) {
+    BFProcessLanes<1, reversed, decode>(pboxes, sboxes, blocks + b);
+  }
+}
+
+void BlowfishContext::EncodeBlocks(uint64 *blocks, size_t numBlocks) const {
+  BFProcessBlocks<false, false>(pboxes, sboxes, blocks, numBlocks);
+}
+
+void BlowfishContext::DecodeBlocks(uint64 *blocks, size_t numBlocks) const {
+  BFProcessBlocks<false, true>(pboxes, sboxes, blocks, numBlocks);
+}
+
+// Splits independent block ranges between threads for large buffers
+// lmBody(size_t firstBlock, size_t numBlocks, size_t taskIndex)
+template <class lmBody>
+static void BFRunRanges(size_t numBlocks, size_t numTasks, lmBody &&fc) {
+  if (numTasks < 2) {
+    fc(0, numBlocks, 0);
+    return;
+  }
+
+  const size_t taskBlocks = (numBlocks + numTasks - 1) / numTasks;
+
+  // Ranges are short, batch workers already keep every core busy
+  RunThreadedQueue(
+      numTasks,
+      [&](size_t index) {
+        const size_t begin = index * taskBlocks;
+        fc(begin, std::min(taskBlocks, numBlocks - begin), index);
+      },
+      true);
+}
+
+static size_t BFNumTasks(size_t numBlocks) {
+  const size_t numThreads = std::max(std::thread::hardware_concurrency(), 1U);
+  return std::min<size_t>(numBlocks / BF_THREAD_BLOCKS, numThreads);
+}
+
 void BlowfishContext::CreateVector() {
   std::uniform_int_distribution<uint64> rd;
   std::default_random_engine re;
@@ -351,18 +449,20 @@ void BlowfishEncoder::EncodeECB(char *buffer, size_t size) const {
   const size_t numblocks = CheckInputs(buffer, size);
   uint64 *curBuffer = reinterpret_cast<uint64 *>(buffer);
 
-  for (size_t b = 0; b < numblocks; b++) {
-    pi->EncodeBlock(curBuffer[b]);
-  }
+  BFRunRanges(numblocks, BFNumTasks(numblocks),
+              [&](size_t begin, size_t count, size_t) {
+                pi->EncodeBlocks(curBuffer + begin, count);
+              });
 }
 
 void BlowfishEncoder::DecodeECB(char *buffer, size_t size) const {
   const size_t numblocks = CheckInputs(buffer, size);
   uint64 *curBuffer = reinterpret_cast<uint64 *>(buffer);
 
-  for (size_t b = 0; b < numblocks; b++) {
-    pi->DecodeBlock(curBuffer[b]);
-  }
+  BFRunRanges(numblocks, BFNumTasks(numblocks),
+              [&](size_t begin, size_t count, size_t) {
+                pi->DecodeBlocks(curBuffer + begin, count);
+              });
 }
 
 void BlowfishEncoder::EncodeCBC(char *buffer, size_t size) const {
@@ -380,17 +480,36 @@ void BlowfishEncoder::EncodeCBC(char *buffer, size_t size) const {
 
 void BlowfishEncoder::DecodeCBC(char *buffer, size_t size) const {
   const size_t numblocks = CheckInputs(buffer, size);
-  uint64 currentVector = pi->eVector;
-  uint64 lastVector = 0;
   uint64 *curBuffer = reinterpret_cast<uint64 *>(buffer);
-
-  for (size_t b = 0; b < numblocks; b++) {
-    auto &chunk = curBuffer[b];
-    lastVector = chunk;
-    pi->DecodeBlock(chunk);
-    chunk ^= currentVector;
-    currentVector = lastVector;
+  const size_t numTasks = BFNumTasks(numblocks);
+  const size_t taskBlocks = numTasks ? (numblocks + numTasks - 1) / numTasks : 0;
+  std::vector<uint64> vectors{pi->eVector};
+
+  // Every range needs last ciphertext block of previous range as a vector,
+  // collect them before any range is decoded
+  for (size_t t = 1; t < numTasks; t++) {
+    vectors.push_back(curBuffer[t * taskBlocks - 1]);
   }
+
+  BFRunRanges(numblocks, numTasks, [&](size_t begin, size_t count,
+                                       size_t index) {
+    uint64 *blocks = curBuffer + begin;
+    uint64 currentVector = vectors[index];
+    uint64 cipher[256];
+
+    for (size_t b = 0; b < count; b += std::size(cipher)) {
+      const size_t numBatch = std::min(std::size(cipher), count - b);
+      memcpy(cipher, blocks + b, numBatch * sizeof(uint64));
+      pi->DecodeBlocks(blocks + b, numBatch);
+      blocks[b] ^= currentVector;
+
+      for (size_t i = 1; i < numBatch; i++) {
+        blocks[b + i] ^= cipher[i - 1];
+      }
+
+      currentVector = cipher[numBatch - 1];
+    }
+  });
 }
 
 void BlowfishEncoder::EncodePCBC(char *buffer, size_t size) const {
@@ -521,6 +640,8 @@ void BlowfishEncoder::SetKey(std::string_view key) {
 class BlowfishContext2 : public BlowfishContext {
   void EncodeBlock(uint64 &block) const override;
   void DecodeBlock(uint64 &block) const override;
+  void EncodeBlocks(uint64 *blocks, size_t numBlocks) const override;
+  void DecodeBlocks(uint64 *blocks, size_t numBlocks) const override;
 };
 
 BlowfishEncoder2::BlowfishEncoder2() : BlowfishEncoder(new BlowfishContext2) {}
@@ -579,6 +700,14 @@ void BlowfishContext2::DecodeBlock(uint64 &block) const {
   std::swap(_val0, _val1);
 }
 
+void BlowfishContext2::EncodeBlocks(uint64 *blocks, size_t numBlocks) const {
+  BFProcessBlocks<true, false>(pboxes, sboxes, blocks, numBlocks);
+}
+
+void BlowfishContext2::DecodeBlocks(uint64 *blocks, size_t numBlocks) const {
+  BFProcessBlocks<true, true>(pboxes, sboxes, blocks, numBlocks);
+}
+
 void BlowfishEncoder2::SetKey(std::string_view key) {
   if (static_cast<bool>(mode)) {
     pi->CreateVector();
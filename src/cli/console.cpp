@@ -147,6 +147,8 @@ void MakeLogger() {
   bool mustClear = false;
 
   while (!stopLogger) {
+    es::print::DrainQueues();
+
     if (mustClear) {
       es::Print("\033[J");
       mustClear = false;
@@ -256,6 +258,8 @@ void TerminateConsoleDontWait() {
     logger.join();
   }
 
+  es::print::SetAsyncDrain(false);
+
   es::Print("\033[?25h"); // Enable cursor
 }
 
@@ -281,6 +285,7 @@ const char *SignalName(int sig) {
 void InitConsole() {
   es::Print("\033[?25l"); // Disable cursor
   es::print::AddQueuer(ReceiveQueue);
+  es::print::SetAsyncDrain(true);
   logger = std::thread{MakeLogger};
   pthread_setname_np(logger.native_handle(), "console_logger");
   auto terminate = [](int sig) {
@@ -304,13 +309,19 @@ void InitConsole() {
 }
 
 void TerminateConsole() {
-  while (!messageQueues[0].empty() && !messageQueues[1].empty()) {
+  es::print::DrainQueues();
+
+  while (logger.joinable() &&
+         (!messageQueues[0].empty() || !messageQueues[1].empty())) {
+    std::this_thread::yield();
   }
 
   TerminateConsoleDontWait();
 }
 
 void ConsolePrintDetail(uint8 detail) {
+  // Lines sent so far must keep previous detail
+  es::print::DrainQueues();
   newPrintDetailSince = messageQueues[currentlyUsedMessageQueue].size();
   uint8 oldDetail = printDetail;
   printDetail = detail | oldDetail << 4;
@@ -0,0 +1,433 @@
+/*  Spike is universal dedicated module handler
+    This source contains daemon mode
+
+    Copyright 2024 Lukas Cone
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "daemon.hpp"
+#include "spike/master_printer.hpp"
+
+#if defined(_MSC_VER) || defined(__MINGW64__)
+std::string DaemonSocketPath(const std::string &) { return {}; }
+
+int RunDaemon(const std::string &, const TCHAR *, daemon_job) {
+  printerror("Daemon mode is not supported on this platform.");
+  return 1;
+}
+
+int SubmitJob(const std::string &, int, TCHAR *[]) {
+  printerror("Daemon mode is not supported on this platform.");
+  return 1;
+}
+#else
+#include "spike/app/context.hpp"
+#include "spike/app/out_context.hpp"
+#include "spike/except.hpp"
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+
+static constexpr size_t RESIDENT_MODULES = 16;
+static constexpr size_t RESIDENT_MOUNTS = 64;
+// Request limits, guards against garbage sent to socket
+static constexpr uint32 MAX_REQUEST_ITEMS = 0x10000;
+static constexpr uint32 MAX_REQUEST_ITEM_SIZE = 0x100000;
+// Last frame of every job, other frame types are MPType of log line
+static constexpr uint8 FRAME_EXIT = 0xff;
+// Stalled client must not block daemon
+static constexpr timeval RECEIVE_TIMEOUT{10, 0};
+static constexpr timeval SEND_TIMEOUT{30, 0};
+
+static bool SendAll(int fd, const void *data, size_t size) {
+  auto cursor = static_cast<const char *>(data);
+
+  while (size > 0) {
+    const ssize_t numSent = ::send(fd, cursor, size, MSG_NOSIGNAL);
+
+    if (numSent < 0 && errno == EINTR) {
+      continue;
+    } else if (numSent <= 0) {
+      return false;
+    }
+
+    cursor += numSent;
+    size -= numSent;
+  }
+
+  return true;
+}
+
+static bool ReceiveAll(int fd, void *data, size_t size) {
+  auto cursor = static_cast<char *>(data);
+
+  while (size > 0) {
+    const ssize_t numReceived = ::recv(fd, cursor, size, 0);
+
+    if (numReceived < 0 && errno == EINTR) {
+      continue;
+    } else if (numReceived <= 0) {
+      return false;
+    }
+
+    cursor += numReceived;
+    size -= numReceived;
+  }
+
+  return true;
+}
+
+static bool SendString(int fd, std::string_view str) {
+  const uint32 size = str.size();
+  return SendAll(fd, &size, sizeof(size)) &&
+         SendAll(fd, str.data(), str.size());
+}
+
+static bool SendFrame(int fd, uint8 type, std::string_view payload) {
+  return SendAll(fd, &type, sizeof(type)) && SendString(fd, payload);
+}
+
+static bool ReceiveString(int fd, std::string &str, uint32 limit) {
+  uint32 size;
+
+  if (!ReceiveAll(fd, &size, sizeof(size)) || size > limit) {
+    return false;
+  }
+
+  str.resize(size);
+  return ReceiveAll(fd, str.data(), size);
+}
+
+// Request is [cwd, args...]
+static std::optional<std::vector<std::string>> ReceiveRequest(int fd) {
+  uint32 numItems;
+
+  if (!ReceiveAll(fd, &numItems, sizeof(numItems)) || numItems < 2 ||
+      numItems > MAX_REQUEST_ITEMS) {
+    return std::nullopt;
+  }
+
+  std::vector<std::string> items(numItems);
+
+  for (auto &item : items) {
+    if (!ReceiveString(fd, item, MAX_REQUEST_ITEM_SIZE)) {
+      return std::nullopt;
+    }
+  }
+
+  return items;
+}
+
+static sockaddr_un SocketAddress(const std::string &path) {
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+
+  if (path.size() >= sizeof(addr.sun_path)) {
+    throw es::FileInvalidAccessError(path);
+  }
+
+  memcpy(addr.sun_path, path.data(), path.size());
+  return addr;
+}
+
+// Only processes of the same user are allowed on the other end
+static bool IsSameUser(int fd) {
+#ifdef SO_PEERCRED
+  ucred cred{};
+  socklen_t credSize = sizeof(cred);
+
+  if (::getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &credSize)) {
+    return false;
+  }
+
+  return cred.uid == ::getuid();
+#else
+  uid_t uid;
+  gid_t gid;
+  return !::getpeereid(fd, &uid, &gid) && uid == ::getuid();
+#endif
+}
+
+// Socket folder must be private, otherwise other users could replace socket
+static bool IsPrivateFolder(const std::string &socketPath, bool create) {
+  std::string folder =
+      std::filesystem::path(socketPath).parent_path().string();
+
+  if (folder.empty()) {
+    folder = ".";
+  }
+
+  if (create) {
+    ::mkdir(folder.c_str(), 0700);
+  }
+
+  struct stat info;
+
+  if (::lstat(folder.c_str(), &info) || !S_ISDIR(info.st_mode) ||
+      info.st_uid != ::getuid() || (info.st_mode & 077)) {
+    printerror("Daemon socket folder must be directory accessible only by "
+               "current user: "
+               << folder);
+    return false;
+  }
+
+  return true;
+}
+
+static int Connect(const std::string &path) {
+  const sockaddr_un addr = SocketAddress(path);
+  const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+  if (fd < 0) {
+    return -1;
+  }
+
+  if (::connect(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr))) {
+    ::close(fd);
+    return -1;
+  }
+
+  if (!IsSameUser(fd)) {
+    ::close(fd);
+    errno = EACCES;
+    return -1;
+  }
+
+  return fd;
+}
+
+// Client of running job, log lines are forwarded to it
+static std::mutex clientMutex;
+static int clientFd = -1;
+
+static void ForwardLine(const es::print::Queuer &que) {
+  std::lock_guard<std::mutex> lg(clientMutex);
+
+  if (clientFd >= 0 && !SendFrame(clientFd, uint8(que.type), que.payload)) {
+    // Client is gone, job is finished anyway
+    clientFd = -1;
+  }
+}
+
+std::string DaemonSocketPath(const std::string &appName) {
+  if (const char *path = std::getenv("SPIKE_DAEMON_SOCKET")) {
+    return path;
+  }
+
+  // Runtime folder is already private
+  if (const char *runtimeDir = std::getenv("XDG_RUNTIME_DIR")) {
+    return std::string(runtimeDir) + '/' + appName + ".sock";
+  }
+
+  return std::filesystem::temp_directory_path().string() + '/' + appName +
+         '-' + std::to_string(::getuid()) + "/daemon.sock";
+}
+
+static int RunRequest(std::vector<std::string> &request,
+                      const std::string &appPath, daemon_job job) {
+  std::string_view command(request.at(1));
+
+  if (command == "--daemon" || command == "--submit") {
+    printerror("Cannot submit " << command << " as daemon job.");
+    return 1;
+  }
+
+  std::error_code ec;
+  const auto daemonFolder = std::filesystem::current_path();
+  std::filesystem::current_path(request.front(), ec);
+
+  if (ec) {
+    printerror("Cannot enter job folder: " << request.front());
+    return 1;
+  }
+
+  std::vector<char *> args{const_cast<char *>(appPath.data())};
+
+  for (auto it = std::next(request.begin()); it != request.end(); it++) {
+    args.push_back(it->data());
+  }
+
+  args.push_back(nullptr);
+  int retVal = 1;
+
+  try {
+    retVal = job(int(args.size() - 1), args.data());
+  } catch (const std::exception &e) {
+    printerror(e.what());
+  }
+
+  std::filesystem::current_path(daemonFolder, ec);
+
+  return retVal;
+}
+
+int RunDaemon(const std::string &socketPath, const TCHAR *appPath,
+              daemon_job job) {
+  if (!IsPrivateFolder(socketPath, true)) {
+    return 1;
+  }
+
+  if (int fd = Connect(socketPath); fd >= 0) {
+    ::close(fd);
+    printerror("Daemon is already running on " << socketPath);
+    return 1;
+  }
+
+  const sockaddr_un addr = SocketAddress(socketPath);
+  const int server = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+  if (server < 0) {
+    printerror("Cannot create daemon socket: " << strerror(errno));
+    return 1;
+  }
+
+  // Leftover of killed daemon
+  ::unlink(socketPath.c_str());
+  const mode_t oldMask = ::umask(0077);
+  const int bindStatus = ::bind(
+      server, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr));
+  ::umask(oldMask);
+
+  if (bindStatus || ::listen(server, 16)) {
+    printerror("Cannot listen on " << socketPath << ": " << strerror(errno));
+    ::close(server);
+    return 1;
+  }
+
+  // Relative app path would break after job changes folder
+  const std::string absAppPath = std::filesystem::absolute(appPath).string();
+  const MainAppConfFriend defaultSettings = mainSettings;
+  SetResidentModules(RESIDENT_MODULES);
+  SetResidentMounts(RESIDENT_MOUNTS);
+  es::print::AddQueuer(ForwardLine);
+  printinfo("Daemon is listening on " << socketPath);
+
+  for (bool running = true; running;) {
+    const int client = ::accept(server, nullptr, nullptr);
+
+    if (client < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      printerror("Daemon socket failed: " << strerror(errno));
+      break;
+    }
+
+    // Jobs run with our permissions, only owner is allowed to submit them
+    if (!IsSameUser(client)) {
+      ::close(client);
+      continue;
+    }
+
+    ::setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &RECEIVE_TIMEOUT,
+                 sizeof(RECEIVE_TIMEOUT));
+    ::setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &SEND_TIMEOUT,
+                 sizeof(SEND_TIMEOUT));
+    auto request = ReceiveRequest(client);
+
+    if (!request) {
+      ::close(client);
+      continue;
+    }
+
+    int32 retVal = 0;
+
+    if (request->at(1) == "--stop-daemon") {
+      running = false;
+    } else {
+      {
+        std::lock_guard<std::mutex> lg(clientMutex);
+        clientFd = client;
+      }
+
+      mainSettings = defaultSettings;
+      cliSettings = {};
+      ResetDeduplication();
+      retVal = RunRequest(*request, absAppPath, job);
+      es::print::DrainQueues();
+
+      std::lock_guard<std::mutex> lg(clientMutex);
+      clientFd = -1;
+    }
+
+    SendFrame(client, FRAME_EXIT,
+              {reinterpret_cast<const char *>(&retVal), sizeof(retVal)});
+    ::close(client);
+  }
+
+  ::close(server);
+  ::unlink(socketPath.c_str());
+  SetResidentModules(0);
+  SetResidentMounts(0);
+
+  return 0;
+}
+
+int SubmitJob(const std::string &socketPath, int argc, TCHAR *argv[]) {
+  if (argc < 1) {
+    printerror("Expected job parameters.");
+    return 1;
+  }
+
+  if (!IsPrivateFolder(socketPath, false)) {
+    return 1;
+  }
+
+  const int fd = Connect(socketPath);
+
+  if (fd < 0) {
+    printerror("Cannot connect to daemon on " << socketPath << ": "
+                                              << strerror(errno));
+    return 1;
+  }
+
+  const uint32 numItems = argc + 1;
+  bool sent = SendAll(fd, &numItems, sizeof(numItems)) &&
+              SendString(fd, std::filesystem::current_path().string());
+
+  for (int a = 0; a < argc && sent; a++) {
+    sent = SendString(fd, argv[a]);
+  }
+
+  std::string payload;
+  uint8 type;
+
+  while (sent && ReceiveAll(fd, &type, sizeof(type)) &&
+         ReceiveString(fd, payload, MAX_REQUEST_ITEM_SIZE)) {
+    if (type == FRAME_EXIT) {
+      ::close(fd);
+      int32 retVal = 1;
+      memcpy(&retVal, payload.data(), std::min(payload.size(), sizeof(retVal)));
+      return retVal;
+    }
+
+    // Lines are already terminated
+    es::print::Get(es::print::MPType(type)) << payload;
+    es::print::FlushAll();
+  }
+
+  ::close(fd);
+  printerror("Daemon closed connection before job finished.");
+  return 1;
+}
+#endif
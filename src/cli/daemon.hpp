@@ -0,0 +1,31 @@
+/*  Spike is universal dedicated module handler
+    This source contains daemon mode
+
+    Copyright 2024 Lukas Cone
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#pragma once
+#include "spike/type/tchar.hpp"
+#include <string>
+
+using daemon_job = int (*)(int argc, TCHAR *argv[]);
+
+std::string DaemonSocketPath(const std::string &appName);
+// Serves submitted jobs one by one until --stop-daemon is submitted
+// Loaded modules and mapped archives are kept between jobs
+int RunDaemon(const std::string &socketPath, const TCHAR *appPath,
+              daemon_job job);
+// Runs job inside daemon, prints its log and returns its exit status
+int SubmitJob(const std::string &socketPath, int argc, TCHAR *argv[]);
@@ -16,16 +16,21 @@
     limitations under the License.
 */
 
+#include "daemon.hpp"
 #include "nlohmann/json.hpp"
 #include "project.h"
 #include "spike/app/batch.hpp"
 #include "spike/app/console.hpp"
+#include "spike/app/manifest.hpp"
+#include "spike/app/module_index.hpp"
+#include "spike/app/out_context.hpp"
 #include "spike/app/tmp_storage.hpp"
 #include "spike/io/binwritter.hpp"
 #include "spike/io/stat.hpp"
 #include "spike/master_printer.hpp"
 #include "spike/type/tchar.hpp"
 #include "spike/util/pugiex.hpp"
+#include "spike/util/trace.hpp"
 #include <thread>
 
 static const char appHeader0[] =
@@ -133,19 +138,14 @@ struct UILines {
   }
 };
 
+// Every module must be loaded to write its config, index only lists them
 bool ScanModules(const std::string &appFolder, const std::string &appName) {
-  DirectoryScanner sc;
-  sc.AddFilter(std::string_view(".spk$"));
-  sc.Scan(appFolder);
+  ModuleIndex index(appFolder, appName);
   bool isOkay = true;
 
-  for (auto &m : sc) {
+  for (auto &[modulePath, entry] : index.Entries()) {
     try {
-      AFileInfo modulePath(m);
-      auto moduleName = modulePath.GetFilename();
-      const size_t firstDotPos = moduleName.find_first_of('.');
-      std::string moduleNameStr(moduleName.substr(0, firstDotPos));
-      APPContext ctx(moduleNameStr.data(), appFolder, appName);
+      APPContext ctx(entry.name.data(), appFolder, appName);
       ctx.FromConfig();
     } catch (const std::exception &e) {
       printerror(e.what());
@@ -294,7 +294,8 @@ void MergePackModeBatch(Batch &batch, const std::string &folderPath,
   };
 }
 
-auto ExtractStatBatch(Batch &batch) {
+auto ExtractStatBatch(Batch &batch,
+                      std::shared_ptr<BatchManifest> manifest) {
   struct ExtractStatsMaker : ExtractStats {
     std::mutex mtx;
     LoadingBar *scanBar;
@@ -315,8 +316,12 @@ auto ExtractStatBatch(Batch &batch) {
   sharedData->scanBar =
       AppendNewLogLine<LoadingBar>("Processing extract stats.");
 
-  batch.forEachFile = [payload = sharedData,
-                       ctx = batch.ctx](AppContextShare *iCtx) {
+  batch.forEachFile = [payload = sharedData, ctx = batch.ctx,
+                       manifest](AppContextShare *iCtx) {
+    if (manifest && manifest->IsUpToDate(iCtx)) {
+      return;
+    }
+
     payload->Push(iCtx, ctx->ExtractStat(std::bind(
                             [&](size_t offset, size_t size) {
                               return iCtx->GetBuffer(size, offset);
@@ -327,14 +332,22 @@ auto ExtractStatBatch(Batch &batch) {
   return sharedData;
 }
 
-void ProcessBatch(Batch &batch, ExtractStats *stats) {
+void ProcessBatch(Batch &batch, ExtractStats *stats,
+                  std::shared_ptr<BatchManifest> manifest) {
   uint8 consoleDetail = 1 | uint8(batch.ctx->info->multithreaded) << 1;
   ConsolePrintDetail(consoleDetail);
   batch.forEachFile = [payload = std::make_shared<UILines>(*stats),
                        archiveFiles =
                            std::make_shared<decltype(stats->archiveFiles)>(
                                std::move(stats->archiveFiles)),
-                       ctx = batch.ctx](AppContextShare *iCtx) {
+                       ctx = batch.ctx, manifest](AppContextShare *iCtx) {
+    if (manifest && manifest->IsUpToDate(iCtx)) {
+      if (payload->totalProgress) {
+        (*payload->totalProgress)++;
+      }
+      return;
+    }
+
     auto currentBar = payload->ChooseBar();
     if (currentBar) {
       currentBar->ItemCount(archiveFiles->at(iCtx->Hash()));
@@ -350,27 +363,63 @@ void ProcessBatch(Batch &batch, ExtractStats *stats) {
       }
     };
 
-    printline("Processing: " << iCtx->FullPath());
-    ctx->ProcessFile(iCtx);
+    printthrottled("Processing: " << iCtx->FullPath());
+    {
+      TRACE_ZONE("ProcessFile");
+
+      if (manifest) {
+        iCtx->outputFiles.emplace();
+        iCtx->requestedFiles.emplace();
+      }
+
+      ctx->ProcessFile(iCtx);
+      ThreadScratch().Reset();
+
+      if (manifest) {
+        manifest->Record(iCtx);
+      }
+    }
     if (payload->totalProgress) {
       (*payload->totalProgress)++;
     }
   };
 }
 
-void ProcessBatch(Batch &batch, size_t numFiles) {
+void ProcessBatch(Batch &batch, size_t numFiles,
+                  std::shared_ptr<BatchManifest> manifest) {
   uint8 consoleDetail = 1 | uint8(batch.ctx->info->multithreaded) << 1;
   ConsolePrintDetail(consoleDetail);
   auto payload = std::make_shared<UILines>(numFiles);
-  batch.forEachFile = [payload = payload,
-                       ctx = batch.ctx](AppContextShare *iCtx) {
+  batch.forEachFile = [payload = payload, ctx = batch.ctx,
+                       manifest](AppContextShare *iCtx) {
+    if (manifest && manifest->IsUpToDate(iCtx)) {
+      if (payload->totalProgress) {
+        (*payload->totalProgress)++;
+      }
+      return;
+    }
+
     iCtx->forEachFile = [=] {
       if (payload->totalOutCount) {
         (*payload->totalOutCount)++;
       }
     };
-    printline("Processing: " << iCtx->FullPath());
-    ctx->ProcessFile(iCtx);
+    printthrottled("Processing: " << iCtx->FullPath());
+    {
+      TRACE_ZONE("ProcessFile");
+
+      if (manifest) {
+        iCtx->outputFiles.emplace();
+        iCtx->requestedFiles.emplace();
+      }
+
+      ctx->ProcessFile(iCtx);
+      ThreadScratch().Reset();
+
+      if (manifest) {
+        manifest->Record(iCtx);
+      }
+    }
     if (payload->totalProgress) {
       (*payload->totalProgress)++;
     }
@@ -387,6 +436,30 @@ void ProcessBatch(Batch &batch, size_t numFiles) {
   };
 }
 
+std::shared_ptr<BatchManifest> MakeManifest(const APPContext &ctx) {
+  if (!cliSettings.incremental || ctx.NewArchive) {
+    return nullptr;
+  }
+
+  return std::make_shared<BatchManifest>(
+      ctx.ManifestPath(), ctx.OutputFingerprint(), cliSettings.contentHash);
+}
+
+void FinishManifest(BatchManifest *manifest) {
+  if (!manifest) {
+    return;
+  }
+
+  manifest->Save();
+  printinfo("Skipped " << manifest->NumSkipped() << " up to date inputs.");
+}
+
+void PrintDeduplicated() {
+  if (const size_t savedBytes = DeduplicatedBytes(); savedBytes > 0) {
+    printinfo("Deduplication saved " << savedBytes << " bytes.");
+  }
+}
+
 int CreateContent(const std::string &moduleName, const std::string &appFolder,
                   const std::string &appName, APPContext &ctx) {
   try {
@@ -447,9 +520,11 @@ int LoadProject(const std::string &path, const std::string &appFolder,
 
   nlohmann::json inputs = project["inputs"];
 
+  es::trace::Enable(!cliSettings.trace.empty());
   InitTempStorage();
   ctx.SetupModule();
   std::unique_ptr<AppPackContext> archiveContext;
+  auto manifest = MakeManifest(ctx);
 
   {
     Batch batch(&ctx, ctx.info->multithreaded * 50);
@@ -463,7 +538,7 @@ int LoadProject(const std::string &path, const std::string &appFolder,
       MergePackModeBatch(batch, folder, archiveContext.get());
     } else {
       if (ctx.ExtractStat) {
-        auto stats = ExtractStatBatch(batch);
+        auto stats = ExtractStatBatch(batch, manifest);
         for (std::string input : inputs) {
           batch.AddFile(batchBase + input);
         }
@@ -471,9 +546,9 @@ int LoadProject(const std::string &path, const std::string &appFolder,
         batch.FinishBatch();
         batch.Clean();
         stats.get()->totalFiles += inputs.size();
-        ProcessBatch(batch, stats.get());
+        ProcessBatch(batch, stats.get(), manifest);
       } else {
-        ProcessBatch(batch, inputs.size());
+        ProcessBatch(batch, inputs.size(), manifest);
       }
     }
 
@@ -501,11 +576,15 @@ int LoadProject(const std::string &path, const std::string &appFolder,
     batch.FinishBatch();
   }
 
+  FinishManifest(manifest.get());
+
   if (archiveContext) {
     ConsolePrintDetail(1);
     archiveContext->Finish();
   }
 
+  PrintDeduplicated();
+
   if (ctx.FinishContext) {
     ctx.FinishContext();
   }
@@ -513,6 +592,61 @@ int LoadProject(const std::string &path, const std::string &appFolder,
   return 0;
 }
 
+int RunJob(int argc, TCHAR *argv[]);
+int Main(int argc, TCHAR *argv[]);
+
+// Files were passed without module, it's picked by input patterns
+// Only modules changed since last run are loaded to read them
+std::optional<int> DispatchInputs(int argc, TCHAR *argv[],
+                                  const std::string &appFolder,
+                                  const std::string &appName) {
+  ModuleIndex index(appFolder, appName);
+  const std::string firstInput = std::to_string(argv[1]);
+
+  if (std::any_of(index.Entries().begin(), index.Entries().end(),
+                  [&](auto &item) { return item.second.name == firstInput; })) {
+    return std::nullopt;
+  }
+
+  std::vector<std::string> candidates = index.Match(firstInput);
+
+  for (int a = 2; a < argc && !candidates.empty(); a++) {
+    const std::string input = std::to_string(argv[a]);
+
+    if (FileType(input) != FileType_e::File) {
+      continue;
+    }
+
+    const std::vector<std::string> matched = index.Match(input);
+    std::erase_if(candidates, [&](const std::string &item) {
+      return std::find(matched.begin(), matched.end(), item) == matched.end();
+    });
+  }
+
+  index.Save();
+
+  if (candidates.empty()) {
+    printerror("No module accepts " << firstInput);
+    return 1;
+  } else if (candidates.size() > 1) {
+    printerror("Inputs are accepted by multiple modules, specify one of them:");
+
+    for (auto &c : candidates) {
+      printline("  " << c);
+    }
+
+    return 1;
+  }
+
+  printinfo("Using module: " << candidates.front());
+  TSTRING moduleArg = ToTSTRING(candidates.front());
+  std::vector<TCHAR *> args{argv[0], moduleArg.data()};
+  args.insert(args.end(), argv + 1, argv + argc);
+  args.push_back(nullptr);
+
+  return Main(int(args.size() - 1), args.data());
+}
+
 int Main(int argc, TCHAR *argv[]) {
   ConsolePrintDetail(1);
   AFileInfo appLocation(std::to_string(*argv));
@@ -543,6 +677,14 @@ int Main(int argc, TCHAR *argv[]) {
     return 0;
   } else if (moduleName.ends_with(".json")) {
     return LoadProject(moduleName, appFolder, appName);
+  } else if (moduleName == "--daemon") {
+    return RunDaemon(DaemonSocketPath(appName), *argv, RunJob);
+  } else if (moduleName == "--submit") {
+    return SubmitJob(DaemonSocketPath(appName), argc - 2, argv + 2);
+  } else if (FileType(moduleName) == FileType_e::File) {
+    if (auto retVal = DispatchInputs(argc, argv, appFolder, appName)) {
+      return *retVal;
+    }
   }
 
   if (argc < 3) {
@@ -574,7 +716,9 @@ int Main(int argc, TCHAR *argv[]) {
       auto optStr = std::to_string(opt);
       std::string_view optsw(optStr);
 
-      if (optsw != "--out") {
+      // Options that don't affect module outputs keep config loaded
+      if (optsw != "--out" && optsw != "--incremental" &&
+          optsw != "--content-hash") {
         // We won't use config file, reset all booleans to false,
         // so we can properly use cli switches
         [&] {
@@ -611,8 +755,10 @@ int Main(int argc, TCHAR *argv[]) {
     ctx.FromConfig();
   }
 
+  es::trace::Enable(!cliSettings.trace.empty());
   InitTempStorage();
   ctx.SetupModule();
+  auto manifest = MakeManifest(ctx);
   {
     Batch batch(&ctx, ctx.info->multithreaded * 50);
 
@@ -620,7 +766,7 @@ int Main(int argc, TCHAR *argv[]) {
       PackModeBatch(batch);
     } else {
       if (ctx.ExtractStat) {
-        auto stats = ExtractStatBatch(batch);
+        auto stats = ExtractStatBatch(batch, manifest);
         for (int a = 2; a < argc; a++) {
           if (!markedFiles.at(a)) {
             continue;
@@ -631,9 +777,9 @@ int Main(int argc, TCHAR *argv[]) {
         batch.FinishBatch();
         batch.Clean();
         stats.get()->totalFiles += totalFiles;
-        ProcessBatch(batch, stats.get());
+        ProcessBatch(batch, stats.get(), manifest);
       } else {
-        ProcessBatch(batch, totalFiles);
+        ProcessBatch(batch, totalFiles, manifest);
       }
     }
 
@@ -647,6 +793,9 @@ int Main(int argc, TCHAR *argv[]) {
     batch.FinishBatch();
   }
 
+  FinishManifest(manifest.get());
+  PrintDeduplicated();
+
   if (ctx.FinishContext) {
     ctx.FinishContext();
   }
@@ -654,14 +803,27 @@ int Main(int argc, TCHAR *argv[]) {
   return 0;
 }
 
+// Single batch, daemon calls it for every submitted job
+int RunJob(int argc, TCHAR *argv[]) {
+  int retVal = Main(argc, argv);
+
+  CleanCurrentTempStorage();
+
+  if (es::trace::IsEnabled()) {
+    BinWritter_t<BinCoreOpenMode::Text> wr(cliSettings.trace);
+    es::trace::WriteChromeTrace(wr.BaseStream());
+    es::trace::PrintSummary();
+  }
+
+  return retVal;
+}
+
 int _tmain(int argc, TCHAR *argv[]) {
   es::SetupWinApiConsole();
   InitConsole();
   CleanTempStorages();
 
-  int retVal = Main(argc, argv);
-
-  CleanCurrentTempStorage();
+  int retVal = RunJob(argc, argv);
 
 #ifndef NDEBUG
   auto cacheStats = CacheGenerator::GlobalMetrics();
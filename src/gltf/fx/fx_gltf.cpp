@@ -7,6 +7,7 @@
 // ------------------------------------------------------------
 
 #include "spike/gltf/gltf.h"
+#include "spike/io/stat.hpp"
 #include <fstream>
 #include <nlohmann/json.hpp>
 
@@ -47,7 +48,7 @@ namespace base64
         // clang-format on
     } // namespace detail
 
-    inline std::string Encode(std::vector<uint8_t> const & bytes)
+    inline std::string Encode(std::span<const uint8_t> bytes)
     {
         const std::size_t length = bytes.size();
         if (length == 0)
@@ -320,7 +321,7 @@ namespace gltf
 
     void Buffer::SetEmbeddedResource()
     {
-        uri = std::string(detail::MimetypeApplicationOctet).append(",").append(base64::Encode(data));
+        uri = std::string(detail::MimetypeApplicationOctet).append(",").append(base64::Encode(GetData()));
     }
 
     bool Image::IsEmbeddedResource() const noexcept
@@ -1190,6 +1191,7 @@ namespace gltf
             ReadQuotas readQuotas;
 
             std::vector<uint8_t> * binaryData{};
+            std::span<const uint8_t> mappedData{};
         };
 
         inline void ThrowIfBad(std::ios const & io)
@@ -1246,7 +1248,8 @@ namespace gltf
                     throw invalid_gltf_document("Invalid buffer.byteLength value : 0");
                 }
 
-                if (buffer.byteLength > dataContext.readQuotas.MaxBufferByteLength)
+                const bool isMapped = buffer.uri.empty() && !dataContext.mappedData.empty();
+                if (!isMapped && buffer.byteLength > dataContext.readQuotas.MaxBufferByteLength)
                 {
                     throw invalid_gltf_document("Quota exceeded : buffer.byteLength > MaxBufferByteLength");
                 }
@@ -1280,6 +1283,15 @@ namespace gltf
                     buffer.data.resize(buffer.byteLength);
                     std::memcpy(&buffer.data[0], &binary[0], buffer.byteLength);
                 }
+                else if (isMapped)
+                {
+                    if (dataContext.mappedData.size() < buffer.byteLength)
+                    {
+                        throw invalid_gltf_document("Invalid GLB buffer data");
+                    }
+
+                    buffer.mapped = dataContext.mappedData.first(buffer.byteLength);
+                }
             }
 
             return document;
@@ -1354,7 +1366,7 @@ namespace gltf
                 output.write(jsonText.c_str(), jsonText.length());
                 output.write(&spaces[0], headerPadding);
                 output.write(reinterpret_cast<char *>(&binHeader), detail::ChunkHeaderSize);
-                output.write(reinterpret_cast<char const *>(&binBuffer.data[0]), binBuffer.byteLength);
+                output.write(reinterpret_cast<char const *>(binBuffer.GetData().data()), binBuffer.byteLength);
                 output.write(&nulls[0], binPadding);
 
                 externalBufferIndex = 1;
@@ -1369,7 +1381,7 @@ namespace gltf
             for (; externalBufferIndex < document.buffers.size(); externalBufferIndex++)
             {
                 Buffer const & buffer = document.buffers[externalBufferIndex];
-                if (!buffer.IsEmbeddedResource() && !buffer.data.empty())
+                if (!buffer.IsEmbeddedResource() && !buffer.GetData().empty())
                 {
                     std::ofstream fileData(detail::CreateBufferUriPath(documentRootPath, buffer.uri), std::ios::binary);
                     if (!fileData.good())
@@ -1377,7 +1389,7 @@ namespace gltf
                         throw invalid_gltf_document("Invalid buffer.uri value", buffer.uri);
                     }
 
-                    fileData.write(reinterpret_cast<char const *>(&buffer.data[0]), buffer.byteLength);
+                    fileData.write(reinterpret_cast<char const *>(buffer.GetData().data()), buffer.byteLength);
                 }
             }
         }
@@ -1457,7 +1469,7 @@ namespace gltf
             for (size_t externalBufferIndex = 1; externalBufferIndex < document.buffers.size(); externalBufferIndex++)
             {
                 Buffer const & buffer = document.buffers[externalBufferIndex];
-                if (!buffer.IsEmbeddedResource() && !buffer.data.empty())
+                if (!buffer.IsEmbeddedResource() && !buffer.GetData().empty())
                 {
                     std::ofstream fileData(detail::CreateBufferUriPath(documentRootPath, buffer.uri), std::ios::binary);
                     if (!fileData.good())
@@ -1465,7 +1477,7 @@ namespace gltf
                         throw invalid_gltf_document("Invalid buffer.uri value", buffer.uri);
                     }
 
-                    fileData.write(reinterpret_cast<char const *>(&buffer.data[0]), buffer.byteLength);
+                    fileData.write(reinterpret_cast<char const *>(buffer.GetData().data()), buffer.byteLength);
                 }
             }
         }
@@ -1476,6 +1488,13 @@ namespace gltf
             Restream(output, input, document.buffers.front().byteLength);
             SaveStreamedFinish(document, output, state, documentRootPath);
         }
+
+        inline void SaveStreamed(Document const & document, std::ostream & output, std::string const & documentRootPath, std::span<const uint8_t> input)
+        {
+            auto state = SaveStreamedHeaders(document, output);
+            output.write(reinterpret_cast<char const *>(input.data()), document.buffers.front().byteLength);
+            SaveStreamedFinish(document, output, state, documentRootPath);
+        }
     } // namespace detail
 
     Document LoadFromText(std::istream & input, std::string const & documentRootPath, ReadQuotas const & readQuotas)
@@ -1583,6 +1602,89 @@ namespace gltf
         return LoadFromBinary(input, detail::GetDocumentRootPath(documentFilePath), readQuotas);
     }
 
+    Document LoadFromBinaryMapped(std::string const & documentFilePath, ReadQuotas const & readQuotas)
+    {
+        std::shared_ptr<es::MappedFile> mappedFile;
+
+        try
+        {
+            mappedFile = std::make_shared<es::MappedFile>(documentFilePath);
+        }
+        catch (...)
+        {
+            std::ifstream input(documentFilePath, std::ios::binary);
+            if (!input.is_open())
+            {
+                throw std::system_error(std::make_error_code(std::errc::no_such_file_or_directory));
+            }
+
+            // Empty file cannot be mapped
+            throw invalid_gltf_document("Invalid GLB header");
+        }
+
+        try
+        {
+            const std::span<const uint8_t> file(static_cast<const uint8_t *>(mappedFile->data), mappedFile->fileSize);
+            detail::GLBHeader header{};
+
+            if (file.size() < detail::HeaderSize)
+            {
+                throw invalid_gltf_document("Invalid GLB header");
+            }
+
+            std::memcpy(&header, file.data(), detail::HeaderSize);
+            if (header.magic != detail::GLBHeaderMagic ||
+                header.jsonHeader.chunkType != detail::GLBChunkJSON ||
+                header.jsonHeader.chunkLength + detail::HeaderSize > header.length ||
+                header.length > file.size())
+            {
+                throw invalid_gltf_document("Invalid GLB header");
+            }
+
+            if (header.jsonHeader.chunkLength > readQuotas.MaxFileSize)
+            {
+                throw invalid_gltf_document("Quota exceeded : file size > MaxFileSize");
+            }
+
+            const std::span<const uint8_t> json = file.subspan(detail::HeaderSize, header.jsonHeader.chunkLength);
+            std::size_t totalSize = detail::HeaderSize + header.jsonHeader.chunkLength;
+            detail::ChunkHeader binHeader{};
+
+            if (file.size() < totalSize + detail::ChunkHeaderSize)
+            {
+                throw invalid_gltf_document("Invalid GLB header");
+            }
+
+            std::memcpy(&binHeader, file.data() + totalSize, detail::ChunkHeaderSize);
+            totalSize += detail::ChunkHeaderSize;
+
+            if (binHeader.chunkType != detail::GLBChunkBIN || file.size() - totalSize < binHeader.chunkLength)
+            {
+                throw invalid_gltf_document("Invalid GLB header");
+            }
+
+            Document document = detail::Create(
+                nlohmann::json::parse(json.begin(), json.end()),
+                { detail::GetDocumentRootPath(documentFilePath), readQuotas, nullptr, file.subspan(totalSize, binHeader.chunkLength) });
+
+            document.mappedStorage = std::move(mappedFile);
+
+            return document;
+        }
+        catch (invalid_gltf_document &)
+        {
+            throw;
+        }
+        catch (std::system_error &)
+        {
+            throw;
+        }
+        catch (...)
+        {
+            std::throw_with_nested(invalid_gltf_document("Invalid glTF document. See nested exception for details."));
+        }
+    }
+
     void Save(Document const & document, std::ostream & output, std::string const & documentRootPath, bool useBinaryFormat)
     {
         try
@@ -1695,6 +1797,39 @@ namespace gltf
         }
     }
 
+    void StreamBinaryFull(Document & document, std::span<const uint8_t> input, std::ostream & output, const std::string & documentRootPath)
+    {
+        if (document.buffers.empty())
+        {
+            auto & buffer = document.buffers.emplace_back();
+            buffer.byteLength = input.size();
+        }
+
+        try
+        {
+            if (input.size() < document.buffers.front().byteLength)
+            {
+                throw invalid_gltf_document("Buffer size does not match number of bytes written!");
+            }
+
+            detail::ValidateBuffers(document, true, true);
+
+            detail::SaveStreamed(document, output, documentRootPath, input);
+        }
+        catch (invalid_gltf_document &)
+        {
+            throw;
+        }
+        catch (std::system_error &)
+        {
+            throw;
+        }
+        catch (...)
+        {
+            std::throw_with_nested(invalid_gltf_document("Invalid glTF document. See nested exception for details."));
+        }
+    }
+
     void StreamBinaryFinish(const Document & document, const StreamState & state, std::ostream & output, const std::string & documentRootPath)
     {
         try
@@ -1,10 +1,333 @@
 #include "spike/gltf.hpp"
 #include "spike/except.hpp"
+#include "spike/io/fileinfo.hpp"
+#include "spike/io/stat.hpp"
 #include "spike/uni//model.hpp"
 #include "spike/uni/motion.hpp"
 #include "spike/uni/rts.hpp"
 #include "spike/util/aabb.hpp"
 #include <algorithm>
+#include <cstring>
+
+GLTFStreamBuffer &GLTFStreamBuffer::operator=(GLTFStreamBuffer &&o) {
+  const size_t position = o.Tell();
+  const size_t readPosition = o.ReadTell();
+  spill.reset();
+
+  if (!spillPath.empty()) {
+    std::remove(spillPath.c_str());
+  }
+
+  memoryBudget = o.memoryBudget;
+  chunks = std::move(o.chunks);
+  spill = std::move(o.spill);
+  spillPath = std::move(o.spillPath);
+  numSpilled = o.numSpilled;
+  currentChunk = o.currentChunk;
+  size = std::max(o.size, position);
+  putSpilled = o.putSpilled;
+  putPosition = position;
+  SetGet(readPosition);
+
+  if (chunks.empty() || putSpilled) {
+    setp(nullptr, nullptr);
+  } else {
+    SetChunk(currentChunk, position - currentChunk * CHUNK_SIZE);
+  }
+
+  o.chunks.clear();
+  o.spillPath.clear();
+  o.numSpilled = 0;
+  o.currentChunk = 0;
+  o.size = 0;
+  o.putSpilled = false;
+  o.putPosition = 0;
+  o.setp(nullptr, nullptr);
+  o.SetGet(0);
+
+  return *this;
+}
+
+GLTFStreamBuffer::~GLTFStreamBuffer() {
+  spill.reset();
+
+  if (!spillPath.empty()) {
+    std::remove(spillPath.c_str());
+  }
+}
+
+size_t GLTFStreamBuffer::Tell() const {
+  if (putSpilled) {
+    return putPosition;
+  }
+
+  return currentChunk * CHUNK_SIZE + (pptr() - pbase());
+}
+
+size_t GLTFStreamBuffer::ReadTell() const {
+  return getBegin + (gptr() - eback());
+}
+
+size_t GLTFStreamBuffer::Size() const { return std::max(size, Tell()); }
+
+void GLTFStreamBuffer::SetGet(size_t position) {
+  getBegin = position;
+  setg(nullptr, nullptr, nullptr);
+}
+
+void GLTFStreamBuffer::SetChunk(size_t index, size_t offset) {
+  char *data = chunks.at(index).get();
+  currentChunk = index;
+  putSpilled = false;
+  setp(data, data + CHUNK_SIZE);
+  pbump(static_cast<int>(offset));
+}
+
+bool GLTFStreamBuffer::NextChunk() {
+  size = Size();
+
+  if (chunks.empty()) {
+    chunks.emplace_back(std::make_unique<char[]>(CHUNK_SIZE));
+    SetChunk(0, 0);
+    return true;
+  }
+
+  if (currentChunk + 1 == chunks.size()) {
+    chunks.emplace_back(std::make_unique<char[]>(CHUNK_SIZE));
+  }
+
+  SetChunk(currentChunk + 1, 0);
+  Spill();
+
+  return !spill || spill->good();
+}
+
+void GLTFStreamBuffer::Spill() {
+  while ((chunks.size() - numSpilled) * CHUNK_SIZE > memoryBudget &&
+         numSpilled < currentChunk) {
+    if (!spill) {
+      spillPath = es::GetTempFilename();
+      spill = std::make_unique<std::fstream>(
+          spillPath, std::ios::binary | std::ios::in | std::ios::out |
+                         std::ios::trunc);
+
+      if (spill->fail()) {
+        throw es::FileInvalidAccessError(spillPath);
+      }
+    }
+
+    char *chunk = chunks.at(numSpilled).get();
+
+    // Get area must not point into freed chunk
+    if (eback() == chunk) {
+      SetGet(ReadTell());
+    }
+
+    spill->seekp(numSpilled * CHUNK_SIZE);
+    spill->write(chunk, CHUNK_SIZE);
+    chunks.at(numSpilled).reset();
+    numSpilled++;
+  }
+}
+
+std::string_view
+GLTFStreamBuffer::Peek(size_t offset, size_t maxSize,
+                       std::unique_ptr<char[]> &scratch) const {
+  const size_t chunkIndex = offset / CHUNK_SIZE;
+  const size_t chunkOffset = offset % CHUNK_SIZE;
+  const size_t readSize = std::min(CHUNK_SIZE - chunkOffset, maxSize);
+
+  if (chunkIndex >= numSpilled) {
+    return {chunks.at(chunkIndex).get() + chunkOffset, readSize};
+  }
+
+  if (!scratch) {
+    scratch = std::make_unique<char[]>(CHUNK_SIZE);
+  }
+
+  spill->seekg(offset);
+  spill->read(scratch.get(), readSize);
+
+  if (spill->fail()) {
+    throw es::FileInvalidAccessError(spillPath);
+  }
+
+  return {scratch.get(), readSize};
+}
+
+void GLTFStreamBuffer::Write(size_t offset, const char *data, size_t numBytes) {
+  if (offset + numBytes > Size()) {
+    throw es::RuntimeError("Writing past GLTFStreamBuffer size");
+  }
+
+  // Get area copied from spilled chunk might be outdated
+  if (eback() && eback() == getScratch.get()) {
+    SetGet(ReadTell());
+  }
+
+  while (numBytes) {
+    const size_t chunkIndex = offset / CHUNK_SIZE;
+    const size_t chunkOffset = offset % CHUNK_SIZE;
+    const size_t toWrite = std::min(CHUNK_SIZE - chunkOffset, numBytes);
+
+    if (chunkIndex < numSpilled) {
+      spill->seekp(offset);
+      spill->write(data, toWrite);
+
+      if (spill->fail()) {
+        throw es::FileInvalidAccessError(spillPath);
+      }
+    } else {
+      memcpy(chunks.at(chunkIndex).get() + chunkOffset, data, toWrite);
+    }
+
+    offset += toWrite;
+    data += toWrite;
+    numBytes -= toWrite;
+  }
+}
+
+GLTFStreamBuffer::int_type GLTFStreamBuffer::overflow(int_type ch) {
+  if (traits_type::eq_int_type(ch, traits_type::eof())) {
+    return traits_type::not_eof(ch);
+  }
+
+  if (putSpilled) {
+    const char value = traits_type::to_char_type(ch);
+    return xsputn(&value, 1) ? ch : traits_type::eof();
+  }
+
+  if (!NextChunk()) {
+    return traits_type::eof();
+  }
+
+  *pptr() = traits_type::to_char_type(ch);
+  pbump(1);
+
+  return ch;
+}
+
+std::streamsize GLTFStreamBuffer::xsputn(const char *data,
+                                         std::streamsize numBytes) {
+  std::streamsize written = 0;
+
+  while (written < numBytes) {
+    if (putSpilled) {
+      const size_t spilledEnd = numSpilled * CHUNK_SIZE;
+      const size_t toWrite =
+          std::min<size_t>(spilledEnd - putPosition, numBytes - written);
+      Write(putPosition, data + written, toWrite);
+      putPosition += toWrite;
+      written += toWrite;
+
+      // Following chunk is always in memory
+      if (putPosition == spilledEnd) {
+        SetChunk(numSpilled, 0);
+      }
+
+      continue;
+    }
+
+    if (pptr() == epptr() && !NextChunk()) {
+      break;
+    }
+
+    const size_t toWrite =
+        std::min<size_t>(epptr() - pptr(), numBytes - written);
+    memcpy(pptr(), data + written, toWrite);
+    pbump(static_cast<int>(toWrite));
+    written += toWrite;
+  }
+
+  return written;
+}
+
+GLTFStreamBuffer::int_type GLTFStreamBuffer::underflow() {
+  const size_t position = ReadTell();
+  const size_t end = Size();
+
+  if (position >= end) {
+    return traits_type::eof();
+  }
+
+  const size_t chunkIndex = position / CHUNK_SIZE;
+  const size_t chunkBegin = chunkIndex * CHUNK_SIZE;
+  const size_t chunkEnd = std::min(chunkBegin + CHUNK_SIZE, end);
+
+  if (chunkIndex >= numSpilled) {
+    char *data = chunks.at(chunkIndex).get();
+    getBegin = chunkBegin;
+    setg(data, data + (position - chunkBegin), data + (chunkEnd - chunkBegin));
+  } else {
+    const size_t readSize =
+        Peek(position, chunkEnd - position, getScratch).size();
+    getBegin = position;
+    setg(getScratch.get(), getScratch.get(), getScratch.get() + readSize);
+  }
+
+  return traits_type::to_int_type(*gptr());
+}
+
+GLTFStreamBuffer::pos_type
+GLTFStreamBuffer::seekoff(off_type offset, std::ios_base::seekdir dir,
+                          std::ios_base::openmode mode) {
+  if (dir == std::ios_base::cur) {
+    const size_t current = mode & std::ios_base::out ? Tell() : ReadTell();
+
+    // tellg/tellp
+    if (!offset) {
+      return pos_type(off_type(current));
+    }
+
+    offset += current;
+  } else if (dir == std::ios_base::end) {
+    offset += Size();
+  }
+
+  return seekpos(offset, mode);
+}
+
+GLTFStreamBuffer::pos_type
+GLTFStreamBuffer::seekpos(pos_type pos, std::ios_base::openmode mode) {
+  const size_t position = pos;
+  size = Size();
+
+  if (!(mode & (std::ios_base::in | std::ios_base::out)) || pos < 0 ||
+      position > size) {
+    return pos_type(off_type(-1));
+  }
+
+  if (mode & std::ios_base::in) {
+    SetGet(position);
+  }
+
+  if (!(mode & std::ios_base::out) || position == Tell()) {
+    return pos;
+  }
+
+  size_t chunkIndex = position / CHUNK_SIZE;
+  size_t chunkOffset = position % CHUNK_SIZE;
+
+  if (chunkIndex == chunks.size()) {
+    chunkIndex--;
+    chunkOffset = CHUNK_SIZE;
+  }
+
+  if (chunkIndex < numSpilled) {
+    putSpilled = true;
+    putPosition = position;
+    setp(nullptr, nullptr);
+  } else {
+    SetChunk(chunkIndex, chunkOffset);
+  }
+
+  return pos;
+}
+
+GLTF::GLTF(const std::string &path)
+    : gltf::Document(AFileInfo(path).GetExtension() == ".gltf"
+                         ? gltf::LoadFromText(path)
+                         : gltf::LoadFromBinaryMapped(path)) {}
 
 void GLTF::FinishAndSave(BinWritterRef wr, const std::string &docPath) {
   size_t totalBufferSize = [&] {
@@ -43,30 +366,18 @@ void GLTF::FinishAndSave(BinWritterRef wr, const std::string &docPath) {
                                            totalBufferSize + inBufferSize);
 
     for (auto &a : buffers) {
-      wr.WriteContainer(a.data);
+      auto data = a.GetData();
+      wr.WriteBuffer(reinterpret_cast<const char *>(data.data()), data.size());
     }
 
     for (auto &a : streams) {
-      char buffer[0x80000];
-      const size_t numChunks = a.wr.Tell() / sizeof(buffer);
-      const size_t restBytes = a.wr.Tell() % sizeof(buffer);
-
-      for (size_t i = 0; i < numChunks; i++) {
-        a.str.read(buffer, sizeof(buffer));
-        wr.WriteBuffer(buffer, sizeof(buffer));
-      }
-
-      if (restBytes) {
-        a.str.read(buffer, restBytes);
-        wr.WriteBuffer(buffer, restBytes);
-      }
+      a.arena.WriteTo(wr);
     }
 
     gltf::StreamBinaryFinish(*this, state, wr.BaseStream(), docPath);
   } else {
-    std::stringstream str;
-    str << "empty";
-    gltf::StreamBinaryFull(*this, str, 6, wr.BaseStream(), docPath);
+    static const uint8_t empty[] = "empty";
+    gltf::StreamBinaryFull(*this, empty, wr.BaseStream(), docPath);
   }
 }
 
@@ -188,8 +499,18 @@ void GLTF::StripBuffers() {
       continue;
     }
 
-    std::string oldBuffer_(std::move(stream->str).str());
-    std::string_view oldBuffer(oldBuffer_);
+    // Distances of accessors from their segment begins, segments are moved
+    // along with accessors, so Merge can still replay them
+    std::vector<size_t> segmentOffsets;
+
+    for (auto &seg : stream->segments) {
+      segmentOffsets.push_back(accessors.at(seg.accessor).byteOffset -
+                               seg.begin);
+    }
+
+    GLTFStreamBuffer oldBuffer(std::move(stream->arena));
+    stream->arena = GLTFStreamBuffer(oldBuffer.memoryBudget);
+    stream->str.clear();
 
     uint32 currentOffset = 0;
     uint32 currentAccessor = 0;
@@ -208,20 +529,50 @@ void GLTF::StripBuffers() {
         if (acc.acc->max.size() > 0) {
           const size_t numElems = NumElements(*acc.acc);
           const size_t numItems = acc.acc->count * numElems;
+          const size_t accEnd = std::min<size_t>(acc.byteEnd, oldBuffer.Size());
 
-          auto ComputeMinMax = [&](auto data) {
-            using DataType = std::remove_pointer_t<decltype(data)>;
-            std::span<DataType> dataSpan(data, numItems);
+          // Reads accessor data straight from old buffer, components can be
+          // split between chunks
+          auto ComputeMinMax = [&](auto type) {
+            using DataType = decltype(type);
             const DataType MIN = std::numeric_limits<DataType>::lowest();
             const DataType MAX = std::numeric_limits<DataType>::max();
             DataType min[4]{MAX, MAX, MAX, MAX};
             DataType max[4]{MIN, MIN, MIN, MIN};
-
-            for (size_t i = 0; i < numItems; i++) {
-              const size_t idx = i % numElems;
-              min[idx] = std::min(min[idx], dataSpan[i]);
-              max[idx] = std::max(max[idx], dataSpan[i]);
-            }
+            char pending[sizeof(DataType)];
+            size_t numPending = 0;
+            size_t item = 0;
+
+            auto AddItem = [&](const char *data) {
+              DataType value;
+              memcpy(&value, data, sizeof(DataType));
+              const size_t idx = item++ % numElems;
+              min[idx] = std::min(min[idx], value);
+              max[idx] = std::max(max[idx], value);
+            };
+
+            const size_t readSize = std::min(accEnd - acc.byteBegin,
+                                             numItems * sizeof(DataType));
+            oldBuffer.Read(acc.byteBegin, readSize,
+                           [&](const char *data, size_t size) {
+                             for (; numPending && size; size--) {
+                               pending[numPending++] = *data++;
+
+                               if (numPending == sizeof(DataType)) {
+                                 AddItem(pending);
+                                 numPending = 0;
+                               }
+                             }
+
+                             for (; size >= sizeof(DataType);
+                                  size -= sizeof(DataType)) {
+                               AddItem(data);
+                               data += sizeof(DataType);
+                             }
+
+                             memcpy(pending, data, size);
+                             numPending = size;
+                           });
 
             acc.acc->max.clear();
             acc.acc->min.clear();
@@ -232,26 +583,24 @@ void GLTF::StripBuffers() {
             }
           };
 
-          char *bufData = oldBuffer_.data() + acc.byteBegin;
-
           switch (acc.acc->componentType) {
           case gltf::Accessor::ComponentType::Byte:
-            ComputeMinMax(reinterpret_cast<int8 *>(bufData));
+            ComputeMinMax(int8{});
             break;
           case gltf::Accessor::ComponentType::UnsignedByte:
-            ComputeMinMax(reinterpret_cast<uint8 *>(bufData));
+            ComputeMinMax(uint8{});
             break;
           case gltf::Accessor::ComponentType::Short:
-            ComputeMinMax(reinterpret_cast<int16 *>(bufData));
+            ComputeMinMax(int16{});
             break;
           case gltf::Accessor::ComponentType::UnsignedShort:
-            ComputeMinMax(reinterpret_cast<uint16 *>(bufData));
+            ComputeMinMax(uint16{});
             break;
           case gltf::Accessor::ComponentType::Float:
-            ComputeMinMax(reinterpret_cast<float *>(bufData));
+            ComputeMinMax(float{});
             break;
           case gltf::Accessor::ComponentType::UnsignedInt:
-            ComputeMinMax(reinterpret_cast<uint32 *>(bufData));
+            ComputeMinMax(uint32{});
             break;
           default:
             break;
@@ -261,13 +610,22 @@ void GLTF::StripBuffers() {
         currentAccessor++;
       }
 
-      stream->wr.WriteContainer(
-          oldBuffer.substr(currentOffset, m.byteBegin - currentOffset));
+      oldBuffer.Read(currentOffset, m.byteBegin - currentOffset,
+                     [&](const char *data, size_t size) {
+                       stream->wr.WriteBuffer(data, size);
+                     });
       stream->wr.ApplyPadding();
 
       currentOffset = m.byteEnd;
     }
 
+    for (size_t i = 0; i < stream->segments.size(); i++) {
+      GLTFStreamSegment &seg = stream->segments[i];
+      seg.begin = accessors.at(seg.accessor).byteOffset - segmentOffsets[i];
+      // Padding is already part of stripped data
+      seg.unpaddedBegin = seg.begin;
+    }
+
     /*while (currentAccessor < ranges.size()) {
       auto &acc = ranges.at(currentAccessor++);
       acc.acc->byteOffset -= currentOffset;
@@ -286,399 +644,724 @@ size_t GLTFModel::SaveIndices(const uni::IndexArray &idArray) {
       .accessorIndex;
 }
 
+static void IndexMinMax(std::span<const uint16> indices, uint32 &min,
+                        uint32 &max) {
+  const size_t numVectors = indices.size() / 8;
+  size_t i = 0;
+
+  if (numVectors) {
+    auto data = reinterpret_cast<const __m128i *>(indices.data());
+    __m128i vMin = _mm_set1_epi16(-1);
+    __m128i vMax = _mm_setzero_si128();
+
+    for (; i < numVectors; i++) {
+      const __m128i item = _mm_loadu_si128(data + i);
+      vMin = _mm_min_epu16(vMin, item);
+      vMax = _mm_max_epu16(vMax, item);
+    }
+
+    const __m128i allSet = _mm_set1_epi16(-1);
+    min = std::min(min, uint32(_mm_extract_epi16(_mm_minpos_epu16(vMin), 0)));
+    max = std::max(
+        max, uint32(uint16(~_mm_extract_epi16(
+                 _mm_minpos_epu16(_mm_xor_si128(vMax, allSet)), 0))));
+    i *= 8;
+  }
+
+  for (; i < indices.size(); i++) {
+    min = std::min(min, uint32(indices[i]));
+    max = std::max(max, uint32(indices[i]));
+  }
+}
+
+static uint32 HorizontalMin(__m128i value) {
+  value = _mm_min_epu32(value, _mm_shuffle_epi32(value, 0b01001110));
+  value = _mm_min_epu32(value, _mm_shuffle_epi32(value, 0b10110001));
+  return _mm_cvtsi128_si32(value);
+}
+
+static uint32 HorizontalMax(__m128i value) {
+  value = _mm_max_epu32(value, _mm_shuffle_epi32(value, 0b01001110));
+  value = _mm_max_epu32(value, _mm_shuffle_epi32(value, 0b10110001));
+  return _mm_cvtsi128_si32(value);
+}
+
+static void IndexMinMax(std::span<const uint32> indices, uint32 &min,
+                        uint32 &max) {
+  const size_t numVectors = indices.size() / 4;
+  size_t i = 0;
+
+  if (numVectors) {
+    auto data = reinterpret_cast<const __m128i *>(indices.data());
+    __m128i vMin = _mm_set1_epi32(-1);
+    __m128i vMax = _mm_setzero_si128();
+
+    for (; i < numVectors; i++) {
+      const __m128i item = _mm_loadu_si128(data + i);
+      vMin = _mm_min_epu32(vMin, item);
+      vMax = _mm_max_epu32(vMax, item);
+    }
+
+    min = std::min(min, HorizontalMin(vMin));
+    max = std::max(max, HorizontalMax(vMax));
+    i *= 4;
+  }
+
+  for (; i < indices.size(); i++) {
+    min = std::min(min, indices[i]);
+    max = std::max(max, indices[i]);
+  }
+}
+
+// Computes min/max and narrows to 16 bits in a single pass.
+// Returns false as soon as any index doesn't fit into 0xfffe.
+static bool NarrowIndices(std::span<const uint32> indices, uint16 *out,
+                          uint32 &min, uint32 &max) {
+  const size_t numVectors = indices.size() / 8;
+  auto data = reinterpret_cast<const __m128i *>(indices.data());
+  auto outData = reinterpret_cast<__m128i *>(out);
+  const __m128i limit = _mm_set1_epi32(0xfffe);
+  __m128i vMin = _mm_set1_epi32(-1);
+  __m128i vMax = _mm_setzero_si128();
+  size_t i = 0;
+
+  for (; i < numVectors; i++) {
+    const __m128i low = _mm_loadu_si128(data + i * 2);
+    const __m128i high = _mm_loadu_si128(data + i * 2 + 1);
+    vMin = _mm_min_epu32(vMin, _mm_min_epu32(low, high));
+    vMax = _mm_max_epu32(vMax, _mm_max_epu32(low, high));
+    const __m128i fits = _mm_cmpeq_epi32(_mm_max_epu32(vMax, limit), limit);
+
+    if (_mm_movemask_epi8(fits) != 0xffff) {
+      return false;
+    }
+
+    _mm_storeu_si128(outData + i, _mm_packus_epi32(low, high));
+  }
+
+  if (numVectors) {
+    min = std::min(min, HorizontalMin(vMin));
+    max = std::max(max, HorizontalMax(vMax));
+  }
+
+  for (i *= 8; i < indices.size(); i++) {
+    const uint32 item = indices[i];
+
+    if (item > 0xfffe) {
+      return false;
+    }
+
+    min = std::min(min, item);
+    max = std::max(max, item);
+    out[i] = item;
+  }
+
+  return true;
+}
+
+// Converts restart strip into degenerate one, copies runs between restarts
+// in bulk.
+template <class T>
+static void ConvertStrip(std::span<const T> indices, T reset,
+                         std::vector<T> &out) {
+  const size_t end = indices.size() - 1;
+  auto begin = indices.begin();
+  bool inverted = false;
+  out.reserve(indices.size() + indices.size() / 4);
+  out.push_back(indices[0]);
+  out.push_back(indices[1]);
+
+  for (size_t i = 2; i < end;) {
+    const size_t runEnd = std::find(begin + i, begin + end, reset) - begin;
+    out.insert(out.end(), begin + i, begin + runEnd);
+    inverted ^= (runEnd - i) & 1;
+    i = runEnd;
+
+    if (i >= end) {
+      break;
+    }
+
+    out.push_back(indices[i - 1]);
+
+    while (i < end && indices[i + 1] == reset) {
+      i++;
+    }
+
+    if (i >= end) {
+      break;
+    }
+
+    if (inverted) {
+      out.push_back(indices[i + 1]);
+      inverted = false;
+    }
+
+    out.push_back(indices[i + 1]);
+    i++;
+  }
+
+  if (indices.back() != reset) {
+    out.push_back(indices.back());
+  }
+}
+
 SavedIndices GLTFModel::SaveIndices(const void *data, size_t numIndices,
                                     size_t indexSize) {
   SavedIndices retVal{};
   auto &stream = GetIndexStream();
-  auto [acc, index] = NewAccessor(stream, indexSize);
+  auto [acc, index] = NewAccessor(stream, std::max(indexSize, size_t(2)));
   acc.type = gltf::Accessor::Type::Scalar;
   retVal.accessorIndex = index;
   retVal.minIndex = -1;
 
-  auto WriteIndex = [&retVal, &stream](auto value) {
-    stream.wr.Write(value);
-    retVal.maxIndex = std::max(retVal.maxIndex, uint32(value));
-    retVal.minIndex = std::min(retVal.minIndex, uint32(value));
+  auto WriteSpan = [&stream](auto indices) {
+    stream.wr.WriteBuffer(reinterpret_cast<const char *>(indices.data()),
+                          indices.size_bytes());
   };
 
-  auto Process = [&, &acc = acc](auto indices, uint32 reset) {
-    bool inverted = false;
-    WriteIndex(indices[0]);
-    WriteIndex(indices[1]);
-    acc.count = 2;
-
-    for (size_t i = 2; i < numIndices - 1; i++) {
-      auto item = indices[i];
-
-      if (item == reset) {
-        WriteIndex(indices[i - 1]);
-
-        while (i < numIndices - 1) {
-          if (indices[i + 1] != reset) {
-            break;
-          }
-
-          i++;
-        }
-
-        if (inverted) {
-          WriteIndex(indices[i + 1]);
-          acc.count++;
-          inverted = false;
-        }
-        WriteIndex(indices[i + 1]);
-        acc.count += 2;
-      } else {
-        WriteIndex(item);
-        acc.count++;
-        inverted = !inverted;
-      }
+  auto Process = [&, &acc = acc](auto indices, auto reset) {
+    using value_type = std::decay_t<decltype(reset)>;
+    uint32 min = -1;
+    uint32 max = 0;
+    IndexMinMax(indices, min, max);
+
+    // No restarts or no triangles, strip is written as is
+    if (max < reset || indices.size() < 3) {
+      acc.count = indices.size();
+      retVal.minIndex = min;
+      retVal.maxIndex = max;
+      WriteSpan(indices);
+      return;
     }
 
-    if (indices.back() != reset) {
-      WriteIndex(indices.back());
-      acc.count++;
-    }
+    std::vector<value_type> converted;
+    ConvertStrip(indices, reset, converted);
+    acc.count = converted.size();
+    std::span<const value_type> convertedSpan(converted);
+    IndexMinMax(convertedSpan, retVal.minIndex, retVal.maxIndex);
+    WriteSpan(convertedSpan);
   };
 
   if (indexSize == 4) {
     std::span<const uint32> indices(static_cast<const uint32 *>(data),
                                     numIndices);
-    bool as16bit = true;
-
-    for (uint32 i : indices) {
-      if (i > 0xfffe) {
-        as16bit = false;
-        break;
-      }
-    }
+    std::vector<uint16> narrowed(numIndices);
+    const bool as16bit = NarrowIndices(indices, narrowed.data(),
+                                       retVal.minIndex, retVal.maxIndex);
 
     acc.componentType = as16bit ? gltf::Accessor::ComponentType::UnsignedShort
                                 : gltf::Accessor::ComponentType::UnsignedInt;
 
     if (as16bit) {
       acc.count = numIndices;
-
-      for (uint16 i : indices) {
-        WriteIndex(i);
-      }
+      WriteSpan(std::span<const uint16>(narrowed));
     } else {
-      Process(indices, 0xffffffff);
+      retVal.minIndex = -1;
+      retVal.maxIndex = 0;
+      Process(indices, uint32(0xffffffff));
     }
+  } else if (indexSize == 1) {
+    // Widened to 16 bits, restart index is widened too
+    auto indices = static_cast<const uint8 *>(data);
+    std::vector<uint16> widened(indices, indices + numIndices);
+    std::replace(widened.begin(), widened.end(), uint16(0xff), uint16(0xffff));
+    acc.componentType = gltf::Accessor::ComponentType::UnsignedShort;
+    Process(std::span<const uint16>(widened), uint16(0xffff));
   } else {
     std::span<const uint16> indices(static_cast<const uint16 *>(data),
                                     numIndices);
     acc.componentType = gltf::Accessor::ComponentType::UnsignedShort;
-    Process(indices, 0xffff);
+    Process(indices, uint16(0xffff));
   }
 
   return retVal;
 }
 
-size_t WritePositions16s(GLTFModel &main,
-                         uni::FormatCodec::fvec &basePosition) {
+static constexpr int fmtStrides[]{0,  128, 96, 64, 64, 48, 32, 32, 32,
+                                  32, 32,  32, 24, 16, 16, 16, 16, 8};
+
+static constexpr size_t fmtNumElements[]{
+    0, 4, 3, 4, 2, 3, 1, 2, 4, 3, 4, 2, 3, 2, 1, 3, 4, 1,
+};
+
+// Feeds vertex writers with decoded vertices in fixed size chunks.
+// Walks either already sampled vertices or decodes them from vertex buffer.
+class VertexSource {
+public:
+  static constexpr size_t CHUNK_SIZE = 1024;
+
+  VertexSource(uni::FormatCodec::fvec &sampled)
+      : sampled(&sampled), numVertices(sampled.size()) {}
+
+  VertexSource(const char *data, size_t numVertices, Attribute attribute,
+               size_t stride, const es::Matrix44 *transform = nullptr)
+      : data(data), numVertices(numVertices), attribute(attribute),
+        stride(stride ? stride : fmtStrides[uint32(attribute.type)] / 8),
+        transform(transform) {}
+
+  size_t NumVertices() const { return numVertices; }
+
+  // Returns empty span when all vertices were processed
+  std::span<Vector4A16> Next() {
+    const size_t count = std::min(CHUNK_SIZE, numVertices - current);
+
+    if (!count) {
+      return {};
+    }
+
+    const size_t begin = current;
+    current += count;
+
+    if (sampled) {
+      return std::span<Vector4A16>(*sampled).subspan(begin, count);
+    }
+
+    const char *chunkData = data + begin * stride;
+    auto *customCodec = attribute.customCodec;
+
+    if (customCodec && customCodec->CanSample()) {
+      chunk.resize(count);
+      customCodec->Sample(chunk, chunkData, stride);
+    } else {
+      auto &codec = uni::FormatCodec::Get({attribute.format, attribute.type});
+      codec.Sample(chunk, chunkData, count, stride);
+    }
+
+    if (customCodec && customCodec->CanTransform()) {
+      customCodec->Transform(chunk);
+    }
+
+    if (transform) {
+      for (auto &v : chunk) {
+        v = v * *transform;
+      }
+    }
+
+    return chunk;
+  }
+
+private:
+  uni::FormatCodec::fvec *sampled = nullptr;
+  uni::FormatCodec::fvec chunk;
+  const char *data = nullptr;
+  size_t numVertices;
+  size_t current = 0;
+  Attribute attribute{};
+  size_t stride = 0;
+  const es::Matrix44 *transform = nullptr;
+};
+
+// Encodes every chunk of source into elementSize bytes per vertex and writes
+// whole chunks into stream.
+template <size_t elementSize, class Encoder>
+void WriteEncoded(GLTFStream &stream, VertexSource &source, Encoder encode) {
+  alignas(16) char buffer[VertexSource::CHUNK_SIZE * elementSize];
+
+  for (auto chunk = source.Next(); !chunk.empty(); chunk = source.Next()) {
+    char *out = buffer;
+
+    for (auto &v : chunk) {
+      encode(v, out);
+      out += elementSize;
+    }
+
+    stream.wr.WriteBuffer(buffer, out - buffer);
+  }
+}
+
+// Copies elementSize bytes of every vertex into stream without decoding.
+void WriteRaw(GLTFStream &stream, const char *data, size_t numVertices,
+              size_t stride, size_t elementSize) {
+  if (stride == elementSize) {
+    stream.wr.WriteBuffer(data, numVertices * elementSize);
+    return;
+  }
+
+  constexpr size_t CHUNK_SIZE = VertexSource::CHUNK_SIZE;
+  char buffer[CHUNK_SIZE * 16];
+
+  for (size_t v = 0; v < numVertices; v += CHUNK_SIZE) {
+    const size_t count = std::min(CHUNK_SIZE, numVertices - v);
+    char *out = buffer;
+
+    for (size_t i = 0; i < count; i++, data += stride, out += elementSize) {
+      memcpy(out, data, elementSize);
+    }
+
+    stream.wr.WriteBuffer(buffer, out - buffer);
+  }
+}
+
+// Same as static_cast<int16> or static_cast<uint16> of every lane
+static void StoreLow16(__m128 value, char *out) {
+  const __m128i shuffle =
+      _mm_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+  _mm_storel_epi64(reinterpret_cast<__m128i *>(out),
+                   _mm_shuffle_epi8(_mm_cvttps_epi32(value), shuffle));
+}
+
+// Same as static_cast<int16> or static_cast<uint16> of first 2 lanes
+static void StoreLow16x2(__m128 value, char *out) {
+  const __m128i shuffle =
+      _mm_setr_epi8(0, 1, 4, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+  const int32 packed =
+      _mm_cvtsi128_si32(_mm_shuffle_epi8(_mm_cvttps_epi32(value), shuffle));
+  memcpy(out, &packed, 4);
+}
+
+// Same as static_cast<int8> or static_cast<uint8> of every lane
+static void StoreLow8(__m128 value, char *out) {
+  const __m128i shuffle = _mm_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1,
+                                        -1, -1, -1, -1, -1, -1);
+  const int32 packed =
+      _mm_cvtsi128_si32(_mm_shuffle_epi8(_mm_cvttps_epi32(value), shuffle));
+  memcpy(out, &packed, 4);
+}
+
+static void SetBounds(gltf::Accessor &acc, __m128 min, __m128 max) {
+  const Vector4A16 vMin(min);
+  const Vector4A16 vMax(max);
+  acc.max.insert(acc.max.begin(), vMax._arr, vMax._arr + 3);
+  acc.min.insert(acc.min.begin(), vMin._arr, vMin._arr + 3);
+}
+
+size_t WritePositions16(GLTFModel &main, VertexSource source,
+                        gltf::Accessor::ComponentType componentType) {
   main.useMeshQuantize = true;
   auto &stream = main.GetVt8();
   auto [acc, index] = main.NewAccessor(stream, 4);
-  acc.count = basePosition.size();
+  acc.count = source.NumVertices();
   acc.type = gltf::Accessor::Type::Vec3;
   acc.normalized = true;
-  acc.componentType = gltf::Accessor::ComponentType::Short;
-  auto vertWr = stream.wr;
-  Vector4A16 min(FLT_MAX);
-  Vector4A16 max(-FLT_MAX);
+  acc.componentType = componentType;
+  __m128 min = _mm_set1_ps(FLT_MAX);
+  __m128 max = _mm_set1_ps(-FLT_MAX);
+  const __m128 scale = _mm_set1_ps(0x7fff);
 
-  for (auto &v : basePosition) {
-    v *= 0x7fff;
-    v = Vector4A16(_mm_round_ps(v._data, _MM_ROUND_NEAREST));
-    min = Vector4A16(_mm_min_ps(min._data, v._data));
-    max = Vector4A16(_mm_max_ps(max._data, v._data));
-    vertWr.Write(v.Convert<int16>());
-  }
+  WriteEncoded<8>(stream, source, [&](const Vector4A16 &v, char *out) {
+    const __m128 value =
+        _mm_round_ps(_mm_mul_ps(v._data, scale), _MM_ROUND_NEAREST);
+    min = _mm_min_ps(min, value);
+    max = _mm_max_ps(max, value);
+    StoreLow16(value, out);
+  });
 
-  acc.max.insert(acc.max.begin(), max._arr, max._arr + 3);
-  acc.min.insert(acc.min.begin(), min._arr, min._arr + 3);
+  SetBounds(acc, min, max);
 
   return index;
 }
 
-size_t WritePositions16u(GLTFModel &main,
-                         uni::FormatCodec::fvec &basePosition) {
-  main.useMeshQuantize = true;
-  auto &stream = main.GetVt8();
+size_t WritePositions16s(GLTFModel &main, VertexSource source) {
+  return WritePositions16(main, source, gltf::Accessor::ComponentType::Short);
+}
+
+size_t WritePositions16u(GLTFModel &main, VertexSource source) {
+  return WritePositions16(main, source,
+                          gltf::Accessor::ComponentType::UnsignedShort);
+}
+
+size_t WritePositions32(GLTFModel &main, VertexSource source) {
+  auto &stream = main.GetVt12();
   auto [acc, index] = main.NewAccessor(stream, 4);
-  acc.count = basePosition.size();
+  acc.count = source.NumVertices();
   acc.type = gltf::Accessor::Type::Vec3;
-  acc.normalized = true;
-  acc.componentType = gltf::Accessor::ComponentType::UnsignedShort;
-  auto vertWr = stream.wr;
-  Vector4A16 min(FLT_MAX);
-  Vector4A16 max(-FLT_MAX);
+  acc.componentType = gltf::Accessor::ComponentType::Float;
+  __m128 min = _mm_set1_ps(FLT_MAX);
+  __m128 max = _mm_set1_ps(-FLT_MAX);
 
-  for (auto &v : basePosition) {
-    v *= 0x7fff;
-    v = Vector4A16(_mm_round_ps(v._data, _MM_ROUND_NEAREST));
-    min = Vector4A16(_mm_min_ps(min._data, v._data));
-    max = Vector4A16(_mm_max_ps(max._data, v._data));
-    vertWr.Write(v.Convert<int16>());
-  }
+  WriteEncoded<12>(stream, source, [&](const Vector4A16 &v, char *out) {
+    min = _mm_min_ps(min, v._data);
+    max = _mm_max_ps(max, v._data);
+    memcpy(out, &v, 12);
+  });
 
-  acc.max.insert(acc.max.begin(), max._arr, max._arr + 3);
-  acc.min.insert(acc.min.begin(), min._arr, min._arr + 3);
+  SetBounds(acc, min, max);
 
   return index;
 }
 
-size_t WritePositions32(GLTFModel &main, uni::FormatCodec::fvec &basePosition) {
+// Writes float positions straight from vertex buffer
+size_t WritePositions32(GLTFModel &main, const char *data, size_t numVertices,
+                        size_t stride) {
   auto &stream = main.GetVt12();
   auto [acc, index] = main.NewAccessor(stream, 4);
-  acc.count = basePosition.size();
+  acc.count = numVertices;
   acc.type = gltf::Accessor::Type::Vec3;
   acc.componentType = gltf::Accessor::ComponentType::Float;
-  auto vertWr = stream.wr;
-  Vector4A16 min(FLT_MAX);
-  Vector4A16 max(-FLT_MAX);
-
-  for (auto &v : basePosition) {
-    min = Vector4A16(_mm_min_ps(min._data, v._data));
-    max = Vector4A16(_mm_max_ps(max._data, v._data));
-    vertWr.Write<Vector>(v);
+  __m128 min = _mm_set1_ps(FLT_MAX);
+  __m128 max = _mm_set1_ps(-FLT_MAX);
+
+  for (size_t v = 0; v < numVertices; v++) {
+    float value[4]{};
+    memcpy(value, data + v * stride, 12);
+    const __m128 position = _mm_loadu_ps(value);
+    min = _mm_min_ps(min, position);
+    max = _mm_max_ps(max, position);
   }
 
-  acc.max.insert(acc.max.begin(), max._arr, max._arr + 3);
-  acc.min.insert(acc.min.begin(), min._arr, min._arr + 3);
+  WriteRaw(stream, data, numVertices, stride, 12);
+  SetBounds(acc, min, max);
 
   return index;
 }
 
-size_t WriteNormals32(GLTFModel &main, uni::FormatCodec::fvec &normals) {
+size_t WriteNormals32(GLTFModel &main, VertexSource source) {
   auto &stream = main.GetVt12();
   auto [acc, index] = main.NewAccessor(stream, 4);
-  acc.count = normals.size();
+  acc.count = source.NumVertices();
   acc.type = gltf::Accessor::Type::Vec3;
   acc.componentType = gltf::Accessor::ComponentType::Float;
 
-  for (auto &v : normals) {
+  WriteEncoded<12>(stream, source, [](const Vector4A16 &v, char *out) {
     Vector4A16 pure = v * Vector4A16(1.f, 1.f, 1.f, 0.f);
     pure.Normalize();
-    stream.wr.Write<Vector>(pure);
-  }
+    memcpy(out, &pure, 12);
+  });
 
   return index;
 }
 
-size_t WriteTangents32(GLTFModel &main, uni::FormatCodec::fvec &tangents) {
+size_t WriteTangents32(GLTFModel &main, VertexSource source) {
   auto &stream = main.GetVt16();
   auto [acc, index] = main.NewAccessor(stream, 4);
-  acc.count = tangents.size();
+  acc.count = source.NumVertices();
   acc.type = gltf::Accessor::Type::Vec4;
   acc.componentType = gltf::Accessor::ComponentType::Float;
 
-  for (auto &v : tangents) {
+  WriteEncoded<16>(stream, source, [](const Vector4A16 &v, char *out) {
     Vector4A16 pure = v * Vector4A16(1.f, 1.f, 1.f, 0.f);
     pure.Normalize();
     pure.w = -1 + 2 * (v.w > 0);
-    stream.wr.Write(pure);
-  }
+    memcpy(out, &pure, 16);
+  });
 
   return index;
 }
 
-size_t WriteNormals16(GLTFModel &main, uni::FormatCodec::fvec &normals) {
+size_t WriteNormals16(GLTFModel &main, VertexSource source) {
   main.useMeshQuantize = true;
   auto &stream = main.GetVt8();
   auto [acc, index] = main.NewAccessor(stream, 4);
-  acc.count = normals.size();
+  acc.count = source.NumVertices();
   acc.type = gltf::Accessor::Type::Vec3;
   acc.normalized = true;
   acc.componentType = gltf::Accessor::ComponentType::Short;
 
-  for (auto &v : normals) {
+  WriteEncoded<8>(stream, source, [](const Vector4A16 &v, char *out) {
     auto pure = v * Vector4A16(1.f, 1.f, 1.f, 0.f);
     pure.Normalize() *= 0x7fff;
-    pure = _mm_round_ps(pure._data, _MM_ROUND_NEAREST);
-    auto comp = pure.Convert<int16>();
-    comp.w = 0x7fff + (v.w < 0);
-    stream.wr.Write(comp);
-  }
+    StoreLow16(_mm_round_ps(pure._data, _MM_ROUND_NEAREST), out);
+    const int16 w = 0x7fff + (v.w < 0);
+    memcpy(out + 6, &w, 2);
+  });
 
   return index;
 }
 
-size_t WriteNormals8(GLTFModel &main, uni::FormatCodec::fvec &normals) {
+size_t WriteNormals8(GLTFModel &main, VertexSource source) {
   main.useMeshQuantize = true;
   auto &stream = main.GetVt4();
   auto [acc, index] = main.NewAccessor(stream, 4);
-  acc.count = normals.size();
+  acc.count = source.NumVertices();
   acc.type = gltf::Accessor::Type::Vec3;
   acc.normalized = true;
   acc.componentType = gltf::Accessor::ComponentType::Byte;
 
-  for (auto &v : normals) {
+  WriteEncoded<4>(stream, source, [](const Vector4A16 &v, char *out) {
     auto pure = v * Vector4A16(1.f, 1.f, 1.f, 0.f);
     pure.Normalize() *= 0x7f;
-    pure = _mm_round_ps(pure._data, _MM_ROUND_NEAREST);
-    auto comp = pure.Convert<int8>();
-    comp.w = 0x7f + (v.w < 0);
-    stream.wr.Write(comp);
-  }
+    StoreLow8(_mm_round_ps(pure._data, _MM_ROUND_NEAREST), out);
+    out[3] = int8(0x7f + (v.w < 0));
+  });
 
   return index;
 }
 
-size_t WriteTexcoord16s(GLTFModel &main, uni::FormatCodec::fvec &coords) {
+size_t WriteTexcoord16s(GLTFModel &main, VertexSource source) {
   main.useMeshQuantize = true;
   auto &stream = main.GetVt4();
   auto [acc, index] = main.NewAccessor(stream, 4);
-  acc.count = coords.size();
+  acc.count = source.NumVertices();
   acc.type = gltf::Accessor::Type::Vec2;
   acc.normalized = true;
   acc.componentType = gltf::Accessor::ComponentType::Short;
-  auto vertWr = stream.wr;
+  const __m128 scale = _mm_set1_ps(0x7fff);
 
-  for (auto &v : coords) {
-    v *= 0x7fff;
-    v = Vector4A16(_mm_round_ps(v._data, _MM_ROUND_NEAREST));
-    SVector4 comp = v.Convert<int16>();
-    vertWr.Write(SVector2(comp));
-  }
+  WriteEncoded<4>(stream, source, [&](const Vector4A16 &v, char *out) {
+    StoreLow16x2(_mm_round_ps(_mm_mul_ps(v._data, scale), _MM_ROUND_NEAREST),
+                 out);
+  });
 
   return index;
 }
 
-size_t WriteTexcoord16u(GLTFModel &main, uni::FormatCodec::fvec &coords) {
+size_t WriteTexcoord16u(GLTFModel &main, VertexSource source) {
   auto &stream = main.GetVt4();
   auto [acc, index] = main.NewAccessor(stream, 4);
-  acc.count = coords.size();
+  acc.count = source.NumVertices();
   acc.type = gltf::Accessor::Type::Vec2;
   acc.normalized = true;
   acc.componentType = gltf::Accessor::ComponentType::UnsignedShort;
-  auto vertWr = stream.wr;
+  const __m128 scale = _mm_set1_ps(0xffff);
 
-  for (auto &v : coords) {
-    v *= 0xffff;
-    v = Vector4A16(_mm_round_ps(v._data, _MM_ROUND_NEAREST));
-    USVector4 comp = v.Convert<uint16>();
-    vertWr.Write(USVector2(comp));
-  }
+  WriteEncoded<4>(stream, source, [&](const Vector4A16 &v, char *out) {
+    StoreLow16x2(_mm_round_ps(_mm_mul_ps(v._data, scale), _MM_ROUND_NEAREST),
+                 out);
+  });
 
   return index;
 }
 
-size_t WriteTexcoord32(GLTFModel &main, uni::FormatCodec::fvec &coords) {
+size_t WriteTexcoord32(GLTFModel &main, VertexSource source) {
   auto &stream = main.GetVt8();
   auto [acc, index] = main.NewAccessor(stream, 4);
-  acc.count = coords.size();
+  acc.count = source.NumVertices();
   acc.type = gltf::Accessor::Type::Vec2;
   acc.componentType = gltf::Accessor::ComponentType::Float;
-  auto vertWr = stream.wr;
 
-  for (auto &v : coords) {
-    vertWr.Write<Vector2>(v);
+  WriteEncoded<8>(stream, source,
+                  [](const Vector4A16 &v, char *out) { memcpy(out, &v, 8); });
+
+  return index;
+}
+
+// Writes 16 bit texcoords straight from vertex buffer, decoding and encoding
+// them back is lossless
+size_t WriteTexcoord16(GLTFModel &main, const char *data, size_t numVertices,
+                       size_t stride,
+                       gltf::Accessor::ComponentType componentType) {
+  if (componentType == gltf::Accessor::ComponentType::Short) {
+    main.useMeshQuantize = true;
   }
 
+  auto &stream = main.GetVt4();
+  auto [acc, index] = main.NewAccessor(stream, 4);
+  acc.count = numVertices;
+  acc.type = gltf::Accessor::Type::Vec2;
+  acc.normalized = true;
+  acc.componentType = componentType;
+  WriteRaw(stream, data, numVertices, stride, 4);
+
   return index;
 }
 
-size_t WriteColor(GLTFModel &main, uni::FormatCodec::fvec &color) {
+// Writes float texcoords straight from vertex buffer
+size_t WriteTexcoord32(GLTFModel &main, const char *data, size_t numVertices,
+                       size_t stride) {
+  auto &stream = main.GetVt8();
+  auto [acc, index] = main.NewAccessor(stream, 4);
+  acc.count = numVertices;
+  acc.type = gltf::Accessor::Type::Vec2;
+  acc.componentType = gltf::Accessor::ComponentType::Float;
+  WriteRaw(stream, data, numVertices, stride, 8);
+
+  return index;
+}
+
+size_t WriteColor(GLTFModel &main, VertexSource source, bool alpha = false) {
   auto &stream = main.GetVt4();
   auto [acc, index] = main.NewAccessor(stream, 4);
-  acc.count = color.size();
+  acc.count = source.NumVertices();
   acc.componentType = gltf::Accessor::ComponentType::UnsignedByte;
   acc.normalized = true;
   acc.type = gltf::Accessor::Type::Vec4;
+  const __m128 scale = _mm_set1_ps(0xff);
 
-  for (auto &v : color) {
-    stream.wr.Write((v * 0xff).Convert<uint8>());
-  }
+  WriteEncoded<4>(stream, source, [&](const Vector4A16 &v, char *out) {
+    __m128 value = v._data;
+
+    if (alpha) {
+      value = _mm_shuffle_ps(value, value, 0);
+    }
+
+    StoreLow8(_mm_mul_ps(value, scale), out);
+  });
 
   return index;
 }
 
-uni::FormatCodec::fvec SampleAttribute(const char *data, size_t numVertices,
-                                       Attribute attribute, size_t stride) {
-  uni::FormatCodec::fvec retVal;
-  if (attribute.customCodec && attribute.customCodec->CanSample()) {
-    retVal.resize(numVertices);
-    attribute.customCodec->Sample(retVal, data, stride);
-  } else {
-    auto &codec = uni::FormatCodec::Get({attribute.format, attribute.type});
-    codec.Sample(retVal, data, numVertices, stride);
-  }
+// Writes 8 bit colors straight from vertex buffer, decoding and encoding
+// them back is lossless
+size_t WriteColor(GLTFModel &main, const char *data, size_t numVertices,
+                  size_t stride) {
+  auto &stream = main.GetVt4();
+  auto [acc, index] = main.NewAccessor(stream, 4);
+  acc.count = numVertices;
+  acc.componentType = gltf::Accessor::ComponentType::UnsignedByte;
+  acc.normalized = true;
+  acc.type = gltf::Accessor::Type::Vec4;
+  WriteRaw(stream, data, numVertices, stride, 4);
 
-  if (attribute.customCodec && attribute.customCodec->CanTransform()) {
-    attribute.customCodec->Transform(retVal);
-  }
+  return index;
+}
 
-  return retVal;
+// Whenever attribute can be copied without decoding
+static bool IsRaw(const Attribute &attribute, uni::FormatType format,
+                  uni::DataType type) {
+  return !attribute.customCodec && attribute.format == format &&
+         attribute.type == type;
 }
 
 size_t SavePositions(GLTFModel &main, const char *data, size_t numVertices,
                      Attribute attribute, size_t stride) {
-  uni::FormatCodec::fvec basePosition =
-      SampleAttribute(data, numVertices, attribute, stride);
+  const es::Matrix44 *transform =
+      main.transform ? &main.transform.value() : nullptr;
 
-  if (main.transform) {
-    for (auto &n : basePosition) {
-      n = n * *main.transform;
-    }
+  if (!transform && IsRaw(attribute, uni::FormatType::FLOAT,
+                          uni::DataType::R32G32B32)) {
+    return WritePositions32(main, data, numVertices, stride);
   }
 
+  VertexSource source(data, numVertices, attribute, stride, transform);
+
   if (!main.quantizeMesh ||
       (attribute.customCodec && !attribute.customCodec->IsNormalized())) {
-    return WritePositions32(main, basePosition);
+    return WritePositions32(main, source);
   }
 
   switch (attribute.format) {
   case uni::FormatType::NORM:
-    return WritePositions16s(main, basePosition);
+    return WritePositions16s(main, source);
   case uni::FormatType::UNORM:
-    return WritePositions16u(main, basePosition);
+    return WritePositions16u(main, source);
   default:
-    return WritePositions32(main, basePosition);
+    return WritePositions32(main, source);
   }
 }
 
 size_t SaveNormals(GLTFModel &main, const char *data, size_t numVertices,
                    Attribute attribute, size_t stride) {
-  uni::FormatCodec::fvec normals =
-      SampleAttribute(data, numVertices, attribute, stride);
-
-  if (main.transform) {
-    for (auto &n : normals) {
-      n = n * *main.transform;
-    }
-  }
+  VertexSource source(data, numVertices, attribute, stride,
+                      main.transform ? &main.transform.value() : nullptr);
 
   if (!main.quantizeMesh) {
-    return WriteNormals32(main, normals);
+    return WriteNormals32(main, source);
   }
 
   switch (attribute.type) {
   case uni::DataType::R8G8B8:
   case uni::DataType::R8G8B8A8:
   case uni::DataType::R5G6B5:
-    return WriteNormals8(main, normals);
+    return WriteNormals8(main, source);
   default:
-    return WriteNormals16(main, normals);
+    return WriteNormals16(main, source);
   }
 }
 
 size_t SaveTangents(GLTFModel &main, const char *data, size_t numVertices,
                     Attribute attribute, size_t stride) {
-  uni::FormatCodec::fvec tangents =
-      SampleAttribute(data, numVertices, attribute, stride);
+  VertexSource source(data, numVertices, attribute, stride);
 
   if (!main.quantizeMesh) {
-    return WriteTangents32(main, tangents);
+    return WriteTangents32(main, source);
   }
 
   size_t accIndex = [&] {
     switch (attribute.type) {
     case uni::DataType::R8G8B8A8:
-      return WriteNormals8(main, tangents);
+      return WriteNormals8(main, source);
     default:
-      return WriteNormals16(main, tangents);
+      return WriteNormals16(main, source);
     }
   }();
 
@@ -688,48 +1371,53 @@ size_t SaveTangents(GLTFModel &main, const char *data, size_t numVertices,
 
 size_t SaveTexcoords(GLTFModel &main, const char *data, size_t numVertices,
                      Attribute attribute, size_t stride) {
-  uni::FormatCodec::fvec coords =
-      SampleAttribute(data, numVertices, attribute, stride);
+  if (IsRaw(attribute, uni::FormatType::UNORM, uni::DataType::R16G16)) {
+    return WriteTexcoord16(main, data, numVertices, stride,
+                           gltf::Accessor::ComponentType::UnsignedShort);
+  }
+
+  if (main.quantizeMesh &&
+      IsRaw(attribute, uni::FormatType::NORM, uni::DataType::R16G16)) {
+    return WriteTexcoord16(main, data, numVertices, stride,
+                           gltf::Accessor::ComponentType::Short);
+  }
+
+  if (IsRaw(attribute, uni::FormatType::FLOAT, uni::DataType::R32G32)) {
+    return WriteTexcoord32(main, data, numVertices, stride);
+  }
+
+  VertexSource source(data, numVertices, attribute, stride);
 
   if (attribute.customCodec && !attribute.customCodec->IsNormalized()) {
-    return WriteTexcoord32(main, coords);
+    return WriteTexcoord32(main, source);
   }
 
   if (attribute.format == uni::FormatType::UNORM) {
-    return WriteTexcoord16u(main, coords);
+    return WriteTexcoord16u(main, source);
   }
 
   if (main.quantizeMesh && attribute.format == uni::FormatType::NORM) {
-    return WriteTexcoord16s(main, coords);
+    return WriteTexcoord16s(main, source);
   }
 
-  return WriteTexcoord32(main, coords);
+  return WriteTexcoord32(main, source);
 }
 
 size_t SaveColor(GLTFModel &main, const char *data, size_t numVertices,
                  Attribute attribute, size_t stride) {
-  uni::FormatCodec::fvec color =
-      SampleAttribute(data, numVertices, attribute, stride);
+  if (IsRaw(attribute, uni::FormatType::UNORM, uni::DataType::R8G8B8A8)) {
+    return WriteColor(main, data, numVertices, stride);
+  }
 
-  return WriteColor(main, color);
+  return WriteColor(main, VertexSource(data, numVertices, attribute, stride));
 }
 
 size_t SaveAlpha(GLTFModel &main, const char *data, size_t numVertices,
                  Attribute attribute, size_t stride) {
-  uni::FormatCodec::fvec color =
-      SampleAttribute(data, numVertices, attribute, stride);
-
-  for (auto &c : color) {
-    c.y = c.z = c.w = c.x;
-  }
-
-  return WriteColor(main, color);
+  return WriteColor(main, VertexSource(data, numVertices, attribute, stride),
+                    true);
 }
 
-static constexpr size_t fmtNumElements[]{
-    0, 4, 3, 4, 2, 3, 1, 2, 4, 3, 4, 2, 3, 2, 1, 3, 4, 1,
-};
-
 struct BWBuffer {
   uint8 data[8];
 };
@@ -743,12 +1431,27 @@ void SaveWeights(const char *data, size_t numVertices, Attribute attribute,
     throw es::RuntimeError("Too many bone weights for vertex, max is 8");
   }
 
-  uni::FormatCodec::fvec weights =
-      SampleAttribute(data, numVertices, attribute, stride);
+  auto *outBuffer = buffer.data();
+
+  if (IsRaw(attribute, uni::FormatType::UNORM, uni::DataType::R8G8B8A8)) {
+    if (!stride) {
+      stride = 4;
+    }
 
-  for (size_t index = 0; auto w : weights) {
-    UCVector4 wt((w * 0xff).Convert<uint8>());
-    memcpy(buffer.at(index++).data + usedBufferElements, &wt, numElements);
+    for (size_t v = 0; v < numVertices; v++, data += stride) {
+      memcpy(outBuffer[v].data + usedBufferElements, data, numElements);
+    }
+  } else {
+    VertexSource source(data, numVertices, attribute, stride);
+    const __m128 scale = _mm_set1_ps(0xff);
+
+    for (auto chunk = source.Next(); !chunk.empty(); chunk = source.Next()) {
+      for (auto &w : chunk) {
+        char wt[4];
+        StoreLow8(_mm_mul_ps(w._data, scale), wt);
+        memcpy(outBuffer++->data + usedBufferElements, wt, numElements);
+      }
+    }
   }
 
   usedBufferElements += numElements;
@@ -763,7 +1466,16 @@ void SaveBones(const char *data, size_t numVertices, Attribute attribute,
     throw es::RuntimeError("Too many bone weights for vertex, max is 8");
   }
 
-  if (attribute.format == uni::FormatType::UINT) {
+  if (attribute.format == uni::FormatType::UINT &&
+      attribute.type == uni::DataType::R8G8B8A8) {
+    if (!stride) {
+      stride = 4;
+    }
+
+    for (size_t v = 0; v < numVertices; v++, data += stride) {
+      memcpy(buffer[v].data + usedBufferElements, data, numElements);
+    }
+  } else if (attribute.format == uni::FormatType::UINT) {
     uni::FormatCodec::ivec bones;
     auto &codec = uni::FormatCodec::Get({attribute.format, attribute.type});
     codec.Sample(bones, data, numVertices, stride);
@@ -773,12 +1485,15 @@ void SaveBones(const char *data, size_t numVertices, Attribute attribute,
       memcpy(buffer.at(index++).data + usedBufferElements, &bn, numElements);
     }
   } else {
-    uni::FormatCodec::fvec bones =
-        SampleAttribute(data, numVertices, attribute, stride);
-
-    for (size_t index = 0; auto b : bones) {
-      UCVector4 bn(b.Convert<uint8>());
-      memcpy(buffer.at(index++).data + usedBufferElements, &bn, numElements);
+    VertexSource source(data, numVertices, attribute, stride);
+    auto *outBuffer = buffer.data();
+
+    for (auto chunk = source.Next(); !chunk.empty(); chunk = source.Next()) {
+      for (auto &b : chunk) {
+        char bn[4];
+        StoreLow8(b._data, bn);
+        memcpy(outBuffer++->data + usedBufferElements, bn, numElements);
+      }
     }
   }
 
@@ -886,8 +1601,6 @@ size_t GLTFModel::WriteNormals16(const uni::PrimitiveDescriptor &d,
 gltf::Attributes GLTFModel::SaveVertices(const void *data, size_t numVertices,
                                          std::span<const Attribute> attributes,
                                          size_t stride) {
-  static constexpr int fmtStrides[]{0,  128, 96, 64, 64, 48, 32, 32, 32,
-                                    32, 32,  32, 24, 16, 16, 16, 16, 8};
   int8 currentOffset = 0;
   uint32 coordIndex = 0;
   uint32 colorIndex = 0;
@@ -1038,10 +1751,17 @@ gltf::Attributes GLTFModel::SaveVertices(const void *data, size_t numVertices,
     acc.componentType = gltf::Accessor::ComponentType::UnsignedByte;
     acc.type = gltf::Accessor::Type::Vec4;
 
-    for (auto &b : bonesBuffer) {
-      stream.wr.WriteBuffer(reinterpret_cast<const char *>(b.data), 4);
-    }
+    auto WriteFirstHalf = [&stream](const std::vector<BWBuffer> &buffer) {
+      std::vector<uint32> packed(buffer.size());
 
+      for (size_t v = 0; v < buffer.size(); v++) {
+        memcpy(&packed[v], buffer[v].data, 4);
+      }
+
+      stream.wr.WriteContainer(packed);
+    };
+
+    WriteFirstHalf(bonesBuffer);
     attrs["JOINTS_0"] = index;
 
     auto [acc1, index1] = NewAccessor(stream, 4);
@@ -1051,13 +1771,9 @@ gltf::Attributes GLTFModel::SaveVertices(const void *data, size_t numVertices,
     acc1.type = gltf::Accessor::Type::Vec4;
 
     if (weightsBuffer.empty()) {
-      for (size_t v = 0; v < numVertices; v++) {
-        stream.wr.Write(0xff);
-      }
+      stream.wr.WriteContainer(std::vector<int>(numVertices, 0xff));
     } else {
-      for (auto &b : weightsBuffer) {
-        stream.wr.WriteBuffer(reinterpret_cast<const char *>(b.data), 4);
-      }
+      WriteFirstHalf(weightsBuffer);
     }
 
     attrs["WEIGHTS_0"] = index1;
@@ -1068,6 +1784,10 @@ gltf::Attributes GLTFModel::SaveVertices(const void *data, size_t numVertices,
 
 size_t GLTFModel::SaveVertices(const void *data, size_t numVertices,
                                Attribute attribute, size_t stride) {
+  if (!stride) {
+    stride = fmtStrides[uint32(attribute.type)] / 8;
+  }
+
   switch (attribute.usage) {
   case AttributeType::Position:
     return SavePositions(*this, static_cast<const char *>(data), numVertices,
@@ -1094,104 +1814,138 @@ size_t GLTFModel::SaveVertices(const void *data, size_t numVertices,
   return 0;
 }
 
-namespace gltfutils {
-std::vector<float> MakeSamples(float sampleRate, float duration) {
-  std::vector<float> times;
-  float cdur = 0;
-  const float fraction = 1.f / sampleRate;
+GLTFModel GLTFModel::Fork() const {
+  GLTFModel retVal;
+  retVal.transform = transform;
+  retVal.boneRemaps = boneRemaps;
+  retVal.quantizeMesh = quantizeMesh;
+  retVal.quantizeFake = quantizeFake;
+  retVal.streamMemoryBudget = streamMemoryBudget;
 
-  while (cdur < duration) {
-    times.push_back(cdur);
-    cdur += fraction;
-  }
+  return retVal;
+}
 
-  if (!fltcmp(times.back(), duration, fraction * 0.01f)) {
-    times.emplace_back(duration);
+size_t GLTFModel::Merge(GLTFModel &&fork) {
+  const size_t accessorBase = accessors.size();
+  std::vector<gltf::Accessor> forkAccessors = std::move(fork.accessors);
+  std::vector<int32> viewRemap(fork.bufferViews.size(), -1);
+
+  // Only stream data are merged, checked before anything is merged
+  for (size_t s = 0; s < fork.NumStreams(); s++) {
+    viewRemap.at(fork.Stream(s).index) = 0;
   }
-  return times;
-}
 
-StripResult StripValues(std::span<float> times, size_t upperLimit,
-                        const uni::MotionTrack *tck) {
-  StripResult retval;
-  retval.timeIndices.push_back(0);
-  Vector4A16 low, middle, high;
-  tck->GetValue(low, times[0]);
-  retval.values.push_back(low);
+  auto CheckView = [&](int64 view) {
+    if (view >= int64(viewRemap.size()) || viewRemap.at(view) < 0) {
+      throw es::RuntimeError(
+          "Cannot merge accessor with buffer view outside of fork's streams");
+    }
+  };
 
-  if (upperLimit == 1) {
-    return retval;
+  // Default scene is left out, it cannot hold anything without nodes
+  if (!fork.animations.empty() || !fork.cameras.empty() ||
+      !fork.images.empty() || !fork.materials.empty() ||
+      !fork.meshes.empty() || !fork.nodes.empty() || !fork.samplers.empty() ||
+      !fork.skins.empty() || !fork.textures.empty()) {
+    throw es::RuntimeError("Cannot merge fork with other data than accessors, "
+                           "forks may only write buffers");
   }
 
-  tck->GetValue(middle, times[1]);
+  for (auto &acc : forkAccessors) {
+    if (acc.bufferView >= 0) {
+      CheckView(acc.bufferView);
+    }
 
-  for (size_t i = 2; i < upperLimit; i++) {
-    tck->GetValue(high, times[i]);
+    if (!acc.sparse.empty()) {
+      CheckView(acc.sparse.indices.bufferView);
+      CheckView(acc.sparse.values.bufferView);
+    }
+  }
 
-    for (size_t p = 0; p < 4; p++) {
-      if (!fltcmp(low[p], high[p], 0.00001f)) {
-        auto ratio = (low[p] - middle[p]) / (low[p] - high[p]);
-        if (!fltcmp(ratio, 0.5f, 0.00001f)) {
-          retval.timeIndices.push_back(i - 1);
-          retval.values.push_back(middle);
-          break;
-        }
+  useMeshQuantize |= fork.useMeshQuantize;
+
+  for (size_t s = 0; s < fork.NumStreams(); s++) {
+    GLTFStream &source = fork.Stream(s);
+    GLTFStream &target = [&]() -> GLTFStream & {
+      const int32 slot = s;
+
+      if (slot == fork.indexStream) {
+        return GetIndexStream();
+      } else if (slot == fork.vt16Stream) {
+        return GetVt16();
+      } else if (slot == fork.vt12Stream) {
+        return GetVt12();
+      } else if (slot == fork.vt8Stream) {
+        return GetVt8();
+      } else if (slot == fork.vt4Stream) {
+        return GetVt4();
+      } else if (slot == fork.ibmStream) {
+        return SkinStream();
       }
+
+      auto &str = NewStream(source.name, source.byteStride);
+      str.target = source.target;
+      return str;
+    }();
+
+    viewRemap.at(source.index) = target.index;
+
+    // Replay accessor paddings relative to target's position
+    size_t copied = 0;
+    auto Copy = [&](size_t end) {
+      source.arena.Read(copied, end - copied,
+                        [&](const char *data, size_t size) {
+                          target.wr.WriteBuffer(data, size);
+                        });
+    };
+
+    for (auto &seg : source.segments) {
+      Copy(seg.unpaddedBegin);
+      const size_t unpaddedBegin = target.wr.Tell();
+      target.wr.ApplyPadding(seg.alignment);
+      const size_t begin = target.wr.Tell();
+      auto &acc = forkAccessors.at(seg.accessor);
+      acc.byteOffset = begin + (acc.byteOffset - seg.begin);
+      target.segments.push_back({unpaddedBegin, begin, seg.alignment,
+                                 accessorBase + seg.accessor});
+      copied = seg.begin;
     }
 
-    auto tmp = middle;
-    middle = high;
-    low = tmp;
+    Copy(source.arena.Size());
   }
 
-  if (middle != low) {
-    retval.timeIndices.push_back(upperLimit - 1);
-    retval.values.push_back(middle);
+  for (auto &acc : forkAccessors) {
+    if (acc.bufferView >= 0) {
+      acc.bufferView = viewRemap.at(acc.bufferView);
+    }
+
+    if (!acc.sparse.empty()) {
+      acc.sparse.indices.bufferView =
+          viewRemap.at(acc.sparse.indices.bufferView);
+      acc.sparse.values.bufferView = viewRemap.at(acc.sparse.values.bufferView);
+    }
+
+    accessors.emplace_back(std::move(acc));
   }
 
-  return retval;
+  return accessorBase;
 }
 
-class RTSHelper : public uni::MotionTrack {
-public:
-  const uni::MotionTrack *base;
-  TrackType_e mode;
-  TrackType_e TrackType() const override { return {}; }
-  size_t BoneIndex() const override { return {}; }
-  void GetValue(Vector4A16 &output, float time) const override {
-    uni::RTSValue value;
-    base->GetValue(value, time);
-
-    switch (mode) {
-    case Position:
-      output = value.translation;
-      break;
-    case Rotation:
-      output = value.rotation;
-      break;
-    case Scale:
-      output = value.scale;
-      break;
-    default:
-      break;
-    }
-  }
-};
+namespace gltfutils {
+std::vector<float> MakeSamples(float sampleRate, float duration) {
+  std::vector<float> times;
+  float cdur = 0;
+  const float fraction = 1.f / sampleRate;
 
-std::array<StripResult, 3> StripValuesBlock(std::span<float> times,
-                                            size_t upperLimit,
-                                            const uni::MotionTrack *tck) {
-  std::array<StripResult, 3> retVal;
-  RTSHelper helper;
-  helper.base = tck;
-  helper.mode = uni::MotionTrack::Position;
-  retVal[0] = StripValues(times, upperLimit, &helper);
-  helper.mode = uni::MotionTrack::Rotation;
-  retVal[1] = StripValues(times, upperLimit, &helper);
-  helper.mode = uni::MotionTrack::Scale;
-  retVal[2] = StripValues(times, upperLimit, &helper);
+  while (cdur < duration) {
+    times.push_back(cdur);
+    cdur += fraction;
+  }
 
-  return retVal;
+  if (!fltcmp(times.back(), duration, fraction * 0.01f)) {
+    times.emplace_back(duration);
+  }
+  return times;
 }
 
 size_t FindTimeEndIndex(std::span<float> times, float duration) {
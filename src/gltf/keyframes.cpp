@@ -0,0 +1,270 @@
+#include "spike/gltf.hpp"
+#include "spike/uni/motion.hpp"
+#include "spike/uni/rts.hpp"
+#include "spike/util/scratch.hpp"
+#include <cmath>
+
+namespace {
+// Below this angle slerp weights are replaced by (normalized) lerp ones
+constexpr float SLERP_THRESHOLD = 0.001f;
+
+// sin(x) for x in [0, pi/2], taylor series up to x^11
+__m128 Sin(__m128 x) {
+  const __m128 x2 = _mm_mul_ps(x, x);
+  __m128 r = _mm_set1_ps(-1.f / 39916800);
+  r = _mm_add_ps(_mm_mul_ps(r, x2), _mm_set1_ps(1.f / 362880));
+  r = _mm_add_ps(_mm_mul_ps(r, x2), _mm_set1_ps(-1.f / 5040));
+  r = _mm_add_ps(_mm_mul_ps(r, x2), _mm_set1_ps(1.f / 120));
+  r = _mm_add_ps(_mm_mul_ps(r, x2), _mm_set1_ps(-1.f / 6));
+  r = _mm_add_ps(_mm_mul_ps(r, x2), _mm_set1_ps(1.f));
+  return _mm_mul_ps(r, x);
+}
+
+__m128 Dot(const __m128 (&a)[4], const __m128 (&b)[4]) {
+  __m128 r = _mm_mul_ps(a[0], b[0]);
+  r = _mm_add_ps(r, _mm_mul_ps(a[1], b[1]));
+  r = _mm_add_ps(r, _mm_mul_ps(a[2], b[2]));
+  return _mm_add_ps(r, _mm_mul_ps(a[3], b[3]));
+}
+
+// Sampled track in SoA layout, 4 samples are evaluated at once
+class KeySamples {
+public:
+  KeySamples(std::span<const float> times_, std::span<const Vector4A16> values,
+             bool rotation_)
+      : rotation(rotation_), numSamples(times_.size()) {
+    // Padding for last block, MaxError can start at any sample
+    const size_t numAlloc = (numSamples + 6) & ~size_t(3);
+    times.assign(times_.begin(), times_.end());
+    times.resize(numAlloc, times_.back());
+
+    for (auto &c : comps) {
+      c.resize(numAlloc);
+    }
+
+    Vector4A16 prev = values.front();
+
+    for (size_t i = 0; i < numSamples; i++) {
+      Vector4A16 value = values[i];
+
+      // Keep all quaternions on the same hemisphere
+      if (rotation && value.Dot(prev) < 0) {
+        value = -value;
+      }
+
+      prev = value;
+
+      for (size_t c = 0; c < 4; c++) {
+        comps[c][i] = value[c];
+      }
+    }
+  }
+
+  Vector4A16 Value(size_t index) const {
+    return {comps[0][index], comps[1][index], comps[2][index],
+            comps[3][index]};
+  }
+
+  // Finds sample in [first, last) with the largest squared distance from
+  // value interpolated between a and b
+  std::pair<float, size_t> MaxError(size_t first, size_t last, size_t a,
+                                    size_t b) const {
+    Vector4A16 va = Value(a);
+    Vector4A16 vb = Value(b);
+    const float dt = times[b] - times[a];
+    float theta = 0;
+
+    if (rotation) {
+      float dot = va.Dot(vb);
+
+      // Shortest path
+      if (dot < 0) {
+        vb = -vb;
+        dot = -dot;
+      }
+
+      theta = std::acos(std::min(dot, 1.f));
+    }
+
+    const bool useSlerp = theta > SLERP_THRESHOLD;
+    const __m128 ta = _mm_set1_ps(times[a]);
+    const __m128 invDt = _mm_set1_ps(dt > 0 ? 1.f / dt : 0.f);
+    const __m128 vTheta = _mm_set1_ps(theta);
+    const __m128 invSin =
+        _mm_set1_ps(useSlerp ? 1.f / std::sin(theta) : 0.f);
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128 signMask = _mm_set1_ps(-0.f);
+    const __m128 keyA[4]{_mm_set1_ps(va.X), _mm_set1_ps(va.Y),
+                         _mm_set1_ps(va.Z), _mm_set1_ps(va.W)};
+    const __m128 keyB[4]{_mm_set1_ps(vb.X), _mm_set1_ps(vb.Y),
+                         _mm_set1_ps(vb.Z), _mm_set1_ps(vb.W)};
+    std::pair<float, size_t> retVal{-1.f, first};
+
+    for (size_t i = first; i < last; i += 4) {
+      const __m128 t =
+          _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(times.data() + i), ta), invDt);
+      __m128 wa = _mm_sub_ps(one, t);
+      __m128 wb = t;
+
+      if (useSlerp) {
+        wa = _mm_mul_ps(Sin(_mm_mul_ps(wa, vTheta)), invSin);
+        wb = _mm_mul_ps(Sin(_mm_mul_ps(wb, vTheta)), invSin);
+      }
+
+      __m128 interp[4];
+      __m128 sample[4];
+
+      for (size_t c = 0; c < 4; c++) {
+        interp[c] =
+            _mm_add_ps(_mm_mul_ps(keyA[c], wa), _mm_mul_ps(keyB[c], wb));
+        sample[c] = _mm_loadu_ps(comps[c].data() + i);
+      }
+
+      if (rotation) {
+        const __m128 invLen =
+            _mm_div_ps(one, _mm_sqrt_ps(Dot(interp, interp)));
+        const __m128 sign = _mm_and_ps(Dot(interp, sample), signMask);
+
+        for (auto &c : interp) {
+          c = _mm_xor_ps(_mm_mul_ps(c, invLen), sign);
+        }
+      }
+
+      for (size_t c = 0; c < 4; c++) {
+        sample[c] = _mm_sub_ps(sample[c], interp[c]);
+      }
+
+      alignas(16) float errors[4];
+      _mm_store_ps(errors, Dot(sample, sample));
+      const size_t numLanes = std::min(last - i, size_t(4));
+
+      for (size_t l = 0; l < numLanes; l++) {
+        if (errors[l] > retVal.first) {
+          retVal = {errors[l], i + l};
+        }
+      }
+    }
+
+    return retVal;
+  }
+
+  bool rotation;
+  size_t numSamples;
+  std::vector<float> times;
+  std::vector<float> comps[4];
+};
+} // namespace
+
+namespace gltfutils {
+StripResult ReduceKeys(std::span<const float> times,
+                       std::span<const Vector4A16> values, bool rotation,
+                       const KeyframeTolerance &tolerance) {
+  StripResult retVal;
+
+  if (times.empty()) {
+    return retVal;
+  }
+
+  KeySamples samples(times, values, rotation);
+  const size_t last = times.size() - 1;
+  // Rotations are compared by chord length between unit quaternions,
+  // which stays precise for tiny angles, unlike 1 - cos
+  const float maxError = rotation ? 2 * std::sin(tolerance.angular / 4)
+                                  : tolerance.linear;
+  const float maxError2 = maxError * maxError;
+  ScratchScope scope(ThreadScratch());
+  std::span<bool> keep = ThreadScratch().Allocate<bool>(times.size(), false);
+  keep.front() = true;
+
+  // Constant track, only a single key is needed
+  if (last == 0 || samples.MaxError(1, last + 1, 0, 0).first <= maxError2) {
+    retVal.timeIndices.push_back(0);
+    retVal.values.push_back(values.front());
+    return retVal;
+  }
+
+  keep.back() = true;
+  std::vector<std::pair<size_t, size_t>> segments{{0, last}};
+
+  while (!segments.empty()) {
+    auto [a, b] = segments.back();
+    segments.pop_back();
+
+    if (b - a < 2) {
+      continue;
+    }
+
+    auto [error, index] = samples.MaxError(a + 1, b, a, b);
+
+    if (error > maxError2) {
+      keep[index] = true;
+      segments.emplace_back(index, b);
+      segments.emplace_back(a, index);
+    }
+  }
+
+  for (size_t i = 0; i < keep.size(); i++) {
+    if (keep[i]) {
+      retVal.timeIndices.push_back(i);
+      retVal.values.push_back(samples.Value(i));
+    }
+  }
+
+  return retVal;
+}
+
+StripResult StripValues(std::span<float> times, size_t upperLimit,
+                        const uni::MotionTrack *tck,
+                        const KeyframeTolerance &tolerance) {
+  ScratchScope scope(ThreadScratch());
+  std::span<Vector4A16> values =
+      ThreadScratch().Allocate<Vector4A16>(upperLimit);
+
+  for (size_t i = 0; i < upperLimit; i++) {
+    tck->GetValue(values[i], times[i]);
+  }
+
+  return ReduceKeys(times.subspan(0, upperLimit), values,
+                    tck->TrackType() == uni::MotionTrack::Rotation, tolerance);
+}
+
+std::array<StripResult, 3>
+StripValuesBlock(std::span<float> times, size_t upperLimit,
+                 const uni::MotionTrack *tck,
+                 const KeyframeTolerance &tolerance) {
+  ScratchScope scope(ThreadScratch());
+  std::span<Vector4A16> values[3];
+
+  for (auto &v : values) {
+    v = ThreadScratch().Allocate<Vector4A16>(upperLimit);
+  }
+
+  for (size_t i = 0; i < upperLimit; i++) {
+    uni::RTSValue value;
+    tck->GetValue(value, times[i]);
+    values[0][i] = value.translation;
+    values[1][i] = value.rotation;
+    values[2][i] = value.scale;
+  }
+
+  std::span<const float> usedTimes = times.subspan(0, upperLimit);
+
+  return {
+      ReduceKeys(usedTimes, values[0], false, tolerance),
+      ReduceKeys(usedTimes, values[1], true, tolerance),
+      ReduceKeys(usedTimes, values[2], false, tolerance),
+  };
+}
+
+std::vector<StripResult> StripTracks(std::span<float> times, size_t upperLimit,
+                                     std::span<const uni::MotionTrack *> tracks,
+                                     const KeyframeTolerance &tolerance) {
+  std::vector<StripResult> retVal(tracks.size());
+
+  RunThreadedQueueEx(tracks.size(), [&](size_t index) {
+    retVal[index] = StripValues(times, upperLimit, tracks[index], tolerance);
+  });
+
+  return retVal;
+}
+} // namespace gltfutils
@@ -0,0 +1,480 @@
+#include "spike/except.hpp"
+#include "spike/gltf.hpp"
+#include "spike/util/scratch.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+
+namespace {
+// Forsyth's "Linear-Speed Vertex Cache Optimisation" constants
+constexpr size_t CACHE_SIZE = 32;
+constexpr float CACHE_DECAY_POWER = 1.5f;
+constexpr float LAST_TRI_SCORE = 0.75f;
+constexpr float VALENCE_BOOST_SCALE = 2.f;
+constexpr float VALENCE_BOOST_POWER = 0.5f;
+constexpr size_t MAX_VALENCE_TABLE = 64;
+constexpr uint32 NO_REMAP = -1;
+
+struct ScoreTable {
+  float cache[CACHE_SIZE];
+  float valence[MAX_VALENCE_TABLE];
+
+  ScoreTable() {
+    const float scaler = 1.f / (CACHE_SIZE - 3);
+
+    for (size_t i = 0; i < CACHE_SIZE; i++) {
+      cache[i] = i < 3 ? LAST_TRI_SCORE
+                       : std::pow(1.f - (i - 3) * scaler, CACHE_DECAY_POWER);
+    }
+
+    valence[0] = 0;
+
+    for (size_t i = 1; i < MAX_VALENCE_TABLE; i++) {
+      valence[i] =
+          VALENCE_BOOST_SCALE * std::pow(float(i), -VALENCE_BOOST_POWER);
+    }
+  }
+
+  float Score(int32 cachePosition, uint32 numActiveTris) const {
+    if (!numActiveTris) {
+      return -1.f;
+    }
+
+    float score = cachePosition < 0 ? 0.f : cache[cachePosition];
+
+    if (numActiveTris < MAX_VALENCE_TABLE) {
+      score += valence[numActiveTris];
+    } else {
+      score += VALENCE_BOOST_SCALE *
+               std::pow(float(numActiveTris), -VALENCE_BOOST_POWER);
+    }
+
+    return score;
+  }
+};
+
+size_t ComponentSize(gltf::Accessor::ComponentType type) {
+  switch (type) {
+  case gltf::Accessor::ComponentType::Byte:
+  case gltf::Accessor::ComponentType::UnsignedByte:
+    return 1;
+  case gltf::Accessor::ComponentType::Short:
+  case gltf::Accessor::ComponentType::UnsignedShort:
+    return 2;
+  case gltf::Accessor::ComponentType::Float:
+  case gltf::Accessor::ComponentType::UnsignedInt:
+    return 4;
+  default:
+    return 0;
+  }
+}
+
+size_t NumComponents(gltf::Accessor::Type type) {
+  switch (type) {
+  case gltf::Accessor::Type::Scalar:
+    return 1;
+  case gltf::Accessor::Type::Vec2:
+    return 2;
+  case gltf::Accessor::Type::Vec3:
+    return 3;
+  case gltf::Accessor::Type::Vec4:
+  case gltf::Accessor::Type::Mat2:
+    return 4;
+  case gltf::Accessor::Type::Mat3:
+    return 9;
+  case gltf::Accessor::Type::Mat4:
+    return 16;
+  default:
+    return 0;
+  }
+}
+
+// Converts triangle strip into list, degenerate triangles are skipped
+std::vector<uint32> StripToList(std::span<const uint32> strip) {
+  std::vector<uint32> retVal;
+
+  if (strip.size() < 3) {
+    return retVal;
+  }
+
+  retVal.reserve((strip.size() - 2) * 3);
+
+  for (size_t i = 0; i + 2 < strip.size(); i++) {
+    const uint32 a = strip[i];
+    const uint32 b = strip[i + 1 + (i & 1)];
+    const uint32 c = strip[i + 2 - (i & 1)];
+
+    if (a == b || b == c || a == c) {
+      continue;
+    }
+
+    retVal.insert(retVal.end(), {a, b, c});
+  }
+
+  return retVal;
+}
+} // namespace
+
+namespace gltfutils {
+size_t AnalyzeVertexCache(std::span<const uint32> indices, size_t numVertices,
+                          size_t cacheSize) {
+  std::vector<size_t> timestamps(numVertices, 0);
+  size_t time = cacheSize + 1;
+  size_t misses = 0;
+
+  for (uint32 i : indices) {
+    if (time - timestamps.at(i) > cacheSize) {
+      timestamps[i] = time++;
+      misses++;
+    }
+  }
+
+  return misses;
+}
+
+void OptimizeVertexCache(std::span<uint32> indices, size_t numVertices) {
+  const size_t numTris = indices.size() / 3;
+
+  if (numTris < 2) {
+    return;
+  }
+
+  static const ScoreTable scores;
+  ScratchArena &scratch = ThreadScratch();
+  ScratchScope scope(scratch);
+  std::span<uint32> source = scratch.Allocate<uint32>(numTris * 3);
+  std::copy_n(indices.begin(), source.size(), source.begin());
+  std::span<uint32> numActive = scratch.Allocate<uint32>(numVertices, 0);
+
+  for (uint32 i : source) {
+    if (i >= numVertices) {
+      throw std::out_of_range("Vertex index out of range");
+    }
+
+    numActive[i]++;
+  }
+
+  // Triangles adjacent to every vertex, active ones are kept at front
+  std::span<uint32> adjacencyBegin = scratch.Allocate<uint32>(numVertices + 1);
+  adjacencyBegin[0] = 0;
+
+  for (size_t v = 0; v < numVertices; v++) {
+    adjacencyBegin[v + 1] = adjacencyBegin[v] + numActive[v];
+  }
+
+  std::span<uint32> adjacency = scratch.Allocate<uint32>(source.size());
+
+  {
+    ScratchScope cursorScope(scratch);
+    std::span<uint32> cursor = scratch.Allocate<uint32>(numVertices);
+    std::copy_n(adjacencyBegin.begin(), numVertices, cursor.begin());
+
+    for (size_t i = 0; i < source.size(); i++) {
+      adjacency[cursor[source[i]]++] = i / 3;
+    }
+  }
+
+  std::span<int32> cachePosition = scratch.Allocate<int32>(numVertices, -1);
+  std::span<float> vertexScore = scratch.Allocate<float>(numVertices);
+  std::span<float> triScore = scratch.Allocate<float>(numTris);
+  std::span<bool> emitted = scratch.Allocate<bool>(numTris, false);
+
+  for (size_t v = 0; v < numVertices; v++) {
+    vertexScore[v] = scores.Score(-1, numActive[v]);
+  }
+
+  int64 bestTri = -1;
+  float bestScore = -1.f;
+
+  for (size_t t = 0; t < numTris; t++) {
+    triScore[t] = vertexScore[source[t * 3]] + vertexScore[source[t * 3 + 1]] +
+                  vertexScore[source[t * 3 + 2]];
+
+    if (triScore[t] > bestScore) {
+      bestScore = triScore[t];
+      bestTri = t;
+    }
+  }
+
+  uint32 cache[CACHE_SIZE + 3];
+  size_t cacheCount = 0;
+  size_t nextUnemitted = 0;
+
+  for (size_t o = 0; o < numTris; o++) {
+    if (bestTri < 0) {
+      while (emitted[nextUnemitted]) {
+        nextUnemitted++;
+      }
+
+      bestTri = nextUnemitted;
+    }
+
+    const uint32 *tri = source.data() + bestTri * 3;
+    emitted[bestTri] = true;
+    memcpy(indices.data() + o * 3, tri, sizeof(uint32) * 3);
+
+    uint32 newCache[CACHE_SIZE + 3];
+    size_t newCount = 0;
+
+    for (size_t c = 0; c < 3; c++) {
+      const uint32 v = tri[c];
+      uint32 *adj = adjacency.data() + adjacencyBegin[v];
+      uint32 *lastActive = adj + --numActive[v];
+      *std::find(adj, lastActive, uint32(bestTri)) = *lastActive;
+      *lastActive = bestTri;
+
+      if (std::find(newCache, newCache + newCount, v) == newCache + newCount) {
+        newCache[newCount++] = v;
+      }
+    }
+
+    for (size_t c = 0; c < cacheCount; c++) {
+      if (cache[c] != tri[0] && cache[c] != tri[1] && cache[c] != tri[2]) {
+        newCache[newCount++] = cache[c];
+      }
+    }
+
+    for (size_t c = 0; c < newCount; c++) {
+      const uint32 v = newCache[c];
+      cachePosition[v] = c < CACHE_SIZE ? int32(c) : -1;
+      vertexScore[v] = scores.Score(cachePosition[v], numActive[v]);
+    }
+
+    bestTri = -1;
+    bestScore = -1.f;
+
+    for (size_t c = 0; c < newCount; c++) {
+      const uint32 v = newCache[c];
+      const uint32 *adj = adjacency.data() + adjacencyBegin[v];
+
+      for (size_t a = 0; a < numActive[v]; a++) {
+        const uint32 t = adj[a];
+        const uint32 *tv = source.data() + t * 3;
+        triScore[t] =
+            vertexScore[tv[0]] + vertexScore[tv[1]] + vertexScore[tv[2]];
+
+        if (triScore[t] > bestScore) {
+          bestScore = triScore[t];
+          bestTri = t;
+        }
+      }
+    }
+
+    cacheCount = std::min(newCount, CACHE_SIZE);
+    memcpy(cache, newCache, cacheCount * sizeof(uint32));
+  }
+}
+
+std::vector<uint32> OptimizeVertexFetch(std::span<uint32> indices,
+                                        size_t numVertices) {
+  std::vector<uint32> remap(numVertices, NO_REMAP);
+  uint32 nextVertex = 0;
+
+  for (uint32 &i : indices) {
+    uint32 &r = remap.at(i);
+
+    if (r == NO_REMAP) {
+      r = nextVertex++;
+    }
+
+    i = r;
+  }
+
+  for (uint32 &r : remap) {
+    if (r == NO_REMAP) {
+      r = nextVertex++;
+    }
+  }
+
+  return remap;
+}
+} // namespace gltfutils
+
+VertexCacheStats GLTFModel::OptimizeMeshes() {
+  struct Job {
+    gltf::Primitive *primitive;
+    std::vector<uint32> indices;
+    size_t numVertices;
+    bool remapVertices;
+    std::vector<uint32> remap;
+    size_t missesBefore;
+    size_t missesAfter;
+  };
+
+  std::map<int32, GLTFStream *> viewStreams;
+
+  for (size_t s = 0; s < NumStreams(); s++) {
+    viewStreams[Stream(s).index] = &Stream(s);
+  }
+
+  std::map<int32, size_t> accessorUsage;
+
+  for (auto &m : meshes) {
+    for (auto &p : m.primitives) {
+      accessorUsage[p.indices]++;
+
+      for (auto &[_, a] : p.attributes) {
+        accessorUsage[a]++;
+      }
+
+      for (auto &t : p.targets) {
+        for (auto &[_, a] : t) {
+          accessorUsage[a]++;
+        }
+      }
+    }
+  }
+
+  auto FindStream = [&](const gltf::Accessor &acc) -> GLTFStream * {
+    auto found = viewStreams.find(acc.bufferView);
+    return found == viewStreams.end() || !acc.sparse.empty() ? nullptr
+                                                             : found->second;
+  };
+
+  std::vector<Job> jobs;
+
+  for (auto &m : meshes) {
+    for (auto &p : m.primitives) {
+      if (p.indices < 0 || p.attributes.empty() ||
+          accessorUsage[p.indices] > 1 ||
+          (p.mode != gltf::Primitive::Mode::Triangles &&
+           p.mode != gltf::Primitive::Mode::TriangleStrip)) {
+        continue;
+      }
+
+      const gltf::Accessor &indexAcc = accessors.at(p.indices);
+      const size_t indexSize = ComponentSize(indexAcc.componentType);
+      GLTFStream *indexStream = FindStream(indexAcc);
+
+      if (!indexStream || indexAcc.type != gltf::Accessor::Type::Scalar ||
+          indexAcc.componentType == gltf::Accessor::ComponentType::Byte ||
+          indexAcc.componentType == gltf::Accessor::ComponentType::Short ||
+          indexAcc.componentType == gltf::Accessor::ComponentType::Float) {
+        continue;
+      }
+
+      Job job{};
+      job.primitive = &p;
+      job.numVertices = accessors.at(p.attributes.begin()->second).count;
+      job.remapVertices = p.targets.empty();
+
+      for (auto &[_, a] : p.attributes) {
+        const gltf::Accessor &acc = accessors.at(a);
+        job.numVertices = std::max<size_t>(job.numVertices, acc.count);
+        job.remapVertices &= accessorUsage[a] == 1 && FindStream(acc) &&
+                             acc.count == job.numVertices;
+      }
+
+      std::vector<char> raw;
+      raw.reserve(indexAcc.count * indexSize);
+      indexStream->arena.Read(indexAcc.byteOffset, indexAcc.count * indexSize,
+                              [&](const char *data, size_t size) {
+                                raw.insert(raw.end(), data, data + size);
+                              });
+      job.indices.resize(indexAcc.count);
+
+      for (size_t i = 0; i < indexAcc.count; i++) {
+        uint32 value = 0;
+        memcpy(&value, raw.data() + i * indexSize, indexSize);
+        job.indices[i] = value;
+      }
+
+      if (std::any_of(job.indices.begin(), job.indices.end(),
+                      [&](uint32 i) { return i >= job.numVertices; })) {
+        continue;
+      }
+
+      jobs.emplace_back(std::move(job));
+    }
+  }
+
+  RunThreadedQueueEx(jobs.size(), [&](size_t index) {
+    Job &job = jobs.at(index);
+
+    if (job.primitive->mode == gltf::Primitive::Mode::TriangleStrip) {
+      job.indices = StripToList(job.indices);
+    }
+
+    job.missesBefore =
+        gltfutils::AnalyzeVertexCache(job.indices, job.numVertices);
+    gltfutils::OptimizeVertexCache(job.indices, job.numVertices);
+    job.missesAfter =
+        gltfutils::AnalyzeVertexCache(job.indices, job.numVertices);
+
+    if (job.remapVertices) {
+      job.remap = gltfutils::OptimizeVertexFetch(job.indices, job.numVertices);
+    }
+  });
+
+  VertexCacheStats retVal;
+
+  for (Job &job : jobs) {
+    if (job.indices.empty()) {
+      continue;
+    }
+
+    gltf::Primitive &prim = *job.primitive;
+    gltf::Accessor &indexAcc = accessors.at(prim.indices);
+    GLTFStream &indexStream = *FindStream(indexAcc);
+    const size_t indexSize = ComponentSize(indexAcc.componentType);
+    std::vector<char> raw(job.indices.size() * indexSize);
+
+    for (size_t i = 0; i < job.indices.size(); i++) {
+      memcpy(raw.data() + i * indexSize, &job.indices[i], indexSize);
+    }
+
+    if (prim.mode == gltf::Primitive::Mode::TriangleStrip) {
+      // List is usually longer than strip, append it at end of stream
+      auto &segments = indexStream.segments;
+      const size_t accIndex = prim.indices;
+      std::erase_if(segments, [accIndex](const GLTFStreamSegment &s) {
+        return s.accessor == accIndex;
+      });
+      const size_t unpaddedBegin = indexStream.wr.Tell();
+      indexStream.wr.ApplyPadding(indexSize);
+      indexAcc.byteOffset = indexStream.wr.Tell();
+      indexAcc.count = job.indices.size();
+      segments.push_back(
+          {unpaddedBegin, indexAcc.byteOffset, indexSize, accIndex});
+      indexStream.wr.WriteContainer(raw);
+      prim.mode = gltf::Primitive::Mode::Triangles;
+    } else {
+      indexStream.arena.Write(indexAcc.byteOffset, raw.data(), raw.size());
+    }
+
+    if (job.remapVertices) {
+      for (auto &[_, a] : prim.attributes) {
+        const gltf::Accessor &acc = accessors.at(a);
+        GLTFStream &stream = *FindStream(acc);
+        const size_t elementSize =
+            ComponentSize(acc.componentType) * NumComponents(acc.type);
+        const size_t stride =
+            stream.byteStride ? stream.byteStride : elementSize;
+        const size_t regionSize = (acc.count - 1) * stride + elementSize;
+        std::vector<char> vertices;
+        vertices.reserve(regionSize);
+        stream.arena.Read(acc.byteOffset, regionSize,
+                          [&](const char *data, size_t size) {
+                            vertices.insert(vertices.end(), data, data + size);
+                          });
+        std::vector<char> remapped(vertices);
+
+        for (size_t v = 0; v < acc.count; v++) {
+          memcpy(remapped.data() + job.remap[v] * stride,
+                 vertices.data() + v * stride, elementSize);
+        }
+
+        stream.arena.Write(acc.byteOffset, remapped.data(), regionSize);
+      }
+    }
+
+    retVal.numPrimitives++;
+    retVal.numTriangles += job.indices.size() / 3;
+    retVal.missesBefore += job.missesBefore;
+    retVal.missesAfter += job.missesAfter;
+  }
+
+  return retVal;
+}
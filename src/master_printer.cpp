@@ -17,13 +17,138 @@
 
 #include "spike/master_printer.hpp"
 #include "spike/type/flags.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <functional>
+#include <memory>
 #include <mutex>
-#include <sstream>
+#include <streambuf>
 #include <thread>
 #include <vector>
 
 using namespace es::print;
 
+namespace {
+struct RecordHeader {
+  uint64 sequence;
+  uint32 threadId;
+  uint32 size;
+  MPType type;
+};
+
+// Single producer (owning thread), single consumer (drainer) byte ring
+// Records are RecordHeader + payload, aligned to 8 bytes
+struct ThreadRing {
+  static constexpr size_t CAPACITY = 0x10000;
+  static constexpr size_t MAX_RECORD = CAPACITY / 4;
+  static constexpr uint32 WRAP = UINT32_MAX;
+
+  alignas(64) std::atomic_size_t head{0};
+  alignas(64) std::atomic_size_t tail{0};
+  std::atomic_bool orphaned{false};
+  char data[CAPACITY];
+
+  static size_t RecordSize(size_t payloadSize) {
+    return (sizeof(RecordHeader) + payloadSize + 7) & ~size_t(7);
+  }
+
+  bool Push(const RecordHeader &hdr, const char *payload) {
+    const size_t recordSize = RecordSize(hdr.size);
+    size_t cHead = head.load(std::memory_order_relaxed);
+    const size_t cTail = tail.load(std::memory_order_acquire);
+    const size_t offset = cHead % CAPACITY;
+    const size_t wrapSize =
+        offset + recordSize > CAPACITY ? CAPACITY - offset : 0;
+
+    if (cHead + wrapSize + recordSize - cTail > CAPACITY) {
+      return false;
+    }
+
+    if (wrapSize) {
+      if (wrapSize >= sizeof(RecordHeader)) {
+        RecordHeader wrap{};
+        wrap.size = WRAP;
+        memcpy(data + offset, &wrap, sizeof(wrap));
+      }
+
+      cHead += wrapSize;
+    }
+
+    char *record = data + cHead % CAPACITY;
+    memcpy(record, &hdr, sizeof(hdr));
+    memcpy(record + sizeof(hdr), payload, hdr.size);
+    head.store(cHead + recordSize, std::memory_order_release);
+
+    return true;
+  }
+
+  template <class fc> void Consume(fc &&cb) {
+    size_t cTail = tail.load(std::memory_order_relaxed);
+    const size_t cHead = head.load(std::memory_order_acquire);
+
+    while (cTail < cHead) {
+      const size_t offset = cTail % CAPACITY;
+
+      if (CAPACITY - offset < sizeof(RecordHeader)) {
+        cTail += CAPACITY - offset;
+        continue;
+      }
+
+      RecordHeader hdr;
+      memcpy(&hdr, data + offset, sizeof(hdr));
+
+      if (hdr.size == WRAP) {
+        cTail += CAPACITY - offset;
+        continue;
+      }
+
+      cb(hdr, data + offset + sizeof(hdr));
+      cTail += RecordSize(hdr.size);
+    }
+
+    tail.store(cTail, std::memory_order_release);
+  }
+
+  bool Empty() const {
+    return head.load(std::memory_order_acquire) ==
+           tail.load(std::memory_order_relaxed);
+  }
+};
+
+// Keeps its storage between lines, so formatting won't allocate once warmed up
+struct LineBuffer : std::streambuf {
+  std::string line;
+
+protected:
+  int_type overflow(int_type c) override {
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+      line.push_back(traits_type::to_char_type(c));
+    }
+
+    return c;
+  }
+
+  std::streamsize xsputn(const char *s, std::streamsize n) override {
+    line.append(s, n);
+    return n;
+  }
+};
+
+struct ThreadContext {
+  LineBuffer buffer;
+  std::ostream str{&buffer};
+  MPType type = MPType::MSG;
+  uint32 threadId;
+  std::shared_ptr<ThreadRing> ring = std::make_shared<ThreadRing>();
+
+  ThreadContext();
+  ~ThreadContext() { ring->orphaned = true; }
+};
+} // namespace
+
 static struct MasterPrinter {
   struct FuncType {
     print_func func;
@@ -32,48 +157,39 @@ static struct MasterPrinter {
     FuncType(print_func fp, bool cl) : func(fp), useColor(cl) {}
   };
 
+  struct BatchItem {
+    uint64 sequence;
+    Queuer que;
+  };
+
   std::vector<FuncType> functions;
   std::vector<queue_func> queues;
-  std::stringstream buffer;
-  std::mutex mutex;
-  std::thread::id lockedThread;
+  // Serializes delivery into functions and queues
+  std::mutex drainMutex;
+  std::vector<BatchItem> batch;
+  std::mutex registryMutex;
+  std::vector<std::shared_ptr<ThreadRing>> rings;
+  std::atomic_uint64_t sequence{0};
+  std::atomic_bool asyncDrain{false};
+  std::atomic_uint32_t throttleInterval{0};
+  std::atomic<int64> lastThrottled{INT64_MIN / 2};
+  std::atomic_size_t numThrottled{0};
   bool printThreadID = false;
-  MPType cType = MPType::MSG;
 } MASTER_PRINTER;
 
-namespace es::print {
-
-void AddPrinterFunction(print_func func, bool useColor) {
-  for (auto &[func_, _] : MASTER_PRINTER.functions) {
-    if (func_ == func) {
-      return;
-    }
-  }
-  MASTER_PRINTER.functions.emplace_back(func, useColor);
+ThreadContext::ThreadContext() {
+  // Truncated, only used to tell threads apart in log
+  threadId = uint32(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+  std::lock_guard<std::mutex> lg(MASTER_PRINTER.registryMutex);
+  MASTER_PRINTER.rings.push_back(ring);
 }
 
-void AddQueuer(queue_func func) { MASTER_PRINTER.queues.push_back(func); }
-
-std::ostream &Get(MPType type) {
-  if (auto threadID = std::this_thread::get_id();
-      !(MASTER_PRINTER.lockedThread == threadID)) {
-    MASTER_PRINTER.mutex.lock();
-    MASTER_PRINTER.lockedThread = threadID;
-  }
-
-  if (type != MPType::PREV) {
-    MASTER_PRINTER.cType = type;
-  }
-  return MASTER_PRINTER.buffer;
+static ThreadContext &GetThreadContext() {
+  static thread_local ThreadContext context;
+  return context;
 }
 
-void FlushAll() {
-  Queuer que;
-  que.payload = std::move(MASTER_PRINTER.buffer).str();
-  std::thread::id threadID = std::this_thread::get_id();
-  que.threadId = reinterpret_cast<uint32 &>(threadID);
-  que.type = MASTER_PRINTER.cType;
-
+static void Deliver(const Queuer &que) {
   for (auto &[func, useColor] : MASTER_PRINTER.functions) {
     if (useColor) {
       if (que.type == MPType::WRN) {
@@ -109,10 +225,163 @@ void FlushAll() {
   for (auto &q : MASTER_PRINTER.queues) {
     q(que);
   }
+}
+
+// Must be called with drainMutex held
+static void DrainLocked() {
+  auto &batch = MASTER_PRINTER.batch;
+  size_t batchSize = 0;
+
+  {
+    std::lock_guard<std::mutex> lg(MASTER_PRINTER.registryMutex);
+    auto &rings = MASTER_PRINTER.rings;
+
+    for (auto &r : rings) {
+      r->Consume([&](const RecordHeader &hdr, const char *payload) {
+        if (batchSize == batch.size()) {
+          batch.emplace_back();
+        }
+
+        auto &item = batch[batchSize++];
+        item.sequence = hdr.sequence;
+        item.que.payload.assign(payload, hdr.size);
+        item.que.type = hdr.type;
+        item.que.threadId = hdr.threadId;
+      });
+    }
+
+    rings.erase(std::remove_if(rings.begin(), rings.end(),
+                               [](auto &r) { return r->orphaned && r->Empty(); }),
+                rings.end());
+  }
+
+  std::sort(batch.begin(), batch.begin() + batchSize,
+            [](auto &a, auto &b) { return a.sequence < b.sequence; });
+
+  for (size_t i = 0; i < batchSize; i++) {
+    Deliver(batch[i].que);
+  }
+}
+
+static void Commit(ThreadContext &ctx) {
+  auto &line = ctx.buffer.line;
+  RecordHeader hdr{
+      MASTER_PRINTER.sequence.fetch_add(1, std::memory_order_relaxed),
+      ctx.threadId,
+      uint32(line.size()),
+      ctx.type,
+  };
+
+  ctx.type = MPType::MSG;
+
+  if (line.size() > ThreadRing::MAX_RECORD) {
+    std::lock_guard<std::mutex> lg(MASTER_PRINTER.drainMutex);
+    DrainLocked();
+    Deliver({std::move(line), hdr.type, hdr.threadId});
+    line.clear();
+    return;
+  }
+
+  if (!ctx.ring->Push(hdr, line.data())) {
+    // Ring is full, deliver pending lines on this thread
+    std::lock_guard<std::mutex> lg(MASTER_PRINTER.drainMutex);
+    DrainLocked();
+    ctx.ring->Push(hdr, line.data());
+  }
+
+  line.clear();
+
+  if (!MASTER_PRINTER.asyncDrain.load(std::memory_order_relaxed)) {
+    std::lock_guard<std::mutex> lg(MASTER_PRINTER.drainMutex);
+    DrainLocked();
+  }
+}
+
+namespace es::print {
+
+void AddPrinterFunction(print_func func, bool useColor) {
+  for (auto &[func_, _] : MASTER_PRINTER.functions) {
+    if (func_ == func) {
+      return;
+    }
+  }
+  MASTER_PRINTER.functions.emplace_back(func, useColor);
+}
+
+void AddQueuer(queue_func func) {
+  // Queuers can be added while other threads drain
+  std::lock_guard<std::mutex> lg(MASTER_PRINTER.drainMutex);
+  MASTER_PRINTER.queues.push_back(func);
+}
+
+std::ostream &Get(MPType type) {
+  auto &ctx = GetThreadContext();
+
+  if (type != MPType::PREV) {
+    ctx.type = type;
+  }
+
+  return ctx.str;
+}
+
+void FlushAll() { Commit(GetThreadContext()); }
+
+void FlushThrottled() {
+  auto &ctx = GetThreadContext();
+  const uint32 interval =
+      MASTER_PRINTER.throttleInterval.load(std::memory_order_relaxed);
+
+  if (interval) {
+    using namespace std::chrono;
+    const int64 now =
+        duration_cast<milliseconds>(steady_clock::now().time_since_epoch())
+            .count();
+    int64 last = MASTER_PRINTER.lastThrottled.load(std::memory_order_relaxed);
+
+    if (now - last < interval ||
+        !MASTER_PRINTER.lastThrottled.compare_exchange_strong(
+            last, now, std::memory_order_relaxed)) {
+      MASTER_PRINTER.numThrottled.fetch_add(1, std::memory_order_relaxed);
+      ctx.buffer.line.clear();
+      ctx.type = MPType::MSG;
+      return;
+    }
+
+    if (size_t skipped = MASTER_PRINTER.numThrottled.exchange(
+            0, std::memory_order_relaxed)) {
+      auto &line = ctx.buffer.line;
+      const bool newLine = !line.empty() && line.back() == '\n';
+
+      if (newLine) {
+        line.pop_back();
+      }
+
+      line.append(" (+").append(std::to_string(skipped)).append(" skipped)");
+
+      if (newLine) {
+        line.push_back('\n');
+      }
+    }
+  }
+
+  Commit(ctx);
+}
+
+void SetThrottleInterval(uint32 milliseconds) {
+  MASTER_PRINTER.throttleInterval = milliseconds;
+}
+
+void SetAsyncDrain(bool yn) {
+  MASTER_PRINTER.asyncDrain = yn;
+
+  if (!yn) {
+    DrainQueues();
+  }
+}
 
-  MASTER_PRINTER.cType = MPType::MSG;
-  MASTER_PRINTER.mutex.unlock();
-  MASTER_PRINTER.lockedThread = {};
+void DrainQueues() {
+  std::lock_guard<std::mutex> lg(MASTER_PRINTER.drainMutex);
+  DrainLocked();
 }
 
 void PrintThreadID(bool yn) { MASTER_PRINTER.printThreadID = yn; }
@@ -0,0 +1,104 @@
+/*  a source for Murmur3Hash128
+
+    Copyright 2024 Lukas Cone
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "spike/crypto/murmur3.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+static constexpr uint64 C1 = 0x87c37b91114253d5;
+static constexpr uint64 C2 = 0x4cf5ad432745937f;
+
+static uint64 FMix(uint64 k) {
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccd;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53;
+  k ^= k >> 33;
+  return k;
+}
+
+static uint64 MixK1(uint64 k1) { return std::rotl(k1 * C1, 31) * C2; }
+static uint64 MixK2(uint64 k2) { return std::rotl(k2 * C2, 33) * C1; }
+
+// Little endian load, tail bytes past size are zero
+static uint64 Load(const char *data, size_t size = 8) {
+  uint64 value = 0;
+  memcpy(&value, data, size);
+  return value;
+}
+
+void Murmur3Hash128::Block(const char *data) {
+  h1 ^= MixK1(Load(data));
+  h1 = std::rotl(h1, 27) + h2;
+  h1 = h1 * 5 + 0x52dce729;
+  h2 ^= MixK2(Load(data + 8));
+  h2 = std::rotl(h2, 31) + h1;
+  h2 = h2 * 5 + 0x38495ab5;
+}
+
+void Murmur3Hash128::Update(const char *data, size_t size) {
+  totalSize += size;
+
+  if (tailSize) {
+    const size_t numFill = std::min(size, sizeof(tail) - tailSize);
+    memcpy(tail + tailSize, data, numFill);
+    tailSize += numFill;
+    data += numFill;
+    size -= numFill;
+
+    if (tailSize < sizeof(tail)) {
+      return;
+    }
+
+    Block(tail);
+    tailSize = 0;
+  }
+
+  const char *dataEnd = data + (size & ~size_t(15));
+
+  for (; data < dataEnd; data += 16) {
+    Block(data);
+  }
+
+  tailSize = size & 15;
+  memcpy(tail, data, tailSize);
+}
+
+Hash128 Murmur3Hash128::Finish() const {
+  uint64 r1 = h1;
+  uint64 r2 = h2;
+
+  if (tailSize > 8) {
+    r2 ^= MixK2(Load(tail + 8, tailSize - 8));
+  }
+
+  if (tailSize) {
+    r1 ^= MixK1(Load(tail, std::min(tailSize, size_t(8))));
+  }
+
+  r1 ^= totalSize;
+  r2 ^= totalSize;
+  r1 += r2;
+  r2 += r1;
+  r1 = FMix(r1);
+  r2 = FMix(r2);
+  r1 += r2;
+  r2 += r1;
+
+  return {r1, r2};
+}
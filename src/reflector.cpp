@@ -22,10 +22,12 @@
 #include "spike/type/float.hpp"
 #include <algorithm>
 #include <cctype>
+#include <charconv>
 #include <cmath>
 #include <memory>
 #include <ostream>
 #include <string_view>
+#include <vector>
 
 static const char *TYPE_NAMES[]{"x", "y", "z", "w"};
 
@@ -99,8 +101,92 @@ static ReflectorMember::ErrorType
 SetReflectedMember(ReflType reflValue, std::string_view value, char *objAddr,
                    const reflectorStatic *refl);
 
+bool ReflHashTable::Build(const uint32 *keys, const uint16 *indices,
+                          size_t numKeys) {
+  std::fill_n(displacements, numBuckets, 0);
+  std::fill_n(slots, numSlots, 0);
+  std::vector<std::vector<size_t>> buckets(numBuckets);
+
+  for (size_t k = 0; k < numKeys; k++) {
+    if (std::find(keys, keys + k, keys[k]) == keys + k) {
+      buckets[Mix(keys[k]) & (numBuckets - 1)].push_back(k);
+    }
+  }
+
+  std::vector<uint32> order(numBuckets);
+
+  for (uint32 b = 0; b < numBuckets; b++) {
+    order[b] = b;
+  }
+
+  std::stable_sort(order.begin(), order.end(), [&](uint32 b0, uint32 b1) {
+    return buckets[b0].size() > buckets[b1].size();
+  });
+
+  std::vector<uint32> bucketSlots;
+
+  for (uint32 b : order) {
+    const auto &bucket = buckets[b];
+
+    if (bucket.empty()) {
+      break;
+    }
+
+    uint32 displacement = 0;
+
+    for (; displacement < 0x10000; displacement++) {
+      bucketSlots.clear();
+
+      for (size_t k : bucket) {
+        const uint32 slot =
+            Mix(keys[k] ^ (displacement * 0x9e3779b9)) & (numSlots - 1);
+
+        if (slots[slot] || std::find(bucketSlots.begin(), bucketSlots.end(),
+                                     slot) != bucketSlots.end()) {
+          break;
+        }
+
+        bucketSlots.push_back(slot);
+      }
+
+      if (bucketSlots.size() == bucket.size()) {
+        break;
+      }
+    }
+
+    if (displacement == 0x10000) {
+      return false;
+    }
+
+    displacements[b] = displacement;
+
+    for (size_t i = 0; i < bucket.size(); i++) {
+      slots[bucketSlots[i]] = indices[bucket[i]] + 1;
+    }
+  }
+
+  return true;
+}
+
 static const ReflType *GetReflectedType(const reflectorStatic *inst,
                                         const JenHash hash) {
+  if (inst->memberTable) {
+    const int32 found = inst->memberTable->Find(hash.raw());
+
+    if (found < 0) {
+      return nullptr;
+    }
+
+    const ReflType *type = inst->types + found;
+
+    if (type->valueNameHash == hash ||
+        (inst->typeAliasHashes && inst->typeAliasHashes[found] == hash)) {
+      return type;
+    }
+
+    return nullptr;
+  }
+
   const size_t _ntypes = inst->nTypes;
 
   for (size_t t = 0; t < _ntypes; t++) {
@@ -162,57 +248,84 @@ template <class type> struct LimitProxy<BFTag<type>> {
   const int64 iMin;
 
   LimitProxy(size_t numBits_)
-      : numBits(numBits_), uMax((1 << numBits) - 1), iMax(uMax >> 1),
+      : numBits(numBits_), uMax(~0ULL >> (64 - numBits)), iMax(uMax >> 1),
         iMin(~iMax) {}
 };
 
+static bool ParseSign(std::string_view &input) {
+  if (!input.empty() && (input.front() == '-' || input.front() == '+')) {
+    const bool negative = input.front() == '-';
+    input.remove_prefix(1);
+    return negative;
+  }
+
+  return false;
+}
+
+// Consumes 0x (hexadecimal) or 0o (octal) prefix
+static int ParseRadix(std::string_view &input) {
+  if (input.size() > 1 && input[0] == '0') {
+    const char tag = static_cast<char>(std::tolower(uint8(input[1])));
+
+    if (tag == 'x') {
+      input.remove_prefix(2);
+      return 16;
+    } else if (tag == 'o') {
+      input.remove_prefix(2);
+      return 8;
+    }
+  }
+
+  return 10;
+}
+
 template <typename T, class ProxyType>
-static ReflectorMember::ErrorType SetNumber(std::string_view input_, T &output,
+static ReflectorMember::ErrorType SetNumber(std::string_view input, T &output,
                                             ProxyType proxy) {
-  std::string input(input_);
-  ReflectorMember::ErrorType errType = ReflectorMember::ErrorType::None;
-  const int base =
-      !input.compare(0, 2, "0x") || !input.compare(0, 3, "-0x") ? 16 : 10;
+  std::string_view digits = input;
+  const bool negative = ParseSign(digits);
+  const int base = ParseRadix(digits);
+  uint64 magnitude = 0;
+  auto [_, ec] = std::from_chars(digits.data(), digits.data() + digits.size(),
+                                 magnitude, base);
+
+  if (ec == std::errc::invalid_argument) {
+    printerror("[Reflector] Invalid value: " << input);
+    return ReflectorMember::ErrorType::InvalidFormat;
+  }
+
+  bool OOR = ec == std::errc::result_out_of_range;
+
   if constexpr (std::is_signed_v<T>) {
-    int64 value = 0;
     const int64 iMin = proxy.iMin;
     const int64 iMax = proxy.iMax;
-    bool OOR = false;
+    int64 value = 0;
 
-    try {
-      value = std::stoll(input, nullptr, base);
-    } catch (const std::invalid_argument &) {
-      printerror("[Reflector] Invalid value: " << input);
-      return ReflectorMember::ErrorType::InvalidFormat;
-    } catch (const std::out_of_range &) {
-      OOR = true;
+    if (negative) {
+      OOR |= magnitude > uint64(-(iMin + 1)) + 1;
+      value = static_cast<int64>(0 - magnitude);
+    } else {
+      OOR |= magnitude > uint64(iMax);
+      value = static_cast<int64>(magnitude);
     }
 
-    if (OOR || value > iMax || value < iMin) {
+    if (OOR) {
       printwarning("[Reflector] Integer out of range, got: "
-                   << value << " for a signed " << proxy.numBits
+                   << input << " for a signed " << proxy.numBits
                    << "bit number!");
-      output = static_cast<T>(input[0] == '-' ? iMin : iMax);
+      output = static_cast<T>(negative ? iMin : iMax);
       return ReflectorMember::ErrorType::OutOfRange;
     }
 
     output = static_cast<T>(value);
+    return ReflectorMember::ErrorType::None;
   } else {
-    uint64 value = 0;
+    ReflectorMember::ErrorType errType = ReflectorMember::ErrorType::None;
     const uint64 iMax = proxy.uMax;
-    bool OOR = false;
+    uint64 value = magnitude;
 
-    try {
-      value = std::stoull(input, nullptr, base);
-    } catch (const std::invalid_argument &) {
-      printerror("[Reflector] Invalid value: " << input);
-      return ReflectorMember::ErrorType::InvalidFormat;
-    } catch (const std::out_of_range &) {
-      OOR = true;
-    }
-
-    if (input[0] == '-') {
-      value = static_cast<T>(value);
+    if (negative && !OOR) {
+      value = static_cast<T>(0 - magnitude);
       printwarning("[Reflector] Applying "
                    << input
                    << " to an unsigned integer, casting to: " << value);
@@ -221,73 +334,140 @@ static ReflectorMember::ErrorType SetNumber(std::string_view input_, T &output,
 
     if (OOR || value > iMax) {
       printwarning("[Reflector] Integer out of range, got: "
-                   << value << " for an unsigned " << proxy.numBits
+                   << input << " for an unsigned " << proxy.numBits
                    << "bit number!");
       output = static_cast<T>(iMax);
       return ReflectorMember::ErrorType::OutOfRange;
     }
 
     output = static_cast<T>(value);
+    return errType;
   }
+}
 
-  return errType;
+// Tells overflow from underflow for a magnitude rejected by from_chars
+static bool IsFloatOverflow(std::string_view input, bool hex) {
+  auto IsDigit = [hex](char c) {
+    return hex ? std::isxdigit(uint8(c)) : std::isdigit(uint8(c));
+  };
+  size_t cursor = input.find_first_not_of('0');
+  cursor = std::min(cursor, input.size());
+  int64 scale = 0;
+
+  while (cursor < input.size() && IsDigit(input[cursor])) {
+    scale++;
+    cursor++;
+  }
+
+  if (cursor < input.size() && input[cursor] == '.') {
+    cursor++;
+
+    if (!scale) {
+      while (cursor < input.size() && input[cursor] == '0') {
+        scale--;
+        cursor++;
+      }
+    }
+
+    while (cursor < input.size() && IsDigit(input[cursor])) {
+      cursor++;
+    }
+  }
+
+  // Hexadecimal digits are 4 binary exponent steps
+  scale *= hex ? 4 : 1;
+
+  if (cursor + 1 < input.size() &&
+      std::tolower(uint8(input[cursor])) == (hex ? 'p' : 'e')) {
+    std::string_view expDigits = input.substr(cursor + 1);
+    const bool negativeExp = ParseSign(expDigits);
+    int64 exponent = 0;
+    auto [_, ec] = std::from_chars(
+        expDigits.data(), expDigits.data() + expDigits.size(), exponent);
+
+    if (ec == std::errc::result_out_of_range) {
+      return !negativeExp;
+    }
+
+    scale += negativeExp ? -exponent : exponent;
+  }
+
+  return scale > 0;
 }
 
 template <typename T>
-static ReflectorMember::ErrorType SetNumber(std::string_view input_,
+static ReflectorMember::ErrorType SetNumber(std::string_view input,
                                             T &output) {
   if constexpr (std::is_floating_point_v<T>) {
-    std::string input(input_);
     constexpr T fMax = std::numeric_limits<T>::max();
     constexpr T fMin = std::numeric_limits<T>::min();
-
-    try {
-      output = [&input] {
-        if constexpr (std::is_same_v<T, float>) {
-          return std::stof(input);
-        } else {
-          return std::stod(input);
-        }
-      }();
-
-      // MSVC Underflow fix
-      if (std::fpclassify(output) == FP_SUBNORMAL) {
-        throw std::out_of_range("");
-      }
-    } catch (const std::invalid_argument &) {
+    std::string_view digits = input;
+    const bool negative = ParseSign(digits);
+    const int base = ParseRadix(digits);
+    const bool hex = base == 16;
+    T value = 0;
+    auto [_, ec] =
+        std::from_chars(digits.data(), digits.data() + digits.size(), value,
+                        hex ? std::chars_format::hex
+                            : std::chars_format::general);
+
+    if (ec == std::errc::invalid_argument || base == 8) {
       printerror("[Reflector] Invalid value: " << input);
       return ReflectorMember::ErrorType::InvalidFormat;
-    } catch (const std::out_of_range &) {
-      printwarning("[Reflector] Float out of range, got: " << input);
+    }
 
-      double fVal = atof(input.c_str());
+    // Subnormals are out of range as well, same as MSVC reports them
+    if (ec == std::errc::result_out_of_range ||
+        std::fpclassify(value) == FP_SUBNORMAL) {
+      printwarning("[Reflector] Float out of range, got: " << input);
+      const bool overflow = ec == std::errc::result_out_of_range
+                                ? IsFloatOverflow(digits, hex)
+                                : false;
+      output = overflow ? fMax : fMin;
 
-      if (fVal > 0)
-        output = fVal > 1.0 ? fMax : fMin;
-      else
-        output = fVal < -1.0 ? -fMax : -fMin;
+      if (negative) {
+        output = -output;
+      }
 
       return ReflectorMember::ErrorType::OutOfRange;
     }
 
+    output = negative ? -value : value;
     return ReflectorMember::ErrorType::None;
   } else {
-    return SetNumber(input_, output, LimitProxy<T>{});
+    return SetNumber(input, output, LimitProxy<T>{});
   }
 }
 
-static ReflectorMember::ErrorType SetBoolean(std::string input, bool &output) {
-  std::for_each(input.begin(), input.end(),
-                [](char &c) { c = static_cast<char>(std::tolower(c)); });
-
-  output = !memcmp(input.c_str(), "true", 4);
+static ReflectorMember::ErrorType SetBoolean(std::string_view input,
+                                             bool &output) {
+  static constexpr std::string_view trueNames[]{"true", "yes", "on", "1"};
+  static constexpr std::string_view falseNames[]{"false", "no", "off", "0"};
+  const size_t tokenEnd =
+      std::find_if(input.begin(), input.end(),
+                   [](char c) { return !std::isalnum(uint8(c)); }) -
+      input.begin();
+  const std::string_view token = input.substr(0, tokenEnd);
+
+  auto Matches = [token](std::string_view name) {
+    return std::equal(
+        token.begin(), token.end(), name.begin(), name.end(),
+        [](char a, char b) { return std::tolower(uint8(a)) == b; });
+  };
 
-  if (!output && memcmp(input.c_str(), "false", 5)) {
-    printwarning("[Reflector] Expected true/false, got: " << input);
-    return ReflectorMember::ErrorType::InvalidFormat;
+  for (size_t i = 0; i < std::size(trueNames); i++) {
+    if (Matches(trueNames[i])) {
+      output = true;
+      return ReflectorMember::ErrorType::None;
+    } else if (Matches(falseNames[i])) {
+      output = false;
+      return ReflectorMember::ErrorType::None;
+    }
   }
 
-  return ReflectorMember::ErrorType::None;
+  output = false;
+  printwarning("[Reflector] Expected true/false, got: " << input);
+  return ReflectorMember::ErrorType::InvalidFormat;
 }
 
 static uint64 GetEnumValue(std::string_view input, JenHash hash,
@@ -300,6 +480,17 @@ static uint64 GetEnumValue(std::string_view input, JenHash hash,
     *rEnumFallback = rEnum;
   }
 
+  if (rEnum->nameTable) {
+    const int32 found = rEnum->nameTable->Find(JenHash(input).raw());
+
+    if (found < 0 || input != rEnum->names[found]) {
+      throw std::range_error("[Reflector] Enum value not found: " +
+                             static_cast<std::string>(input));
+    }
+
+    return rEnum->values[found];
+  }
+
   auto namesEnd = rEnum->names + rEnum->numMembers;
   auto foundItem =
       std::find_if(rEnum->names, namesEnd, [input](std::string_view item) {
@@ -571,7 +762,7 @@ SetReflectedMember(ReflType reflValue, std::string_view value, char *objAddr,
 
   switch (reflValue.type) {
   case REFType::Bool:
-    return SetBoolean(std::string(value), *reinterpret_cast<bool *>(objAddr));
+    return SetBoolean(value, *reinterpret_cast<bool *>(objAddr));
   case REFType::Integer: {
     switch (reflValue.size) {
     case 1:
@@ -672,7 +863,7 @@ SetReflectedMember(ReflType reflValue, std::string_view value, char *objAddr,
     }
     case REFType::Bool: {
       bool result;
-      auto err = SetBoolean(std::string(value), result);
+      auto err = SetBoolean(value, result);
       auto mask = (1ULL << reflValue.bit.position);
 
       if (result) {
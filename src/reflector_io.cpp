@@ -1,6 +1,6 @@
 /*  a source for reflector_io
 
-    Copyright 2020-2023 Lukas Cone
+    Copyright 2020-2024 Lukas Cone
 
     Licensed under the Apache License, Version 2.0 (the "License");
     you may not use this file except in compliance with the License.
@@ -18,7 +18,12 @@
 #include "spike/reflect/reflector_io.hpp"
 #include "spike/except.hpp"
 #include "spike/type/base_128.hpp"
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <sstream>
+#include <unordered_map>
 
 struct ReflectedInstanceFriend : ReflectedInstance {
   void *Instance() { return instance; }
@@ -31,11 +36,9 @@ public:
   using Reflector::GetReflectedInstance;
 };
 
-static int SaveClass(const Reflector &ri, ReflectedInstanceFriend inst,
-                     BinWritterRef wr);
+static int SaveClass(ReflectedInstanceFriend inst, BinWritterRef wr);
 
-static int WriteDataItem(const Reflector &ri, BinWritterRef wr,
-                         const char *objAddr, ReflType type, size_t index,
+static int WriteDataItem(BinWritterRef wr, const char *objAddr, ReflType type,
                          const reflectorStatic *refl) {
   switch (type.container) {
   case REFContainer::ContainerVector: {
@@ -45,17 +48,16 @@ static int WriteDataItem(const Reflector &ri, BinWritterRef wr,
     wr.Write(numItems);
 
     for (uint32 i = 0; i < numItems; i++) {
-      if (WriteDataItem(ri, wr,
-                        static_cast<const char *>(methods.at(objAddr, i)), type,
-                        type.index, refl))
+      if (WriteDataItem(wr, static_cast<const char *>(methods.at(objAddr, i)),
+                        type, refl))
         return 2;
     }
     return 0;
   }
   case REFContainer::InlineArray: {
     for (uint32 i = 0; i < type.asArray.numItems; i++) {
-      if (WriteDataItem(ri, wr, objAddr + (type.asArray.stride * i),
-                        type.asArray, type.index, refl))
+      if (WriteDataItem(wr, objAddr + (type.asArray.stride * i),
+                        type.asArray, refl))
         return 2;
     }
     return 0;
@@ -92,8 +94,8 @@ static int WriteDataItem(const Reflector &ri, BinWritterRef wr,
 
   case REFType::Vector: {
     for (uint32 i = 0; i < type.asArray.numItems; i++) {
-      if (WriteDataItem(ri, wr, objAddr + (type.asArray.stride * i),
-                        type.asArray, type.index, refl))
+      if (WriteDataItem(wr, objAddr + (type.asArray.stride * i),
+                        type.asArray, refl))
         return 2;
     }
     return 0;
@@ -114,42 +116,374 @@ static int WriteDataItem(const Reflector &ri, BinWritterRef wr,
     }
 
     ReflectedInstance subInst(found->second, objAddr);
-    return SaveClass(ri, ReflectedInstanceFriend{subInst}, wr);
+    return SaveClass(ReflectedInstanceFriend{subInst}, wr);
   }
   default:
     return 1;
   }
 }
 
-static int SaveClass(const Reflector &ri, ReflectedInstanceFriend inst,
-                     BinWritterRef wr) {
-  auto refData = inst.Refl();
-  const buint128 numItems = refData->nTypes;
-  const char *thisAddr = static_cast<const char *>(inst.Instance());
-  std::stringstream tmpClassBuffer;
+// Appends values as buint128 (uint64) or bint128 (int64)
+template <class T>
+static void AppendVarints(std::string &out, std::span<const T> values) {
+  const size_t begin = out.size();
+  const size_t maxSize = values.size() * VARINT_MAX_SIZE;
+  out.resize(begin + maxSize);
+  const size_t numBytes = EncodeVarints(
+      values, {reinterpret_cast<uint8 *>(out.data() + begin), maxSize});
+  out.resize(begin + numBytes);
+}
+
+static void AppendVarint(std::string &out, uint64 value) {
+  AppendVarints<uint64>(out, {&value, 1});
+}
 
-  BinWritterRef wrTmpClass(tmpClassBuffer);
-  wrTmpClass.Write(numItems);
+// Values are processed in blocks through stack buffer
+static constexpr size_t VARINT_BLOCK = 64;
+
+enum class IOOpType : uint8 {
+  Literal,     // Precomputed bytes, member headers and fixed chunk sizes
+  Copy,        // Raw object bytes
+  SignedVar,   // count * size bytes as bint128
+  UnsignedVar, // count * size bytes as buint128
+  String,      // std::string with uint32 count
+  BeginChunk,  // Placeholder for buint128 size of following data
+  EndChunk,
+  Generic, // WriteDataItem/LoadDataItem fallback, count is generics index
+};
 
-  for (size_t i = 0; i < numItems; i++) {
-    wrTmpClass.Write(refData->types[i].valueNameHash);
+struct IOOp {
+  IOOpType type;
+  uint32 offset;
+  uint32 size;
+  uint32 count = 1;
+};
 
-    std::stringstream tmpValueBuffer;
-    BinWritterRef wrTmp(tmpValueBuffer);
+// Ops for a single member of a top level class, used by loader
+struct IOMember {
+  JenHash hash;
+  // Contains only Copy, SignedVar, UnsignedVar and String ops
+  bool simple;
+  std::vector<IOOp> ops;
+};
 
-    int rVal =
-        WriteDataItem(ri, wrTmp, thisAddr + refData->types[i].offset,
-                      refData->types[i], refData->types[i].index, refData);
+// Schema plan of a reflected class compiled from its reflectorStatic
+// Nested classes and arrays are flattened, adjacent copies are merged
+struct IOPlan {
+  std::vector<IOOp> ops;
+  std::vector<IOMember> members;
+  std::vector<std::pair<ReflType, const reflectorStatic *>> generics;
+  std::string literals;
+};
 
-    if (rVal)
-      return rVal;
+class IOPlanBuilder {
+public:
+  IOPlan &plan;
+
+  void Append(std::vector<IOOp> &ops, const IOOp &op) {
+    if (op.type == IOOpType::Literal) {
+      const std::string bytes = plan.literals.substr(op.offset, op.size);
+      Literal(ops, bytes);
+      return;
+    }
+
+    if (!ops.empty() && ops.back().type == op.type) {
+      IOOp &last = ops.back();
+
+      if (op.type == IOOpType::Copy && last.offset + last.size == op.offset) {
+        last.size += op.size;
+        return;
+      }
+
+      if ((op.type == IOOpType::SignedVar ||
+           op.type == IOOpType::UnsignedVar) &&
+          last.size == op.size &&
+          last.offset + last.size * last.count == op.offset) {
+        last.count += op.count;
+        return;
+      }
+    }
+
+    ops.push_back(op);
+  }
+
+  void Literal(std::vector<IOOp> &ops, std::string_view bytes) {
+    std::string &literals = plan.literals;
+
+    if (!ops.empty() && ops.back().type == IOOpType::Literal) {
+      IOOp &last = ops.back();
+
+      if (last.offset + last.size != literals.size()) {
+        const std::string lastBytes = literals.substr(last.offset, last.size);
+        last.offset = literals.size();
+        literals.append(lastBytes);
+      }
+
+      literals.append(bytes);
+      last.size += bytes.size();
+      return;
+    }
+
+    ops.push_back({IOOpType::Literal, uint32(literals.size()),
+                   uint32(bytes.size())});
+    literals.append(bytes);
+  }
+
+  // Prepends buint128 size, precomputed when body has fixed size
+  void Chunk(std::vector<IOOp> &ops, const std::vector<IOOp> &body) {
+    size_t fixedSize = 0;
+
+    for (auto &op : body) {
+      if (op.type != IOOpType::Literal && op.type != IOOpType::Copy) {
+        ops.push_back({IOOpType::BeginChunk, 0, 0});
+
+        for (auto &o : body) {
+          Append(ops, o);
+        }
+
+        ops.push_back({IOOpType::EndChunk, 0, 0});
+        return;
+      }
+
+      fixedSize += op.size;
+    }
+
+    std::string chunkSize;
+    AppendVarint(chunkSize, fixedSize);
+    Literal(ops, chunkSize);
 
-    const auto sVarBuffer = tmpValueBuffer.str();
-    wrTmpClass.WriteContainerWCount<buint128>(sVarBuffer);
+    for (auto &op : body) {
+      Append(ops, op);
+    }
+  }
+
+  void Generic(std::vector<IOOp> &ops, ReflType type, uint32 offset,
+               const reflectorStatic *refl) {
+    ops.push_back(
+        {IOOpType::Generic, offset, 0, uint32(plan.generics.size())});
+    plan.generics.emplace_back(type, refl);
+  }
+
+  void Item(std::vector<IOOp> &ops, ReflType type, uint32 offset,
+            const reflectorStatic *refl) {
+    if (type.container == REFContainer::InlineArray) {
+      for (uint32 i = 0; i < type.asArray.numItems; i++) {
+        Item(ops, type.asArray, offset + type.asArray.stride * i, refl);
+      }
+
+      return;
+    } else if (type.container != REFContainer::None) {
+      Generic(ops, type, offset, refl);
+      return;
+    }
+
+    switch (type.type) {
+    case REFType::Integer:
+    case REFType::Enum:
+      if (type.size > 1) {
+        Append(ops, {IOOpType::SignedVar, offset, type.size});
+        return;
+      }
+
+      [[fallthrough]];
+    case REFType::UnsignedInteger:
+    case REFType::EnumFlags:
+    case REFType::BitFieldClass:
+      if (type.size > 1) {
+        Append(ops, {IOOpType::UnsignedVar, offset, type.size});
+        return;
+      }
+
+      [[fallthrough]];
+    case REFType::Bool:
+    case REFType::FloatingPoint:
+      Append(ops, {IOOpType::Copy, offset, type.size});
+      return;
+
+    case REFType::Vector:
+      for (uint32 i = 0; i < type.asArray.numItems; i++) {
+        Item(ops, type.asArray, offset + type.asArray.stride * i, refl);
+      }
+      return;
+
+    case REFType::String:
+      Append(ops, {IOOpType::String, offset, 0});
+      return;
+
+    case REFType::Class: {
+      auto found =
+          reflectorStatic::Registry().find(JenHash(type.asClass.typeHash));
+
+      if (found != reflectorStatic::Registry().end()) {
+        Class(ops, found->second, offset, nullptr);
+      } else {
+        Generic(ops, type, offset, refl);
+      }
+      return;
+    }
+    default:
+      Generic(ops, type, offset, refl);
+      return;
+    }
+  }
+
+  void Class(std::vector<IOOp> &ops, const reflectorStatic *refl,
+             uint32 offset, std::vector<IOMember> *members) {
+    std::vector<IOOp> body;
+    std::string header;
+    AppendVarint(header, refl->nTypes);
+    Literal(body, header);
+
+    for (size_t i = 0; i < refl->nTypes; i++) {
+      const ReflType &type = refl->types[i];
+      std::vector<IOOp> value;
+      Item(value, type, offset + type.offset, refl);
+
+      header.resize(sizeof(JenHash));
+      memcpy(header.data(), &type.valueNameHash, sizeof(JenHash));
+      Literal(body, header);
+      Chunk(body, value);
+
+      if (members) {
+        const bool simple =
+            std::all_of(value.begin(), value.end(), [](const IOOp &op) {
+              return op.type == IOOpType::Copy ||
+                     op.type == IOOpType::SignedVar ||
+                     op.type == IOOpType::UnsignedVar ||
+                     op.type == IOOpType::String;
+            });
+        members->push_back({type.valueNameHash, simple, std::move(value)});
+      }
+    }
+
+    Chunk(ops, body);
+  }
+};
+
+static const IOPlan &GetIOPlan(const reflectorStatic *refl) {
+  // Plans are never freed, so every thread can keep their addresses and
+  // shared storage is locked only for first use of class by thread
+  thread_local std::unordered_map<const reflectorStatic *, const IOPlan *>
+      threadPlans;
+
+  if (auto found = threadPlans.find(refl); found != threadPlans.end()) {
+    return *found->second;
+  }
+
+  static std::map<const reflectorStatic *, std::unique_ptr<IOPlan>> plans;
+  static std::mutex plansMutex;
+  std::lock_guard<std::mutex> lg(plansMutex);
+  auto &plan = plans[refl];
+
+  if (!plan) {
+    plan = std::make_unique<IOPlan>();
+    IOPlanBuilder builder{*plan};
+    builder.Class(plan->ops, refl, 0, &plan->members);
   }
 
-  const auto sClassBuffer = tmpClassBuffer.str();
-  wr.WriteContainerWCount<buint128>(sClassBuffer);
+  threadPlans.emplace(refl, plan.get());
+
+  return *plan;
+}
+
+// Serializes class chunk of obj into out
+class IOPlanWritter {
+  std::vector<size_t> chunkStack;
+  std::string varintBuffer;
+
+public:
+  std::string out;
+
+  // Widens count items of op.size bytes and encodes them in bulk
+  template <class T> void WriteVarints(const IOOp &op, const char *obj) {
+    const size_t shValue = 64 - (op.size * 8);
+    T values[VARINT_BLOCK];
+
+    for (uint32 i = 0; i < op.count; i += VARINT_BLOCK) {
+      const size_t numValues = std::min(size_t(op.count - i), VARINT_BLOCK);
+
+      for (size_t v = 0; v < numValues; v++) {
+        T value = 0;
+        memcpy(&value, obj + op.offset + op.size * (i + v), op.size);
+        values[v] = (value << shValue) >> shValue;
+      }
+
+      AppendVarints<T>(out, {values, numValues});
+    }
+  }
+
+  int Write(const IOPlan &plan, const char *obj) {
+    for (auto &op : plan.ops) {
+      switch (op.type) {
+      case IOOpType::Literal:
+        out.append(plan.literals.data() + op.offset, op.size);
+        break;
+
+      case IOOpType::Copy:
+        out.append(obj + op.offset, op.size);
+        break;
+
+      case IOOpType::SignedVar:
+        WriteVarints<int64>(op, obj);
+        break;
+
+      case IOOpType::UnsignedVar:
+        WriteVarints<uint64>(op, obj);
+        break;
+
+      case IOOpType::String: {
+        auto &str = *reinterpret_cast<const std::string *>(obj + op.offset);
+        const uint32 numChars = str.size();
+        out.append(reinterpret_cast<const char *>(&numChars),
+                   sizeof(numChars));
+        out.append(str);
+        break;
+      }
+
+      case IOOpType::BeginChunk:
+        chunkStack.push_back(out.size());
+        out.push_back(0);
+        break;
+
+      case IOOpType::EndChunk: {
+        const size_t chunkBegin = chunkStack.back();
+        chunkStack.pop_back();
+        varintBuffer.clear();
+        AppendVarint(varintBuffer, out.size() - chunkBegin - 1);
+        out[chunkBegin] = varintBuffer.front();
+        out.insert(chunkBegin + 1, varintBuffer, 1);
+        break;
+      }
+
+      case IOOpType::Generic: {
+        auto [type, refl] = plan.generics[op.count];
+        std::stringstream tmpValueBuffer;
+        BinWritterRef wrTmp(tmpValueBuffer);
+
+        if (int rVal = WriteDataItem(wrTmp, obj + op.offset, type, refl)) {
+          chunkStack.clear();
+          return rVal;
+        }
+
+        out.append(tmpValueBuffer.str());
+        break;
+      }
+      }
+    }
+
+    return 0;
+  }
+};
+
+static int SaveClass(ReflectedInstanceFriend inst, BinWritterRef wr) {
+  IOPlanWritter planWr;
+  const char *thisAddr = static_cast<const char *>(inst.Instance());
+
+  if (int rVal = planWr.Write(GetIOPlan(inst.Refl()), thisAddr)) {
+    return rVal;
+  }
+
+  wr.WriteContainer(planWr.out);
 
   return 0;
 }
@@ -162,7 +496,28 @@ int ReflectorBinUtil::Save(const Reflector &ri, BinWritterRef wr) {
 
   wr.Write(refData->classHash);
 
-  return SaveClass(ri, inst, wr);
+  return SaveClass(inst, wr);
+}
+
+int ReflectorBinUtil::SaveArray(const reflectorStatic *refl, const void *items,
+                                size_t stride, size_t numItems,
+                                BinWritterRef wr) {
+  const IOPlan &plan = GetIOPlan(refl);
+  IOPlanWritter planWr;
+  const char *itemsAddr = static_cast<const char *>(items);
+
+  for (size_t i = 0; i < numItems; i++) {
+    wr.Write(refl->classHash);
+    planWr.out.clear();
+
+    if (int rVal = planWr.Write(plan, itemsAddr + stride * i)) {
+      return rVal;
+    }
+
+    wr.WriteContainer(planWr.out);
+  }
+
+  return 0;
 }
 
 static int LoadClass(ReflectorPureWrap inst, BinReaderRef rd);
@@ -259,14 +614,98 @@ static int LoadDataItem(BinReaderRef rd, ReflType type, char *objAddr,
   }
 }
 
+// Decodes count items of op.size bytes in bulk, returns consumed bytes
+template <class T>
+static size_t LoadVarints(std::span<const uint8> data, const IOOp &op,
+                          char *objAddr) {
+  T values[VARINT_BLOCK];
+  size_t consumed = 0;
+
+  for (uint32 i = 0; i < op.count; i += VARINT_BLOCK) {
+    const size_t numValues = std::min(size_t(op.count - i), VARINT_BLOCK);
+    consumed += DecodeVarints(data.subspan(consumed), {values, numValues});
+
+    for (size_t v = 0; v < numValues; v++) {
+      memcpy(objAddr + op.offset + op.size * (i + v), values + v, op.size);
+    }
+  }
+
+  return consumed;
+}
+
+// Member chunk is read at once and decoded from memory
+// classEnd: end of enclosing class chunk, member must not cross it
+static void LoadSimpleMember(BinReaderRef rd, const IOMember &member,
+                             size_t chunkSize, size_t classEnd,
+                             std::string &buffer, char *objAddr) {
+  if (const size_t pos = rd.Tell();
+      pos > classEnd || chunkSize > classEnd - pos) {
+    throw es::UnexpectedEOS();
+  }
+
+  buffer.resize(chunkSize);
+  rd.ReadBuffer(buffer.data(), chunkSize);
+  std::span<const uint8> data(reinterpret_cast<const uint8 *>(buffer.data()),
+                              chunkSize);
+
+  for (auto &op : member.ops) {
+    switch (op.type) {
+    case IOOpType::Copy:
+      if (data.size() < op.size) {
+        throw es::UnexpectedEOS();
+      }
+
+      memcpy(objAddr + op.offset, data.data(), op.size);
+      data = data.subspan(op.size);
+      break;
+
+    case IOOpType::SignedVar:
+      data = data.subspan(LoadVarints<int64>(data, op, objAddr));
+      break;
+
+    case IOOpType::UnsignedVar:
+      data = data.subspan(LoadVarints<uint64>(data, op, objAddr));
+      break;
+
+    case IOOpType::String: {
+      uint32 numChars;
+
+      if (data.size() < sizeof(numChars)) {
+        throw es::UnexpectedEOS();
+      }
+
+      memcpy(&numChars, data.data(), sizeof(numChars));
+      data = data.subspan(sizeof(numChars));
+
+      if (data.size() < numChars) {
+        throw es::UnexpectedEOS();
+      }
+
+      reinterpret_cast<std::string *>(objAddr + op.offset)
+          ->assign(reinterpret_cast<const char *>(data.data()), numChars);
+      data = data.subspan(numChars);
+      break;
+    }
+
+    default:
+      break;
+    }
+  }
+}
+
 static int LoadClass(ReflectorPureWrap rfWrap, BinReaderRef rd) {
+  ReflectedInstanceFriend inst{rfWrap.data};
+  const IOPlan &plan = GetIOPlan(inst.Refl());
+  char *thisAddr = static_cast<char *>(inst.Instance());
   buint128 chunkSize;
   rd.Read(chunkSize);
   rd.Push();
+  const size_t classEnd = rd.Tell() + chunkSize;
   buint128 numIOItems;
   rd.Read(numIOItems);
 
   int errType = 0;
+  std::string buffer;
 
   for (uint32 i = 0; i < numIOItems; i++) {
     BinReaderRef rf(rd);
@@ -274,6 +713,15 @@ static int LoadClass(ReflectorPureWrap rfWrap, BinReaderRef rd) {
     buint128 valueChunkSize;
     rd.Read(valueNameHash);
     rd.Read(valueChunkSize);
+
+    // Stored in declaration order, members can be read directly
+    if (i < plan.members.size() && plan.members[i].simple &&
+        plan.members[i].hash == valueNameHash) {
+      LoadSimpleMember(rd, plan.members[i], valueChunkSize, classEnd, buffer,
+                       thisAddr);
+      continue;
+    }
+
     rd.Push();
 
     ReflectorMemberFriend mem{rfWrap[valueNameHash]};
@@ -316,3 +764,28 @@ int ReflectorBinUtil::Load(Reflector &ri, BinReaderRef rd) {
 
   return LoadClass(inst, rd);
 }
+
+int ReflectorBinUtil::LoadArray(const reflectorStatic *refl, void *items,
+                                size_t stride, size_t numItems,
+                                BinReaderRef rd) {
+  char *itemsAddr = static_cast<char *>(items);
+
+  for (size_t i = 0; i < numItems; i++) {
+    JenHash clsHash;
+    rd.Push();
+    rd.Read(clsHash);
+
+    if (clsHash != refl->classHash) {
+      rd.Pop();
+      return 1;
+    }
+
+    ReflectedInstance inst(refl, itemsAddr + stride * i);
+
+    if (int errType = LoadClass(inst, rd)) {
+      return errType;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,77 @@
+/*  a source for ScratchArena
+
+    Copyright 2024 Lukas Cone
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "spike/util/scratch.hpp"
+#include <numeric>
+
+static constexpr size_t MIN_BLOCK_SIZE = 0x10000;
+// Larger capacity is released on Reset
+static constexpr size_t MAX_RETAINED_SIZE = 0x4000000;
+
+void *ScratchArena::AllocateSlow(size_t size, size_t alignment) {
+  size_t next = current < blocks.size() ? current + 1 : current;
+
+  // Blocks after current one are free, reuse them when possible
+  for (; next < blocks.size(); next++) {
+    Block &block = blocks[next];
+    const size_t begin = AlignedOffset(block.data.get(), 0, alignment);
+
+    if (begin + size <= block.size) {
+      current = next;
+      offset = begin + size;
+      return block.data.get() + begin;
+    }
+  }
+
+  next = current < blocks.size() ? current + 1 : current;
+  const size_t lastSize = blocks.empty() ? 0 : blocks.back().size;
+  const size_t blockSize =
+      std::max({size + alignment, lastSize * 2, MIN_BLOCK_SIZE});
+  Block &block = *blocks.insert(
+      blocks.begin() + next,
+      {std::make_unique_for_overwrite<char[]>(blockSize), blockSize});
+  const size_t begin = AlignedOffset(block.data.get(), 0, alignment);
+  current = next;
+  offset = begin + size;
+
+  return block.data.get() + begin;
+}
+
+void ScratchArena::Reset() {
+  current = 0;
+  offset = 0;
+
+  if (blocks.empty() ||
+      (blocks.size() == 1 && blocks.front().size <= MAX_RETAINED_SIZE)) {
+    return;
+  }
+
+  const size_t totalSize = std::accumulate(
+      blocks.begin(), blocks.end(), size_t(0),
+      [](size_t sum, const Block &block) { return sum + block.size; });
+  blocks.clear();
+
+  if (totalSize <= MAX_RETAINED_SIZE) {
+    blocks.push_back(
+        {std::make_unique_for_overwrite<char[]>(totalSize), totalSize});
+  }
+}
+
+ScratchArena &ThreadScratch() {
+  static thread_local ScratchArena arena;
+  return arena;
+}
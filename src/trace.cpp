@@ -0,0 +1,158 @@
+/*  Scoped zone tracing with Chrome trace export
+
+    Copyright 2024 Lukas Cone
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "spike/util/trace.hpp"
+#include "spike/master_printer.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+namespace {
+struct Event {
+  const char *name;
+  uint64 begin;
+  uint64 end;
+};
+
+struct ThreadEvents {
+  uint32 threadIndex;
+  std::vector<Event> events;
+};
+
+struct ZoneStats {
+  size_t count = 0;
+  uint64 total = 0;
+  uint64 max = 0;
+};
+} // namespace
+
+static struct Tracer {
+  std::atomic_bool enabled{false};
+  uint64 origin = es::trace::Now();
+  std::mutex registryMutex;
+  std::vector<std::shared_ptr<ThreadEvents>> threads;
+} TRACER;
+
+static ThreadEvents &GetThreadEvents() {
+  static thread_local std::shared_ptr<ThreadEvents> events = [] {
+    std::lock_guard<std::mutex> lg(TRACER.registryMutex);
+    auto retVal = std::make_shared<ThreadEvents>();
+    retVal->threadIndex = TRACER.threads.size() + 1;
+    retVal->events.reserve(0x1000);
+    TRACER.threads.push_back(retVal);
+    return retVal;
+  }();
+
+  return *events;
+}
+
+namespace es::trace {
+void Enable(bool yn) { TRACER.enabled = yn; }
+
+bool IsEnabled() { return TRACER.enabled.load(std::memory_order_relaxed); }
+
+uint64 Now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void Record(const char *name, uint64 begin, uint64 end) {
+  GetThreadEvents().events.push_back({name, begin, end});
+}
+
+void WriteChromeTrace(std::ostream &str) {
+  std::lock_guard<std::mutex> lg(TRACER.registryMutex);
+  str << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  char buffer[128];
+
+  for (auto &t : TRACER.threads) {
+    for (auto &e : t->events) {
+      if (!first) {
+        str << ",\n";
+      }
+
+      first = false;
+      str << "{\"name\":\"";
+
+      for (const char *c = e.name; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+          str << '\\';
+        }
+
+        str << *c;
+      }
+
+      // Microseconds with nanosecond fraction
+      snprintf(buffer, sizeof(buffer),
+               "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+               t->threadIndex, (e.begin - TRACER.origin) / 1000.0,
+               (e.end - e.begin) / 1000.0);
+      str << buffer;
+    }
+  }
+
+  str << "]}\n";
+}
+
+void PrintSummary() {
+  std::map<std::string_view, ZoneStats> stats;
+
+  {
+    std::lock_guard<std::mutex> lg(TRACER.registryMutex);
+
+    for (auto &t : TRACER.threads) {
+      for (auto &e : t->events) {
+        auto &zone = stats[e.name];
+        const uint64 duration = e.end - e.begin;
+        zone.count++;
+        zone.total += duration;
+        zone.max = std::max(zone.max, duration);
+      }
+    }
+  }
+
+  if (stats.empty()) {
+    return;
+  }
+
+  std::vector<std::pair<std::string_view, ZoneStats>> sorted(stats.begin(),
+                                                             stats.end());
+  std::sort(sorted.begin(), sorted.end(), [](auto &a, auto &b) {
+    return a.second.total > b.second.total;
+  });
+
+  char buffer[256];
+  snprintf(buffer, sizeof(buffer), "%-32s %10s %12s %12s %12s", "Zone", "Count",
+           "Total [ms]", "Mean [ms]", "Max [ms]");
+  printinfo("Trace summary:\n" << buffer);
+
+  for (auto &[name, zone] : sorted) {
+    snprintf(buffer, sizeof(buffer), "%-32.*s %10zu %12.3f %12.3f %12.3f",
+             int(name.size()), name.data(), zone.count, zone.total / 1e6,
+             zone.total / 1e6 / zone.count, zone.max / 1e6);
+    printline(buffer);
+  }
+}
+} // namespace es::trace
@@ -1,5 +1,7 @@
 #include "spike/type/base_128.hpp"
+#include "spike/except.hpp"
 #include "spike/util/unit_testing.hpp"
+#include <random>
 #include <sstream>
 
 int test_base128() {
@@ -531,3 +533,87 @@ int test_ubase128() {
 
   return 0;
 }
+
+template <class T, class V> int test_base128_bulk_type() {
+  static const T edges[]{
+      T(0),
+      T(0x3f),
+      T(0x40),
+      T(0x7f),
+      T(0x80),
+      T(0x3fff),
+      T(0xffffffffffffff),
+      T(0x100000000000000),
+      T(~uint64(0)),
+      T(-0x40ll),
+      T(-0x41ll),
+      T(-0x80000000000000ll),
+      T(-0x80000000000001ll),
+      T(-0x100000000000000ll),
+      T(-0x100000000000001ll),
+      T(int64(0x8000000000000000)),
+  };
+  std::mt19937_64 engine(0x128);
+  std::vector<T> values(edges, edges + std::size(edges));
+
+  for (size_t i = 0; i < 4096; i++) {
+    // Mostly small values, so runs of single byte values are common
+    const size_t numBits = i % 3 ? engine() % 7 : engine() % 65;
+    values.push_back(T(numBits ? engine() >> (64 - numBits) : 0));
+
+    if constexpr (std::is_signed_v<T>) {
+      if (engine() & 1) {
+        values.back() = -values.back();
+      }
+    }
+  }
+
+  std::stringstream ss;
+  BinWritterRef wr(ss);
+
+  for (T v : values) {
+    wr.Write(V(v));
+  }
+
+  const std::string reference = ss.str();
+  std::vector<uint8> encoded(values.size() * VARINT_MAX_SIZE);
+  const size_t encodedSize = EncodeVarints(std::span<const T>(values), encoded);
+
+  TEST_EQUAL(encodedSize, reference.size());
+  TEST_CHECK((memcmp(encoded.data(), reference.data(), encodedSize) == 0));
+
+  // Exact sized output goes through bounds checked path
+  encoded.resize(encodedSize);
+  TEST_EQUAL(EncodeVarints(std::span<const T>(values), encoded), encodedSize);
+  TEST_CHECK((memcmp(encoded.data(), reference.data(), encodedSize) == 0));
+  TEST_THROW(es::LengthError, EncodeVarints(std::span<const T>(values),
+                                            std::span<uint8>(encoded).subspan(
+                                                0, encodedSize - 1)););
+
+  std::vector<T> decoded(values.size());
+  TEST_EQUAL(DecodeVarints(encoded, std::span<T>(decoded)), encodedSize);
+
+  BinReaderRef rd(ss);
+
+  for (size_t i = 0; i < values.size(); i++) {
+    V expected;
+    rd.Read(expected);
+    TEST_EQUAL(decoded[i], T(expected));
+    TEST_EQUAL(decoded[i], values[i]);
+  }
+
+  TEST_THROW(es::UnexpectedEOS,
+             DecodeVarints(std::span<const uint8>(encoded).subspan(
+                               0, encodedSize - 1),
+                           std::span<T>(decoded)););
+
+  return 0;
+}
+
+int test_base128_bulk() {
+  if (int rVal = test_base128_bulk_type<uint64, buint128>()) {
+    return rVal;
+  }
+
+  return test_base128_bulk_type<int64, bint128>();
+}
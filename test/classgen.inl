@@ -0,0 +1,116 @@
+#include "spike/classgen.hpp"
+#include "spike/util/unit_testing.hpp"
+#include <optional>
+
+namespace clgen::test {
+// uint16, uint16, uint32, uint64, uint8[8], missing member
+static const std::set<ClassData<6>> LAYOUTS{
+    {{{{0, 1, 8, 0}}, 24}, {0, 2, 4, 8, 16, -1}, {0xe5}},
+    {{{{2, 2, 8, 0}}, 16}, {0, 2, -1, 8, -1, -1}, {0xc5}},
+};
+
+struct Interface {
+  Interface(char *data_, LayoutLookup layout_)
+      : data{data_}, layout{GetLayout(LAYOUTS, {layout_, {}})},
+        lookup{layout_} {}
+  uint16 LayoutVersion() const { return lookup.version; }
+  int16 m(uint32 id) const { return layout->vtable[id]; }
+  char *data;
+  const ClassData<6> *layout;
+  LayoutLookup lookup;
+};
+} // namespace clgen::test
+
+int test_classgen() {
+  using namespace clgen;
+  TEST_THROW(std::runtime_error,
+             test::Interface(nullptr, LayoutLookup{5, true, false}););
+
+  const test::Interface iface(nullptr, LayoutLookup{1, true, false});
+  TEST_EQUAL(iface.layout->totalSize, 24);
+  const test::Interface iface2(nullptr, LayoutLookup{1, true, false});
+  TEST_EQUAL(iface.layout, iface2.layout);
+
+  const SwapProgram &prog = GetSwapProgram(iface.layout);
+  TEST_EQUAL(prog.runs.size(), 3);
+  TEST_EQUAL(prog.runs[0].count, 2);
+  TEST_EQUAL(prog.runs[0].width, 2);
+  TEST_EQUAL(prog.runs[2].offset, 8);
+  TEST_EQUAL(prog.runs[2].width, 8);
+  TEST_CHECK(!prog.uniform);
+
+  struct Record {
+    uint16 a;
+    uint16 b;
+    uint32 c;
+    uint64 d;
+    uint8 e[8];
+  };
+
+  std::vector<Record> records(1000);
+
+  for (size_t i = 0; i < records.size(); i++) {
+    records[i] = {uint16(0x1234 + i), 0x5678, uint32(0x12345678 + i),
+                  0x0123456789abcdefULL, {1, 2, 3, 4, 5, 6, 7, 8}};
+  }
+
+  LayoutedSpan<test::Interface> span(
+      test::Interface(reinterpret_cast<char *>(records.data()),
+                      LayoutLookup{1, true, false}),
+      records.size());
+  EndianSwap(span);
+
+  for (size_t i = 0; i < records.size(); i++) {
+    Record &r = records[i];
+    TEST_EQUAL(r.a, _fbswap<uint16>(0x1234 + i));
+    TEST_EQUAL(r.b, 0x7856);
+    TEST_EQUAL(r.c, _fbswap<uint32>(0x12345678 + i));
+    TEST_EQUAL(r.d, 0xefcdab8967452301ULL);
+    TEST_EQUAL(r.e[1], 2);
+  }
+
+  test::Interface single(reinterpret_cast<char *>(records.data()),
+                         LayoutLookup{1, true, false});
+  EndianSwap(single);
+  TEST_EQUAL(records[0].a, 0x1234);
+  TEST_EQUAL(records[0].d, 0x0123456789abcdefULL);
+  TEST_EQUAL(records[1].a, _fbswap<uint16>(0x1235));
+
+  return 0;
+}
+
+int test_classgen_reused_storage() {
+  using namespace clgen;
+  // Same storage is reused by different layouts, cached lookups must not
+  // return results of destroyed ones once they are invalidated
+  std::optional<std::set<ClassData<6>>> layouts;
+  layouts.emplace(test::LAYOUTS);
+  const LayoutLookup lookup{1, true, false};
+  const ClassData<6> *layout = GetLayout(*layouts, lookup);
+  TEST_EQUAL(layout->totalSize, 24);
+  TEST_EQUAL(GetLayout(*layouts, lookup), layout);
+  const SwapProgram &prog24 = GetSwapProgram(layout);
+  TEST_EQUAL(prog24.stride, 24);
+  TEST_EQUAL(&GetSwapProgram(layout), &prog24);
+
+  layouts.reset();
+  InvalidateLayoutCaches();
+  layouts.emplace();
+  TEST_THROW(std::runtime_error, GetLayout(*layouts, lookup););
+
+  const ClassData<6> other{{{{0, 1, 8, 0}}, 8}, {0, -1, 4, -1, -1, -1}, {0x20}};
+  layouts->insert(other);
+  layout = GetLayout(*layouts, lookup);
+  TEST_EQUAL(layout->totalSize, 8);
+
+  const SwapProgram &prog = GetSwapProgram(layout);
+  TEST_EQUAL(prog.stride, 8);
+  TEST_EQUAL(prog.runs.size(), 1);
+  TEST_EQUAL(prog.runs[0].offset, 4);
+  TEST_EQUAL(prog.runs[0].width, 4);
+
+  layouts.reset();
+  InvalidateLayoutCaches();
+
+  return 0;
+}
@@ -45,3 +45,40 @@ int test_mt_thread01() {
 
   return 0;
 }
+
+// Queues inside queue workers run serially on worker's thread
+int test_mt_thread_nested() {
+  const size_t numTasks = 4;
+  const size_t numSubTasks = 8;
+  std::thread::id threads[numTasks][numSubTasks];
+  std::thread::id serialThreads[numTasks][numSubTasks];
+  std::thread::id outerThreads[numTasks];
+
+  RunThreadedQueue(numTasks, [&](size_t curTask) {
+    outerThreads[curTask] = std::this_thread::get_id();
+    RunThreadedQueueEx(numSubTasks, [&](size_t subTask) {
+      threads[curTask][subTask] = std::this_thread::get_id();
+    });
+    RunThreadedQueueEx(
+        numSubTasks,
+        [&](size_t subTask) {
+          serialThreads[curTask][subTask] = std::this_thread::get_id();
+        },
+        true);
+  });
+
+  TEST_CHECK(!ThreadedQueueWorker());
+
+  for (size_t i = 0; i < numTasks; i++) {
+    // Nested queues stay parallel unless asked otherwise
+    for (auto &t : threads[i]) {
+      TEST_CHECK((t != outerThreads[i]));
+    }
+
+    for (auto &t : serialThreads[i]) {
+      TEST_CHECK((t == outerThreads[i]));
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,49 @@
+#include "spike/crypto/murmur3.hpp"
+#include "spike/util/unit_testing.hpp"
+#include <string>
+
+int test_murmur3() {
+  {
+    Murmur3Hash128 hasher;
+    hasher.Update("The quick brown fox jumps over the lazy dog");
+    const Hash128 hash = hasher.Finish();
+    TEST_EQUAL(hash.low, 0xe34bbc7bbc071b6c);
+    TEST_EQUAL(hash.high, 0x7a433ca9c49a9347);
+  }
+
+  {
+    Murmur3Hash128 hasher(42);
+    hasher.Update("hello");
+    const Hash128 hash = hasher.Finish();
+    TEST_EQUAL(hash.low, 0xc4b8b3c960af6f08);
+    TEST_EQUAL(hash.high, 0x2334b875b0efbc7a);
+  }
+
+  TEST_CHECK((Murmur3Hash128().Finish() == Hash128{}));
+
+  std::string data;
+
+  for (size_t i = 0; i < 1024; i++) {
+    data.push_back(char(i));
+  }
+
+  data.append("abc");
+
+  // Chunk sizes must not affect result
+  for (size_t chunkSize : {1, 3, 15, 16, 17, 100, 2000}) {
+    Murmur3Hash128 hasher;
+    std::string_view rest(data);
+
+    while (!rest.empty()) {
+      const size_t size = std::min(rest.size(), chunkSize);
+      hasher.Update(rest.substr(0, size));
+      rest.remove_prefix(size);
+    }
+
+    const Hash128 hash = hasher.Finish();
+    TEST_EQUAL(hash.low, 0xde9a64cb9b02e144);
+    TEST_EQUAL(hash.high, 0xb1baf64c19221050);
+  }
+
+  return 0;
+}
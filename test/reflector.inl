@@ -155,6 +155,16 @@ int test_reflector_bool(reflClass &input) {
   TEST_EQUAL(cPair.name, "test1");
   TEST_EQUAL(cPair.value, "false");
 
+  TEST_EQUAL(member.ReflectValue("Yes"), ReflectorMember::ErrorType::None);
+  TEST_EQUAL(input.test1, true);
+  TEST_EQUAL(member.ReflectValue("off"), ReflectorMember::ErrorType::None);
+  TEST_EQUAL(input.test1, false);
+  TEST_EQUAL(member.ReflectValue("1"), ReflectorMember::ErrorType::None);
+  TEST_EQUAL(input.test1, true);
+  TEST_EQUAL(member.ReflectValue("truest"),
+             ReflectorMember::ErrorType::InvalidFormat);
+  TEST_EQUAL(input.test1, false);
+
   TEST_EQUAL(member.ReflectValue("   TrUE   "),
              ReflectorMember::ErrorType::None);
   TEST_EQUAL(input.test1, true);
@@ -222,6 +232,12 @@ int test_reflector_int8(reflClass &input) {
   TEST_EQUAL(cPair.name, "test2");
   TEST_EQUAL(cPair.value, "127");
 
+  TEST_EQUAL(member.ReflectValue("-0o17"), ReflectorMember::ErrorType::None);
+  TEST_EQUAL(input.test2, -017);
+
+  TEST_EQUAL(member.ReflectValue("+0X1f"), ReflectorMember::ErrorType::None);
+  TEST_EQUAL(input.test2, 0x1f);
+
   TEST_EQUAL(member.ReflectValue("-0x80"), ReflectorMember::ErrorType::None);
   TEST_EQUAL(input.test2, -0x80);
   cPair = member.ReflectedPair();
@@ -716,6 +732,16 @@ int test_reflector_float(reflClass &input) {
   TEST_EQUAL(cPair.name, "test10");
   TEST_EQUAL(cPair.value, "inf");
 
+  TEST_EQUAL(member.ReflectValue("0x1.8p1"), ReflectorMember::ErrorType::None);
+  TEST_EQUAL(input.test10, 3.f);
+
+  TEST_EQUAL(member.ReflectValue("+2.5e-1"), ReflectorMember::ErrorType::None);
+  TEST_EQUAL(input.test10, 0.25f);
+
+  TEST_EQUAL(member.ReflectValue("-0.00001e-50"),
+             ReflectorMember::ErrorType::OutOfRange);
+  TEST_EQUAL(input.test10, -FLT_MIN);
+
   TEST_EQUAL(member.ReflectValue("-inf"), ReflectorMember::ErrorType::None);
   TEST_EQUAL(input.test10, -INFINITY);
   cPair = member.ReflectedPair();
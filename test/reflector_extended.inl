@@ -25,6 +25,51 @@ int test_reflector_alias() {
   return 0;
 }
 
+int test_reflector_hash_tables() {
+  for (auto &[hash, refl] : reflectorStatic::Registry()) {
+    if (!refl->nTypes) {
+      continue;
+    }
+
+    TEST_CHECK(refl->memberTable);
+
+    for (uint32 t = 0; t < refl->nTypes; t++) {
+      const JenHash nameHash = refl->types[t].valueNameHash;
+      const int32 found = refl->memberTable->Find(nameHash.raw());
+      TEST_GT_EQ(found, 0);
+      TEST_EQUAL(refl->types[found].valueNameHash, nameHash);
+
+      if (refl->typeAliasHashes && refl->typeAliasHashes[t].raw()) {
+        const JenHash aliasHash = refl->typeAliasHashes[t];
+        const int32 foundAlias = refl->memberTable->Find(aliasHash.raw());
+        TEST_GT_EQ(foundAlias, 0);
+        const bool matches =
+            refl->typeAliasHashes[foundAlias] == aliasHash ||
+            refl->types[foundAlias].valueNameHash == aliasHash;
+        TEST_CHECK(matches);
+      }
+    }
+  }
+
+  for (auto &[hash, refl] : ReflectedEnum::Registry()) {
+    TEST_CHECK(refl->nameTable);
+
+    for (uint32 e = 0; e < refl->numMembers; e++) {
+      const std::string_view name = refl->names[e];
+      const int32 found = refl->nameTable->Find(JenHash(name).raw());
+      TEST_GT_EQ(found, 0);
+      TEST_EQUAL(std::string_view(refl->names[found]), name);
+    }
+  }
+
+  roomInfo cClass{};
+  auto refInterface = ReflectorWrap<decltype(cClass)>(cClass);
+  TEST_NOT_CHECK(refInterface["room_densityy"]);
+  TEST_CHECK(refInterface["roomDensity"]);
+
+  return 0;
+}
+
 int test_reflector_desc() {
   roomInfo01 cClass{};
   auto refInterface = ReflectorWrap<decltype(cClass)>(cClass);
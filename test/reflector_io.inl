@@ -1,5 +1,6 @@
 #pragma once
 #include "reflector_decl_io.inl"
+#include <sstream>
 
 int test_reflector_io(reflClass &rClass) {
   {
@@ -17,3 +18,62 @@ int test_reflector_io(reflClass &rClass) {
 
   return compare_classes(rClass, rClass2);
 }
+
+int test_reflector_io_array(reflClass &rClass) {
+  reflClass items[3]{rClass, rClass, rClass};
+  items[1].test6 = -1586954;
+  items[1].test80 = "second item";
+  items[2].test9 = 0x123456789abcdef;
+  items[2].test41[1] = -5;
+
+  std::stringstream single;
+  std::stringstream array;
+
+  for (auto &item : items) {
+    TEST_NOT_CHECK(ReflectorBinUtil::Save(item, single));
+  }
+
+  TEST_NOT_CHECK(ReflectorBinUtil::SaveArray(
+      std::span<const reflClass>(items), BinWritterRef(array)));
+  TEST_EQUAL(single.str(), array.str());
+
+  reflClass loaded[3]{};
+  TEST_NOT_CHECK(ReflectorBinUtil::LoadArray(std::span<reflClass>(loaded),
+                                             BinReaderRef(array)));
+
+  for (size_t i = 0; i < 3; i++) {
+    if (int rVal = compare_classes(items[i], loaded[i])) {
+      return rVal;
+    }
+  }
+
+  return 0;
+}
+
+int test_reflector_io_corrupt(reflClass &rClass) {
+  std::stringstream stream;
+  TEST_NOT_CHECK(ReflectorBinUtil::Save(rClass, stream));
+  std::string data = stream.str();
+
+  auto SkipVarint = [&](size_t pos) {
+    while (uint8(data[pos]) & 0x80) {
+      pos++;
+    }
+
+    return pos + 1;
+  };
+
+  // class hash, class chunk size, number of members, member hash
+  const size_t memberSize =
+      SkipVarint(SkipVarint(sizeof(JenHash))) + sizeof(JenHash);
+  const size_t memberSizeEnd = SkipVarint(memberSize);
+  // Member chunk size past end of class chunk must not be allocated
+  data.replace(memberSize, memberSizeEnd - memberSize, "\xff\xff\xff\xff\x0f");
+
+  std::stringstream corrupt(data);
+  reflClass rClass2 = {};
+  TEST_THROW(es::UnexpectedEOS,
+             ReflectorBinUtil::Load(rClass2, BinReaderRef(corrupt)););
+
+  return 0;
+}
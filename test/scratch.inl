@@ -0,0 +1,35 @@
+#include "spike/util/scratch.hpp"
+#include "spike/util/unit_testing.hpp"
+
+int test_scratch() {
+  ScratchArena arena;
+  std::span<uint8> first = arena.Allocate<uint8>(3, 0xab);
+  std::span<uint64> second = arena.Allocate<uint64>(5, 7);
+
+  TEST_CHECK((reinterpret_cast<uintptr_t>(second.data()) % 8 == 0));
+  TEST_CHECK((first[2] == 0xab));
+  TEST_CHECK((second[4] == 7));
+
+  {
+    ScratchScope scope(arena);
+    // Larger than initial block, new block must be created
+    std::span<char> big = arena.Allocate<char>(0x20000, 'x');
+    TEST_CHECK((big.back() == 'x'));
+  }
+
+  // Memory after scope end is reused
+  std::span<uint64> third = arena.Allocate<uint64>(1);
+  TEST_CHECK((third.data() == second.data() + 5));
+  TEST_CHECK((first[0] == 0xab));
+
+  arena.Reset();
+
+  // Blocks are joined, all allocations fit into a single block
+  std::span<uint8> afterReset = arena.Allocate<uint8>(0x20000);
+  std::span<uint8> afterReset2 = arena.Allocate<uint8>(0x100);
+  TEST_CHECK((afterReset2.data() == afterReset.data() + afterReset.size()));
+
+  TEST_CHECK((&ThreadScratch() == &ThreadScratch()));
+
+  return 0;
+}
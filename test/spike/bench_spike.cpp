@@ -0,0 +1,304 @@
+#include "spike/app/cache.hpp"
+#include "spike/app/console.hpp"
+#include "spike/app/tmp_storage.hpp"
+#include "spike/crypto/crc32.hpp"
+#include "spike/gpu/BlockDecoder.inl"
+#include "spike/io/binwritter.hpp"
+#include "spike/io/directory_scanner.hpp"
+#include "spike/io/stat.hpp"
+#include "spike/reflect/reflector_io.hpp"
+#include "spike/uni/format.hpp"
+#include "spike/util/unit_testing.hpp"
+#include <random>
+#include <sstream>
+
+static std::mt19937 randomEngine(0x5EED);
+
+static std::string RandomBuffer(size_t size) {
+  std::string retVal(size, 0);
+  std::uniform_int_distribution<int> dist(0, 255);
+
+  for (auto &c : retVal) {
+    c = char(dist(randomEngine));
+  }
+
+  return retVal;
+}
+
+static std::vector<std::string> RandomPaths(size_t count) {
+  static const char *extensions[]{".dds", ".tex", ".bin", ".json", ".gltf"};
+  std::vector<std::string> retVal;
+  retVal.reserve(count);
+
+  for (size_t i = 0; i < count; i++) {
+    retVal.emplace_back("data/folder_" + std::to_string(i % 97) + "/sub_" +
+                        std::to_string(i % 13) + "/file_" + std::to_string(i) +
+                        extensions[i % std::size(extensions)]);
+  }
+
+  return retVal;
+}
+
+int bench_crc32() {
+  const std::string buffer = RandomBuffer(0x100000);
+
+  TEST_BENCH("crc32b/1MB", buffer.size(), {
+    es::DoNotOptimize(crc32b(0, buffer.data(), buffer.size()));
+  });
+
+  return 0;
+}
+
+int bench_block_decode() {
+  constexpr uint32 NUM_BLOCKS = 64;
+  const std::string bc1 = RandomBuffer(NUM_BLOCKS * NUM_BLOCKS * 8);
+  const std::string bc3 = RandomBuffer(NUM_BLOCKS * NUM_BLOCKS * 16);
+  std::string rgb(NUM_BLOCKS * NUM_BLOCKS * 16 * 3 + 1, 0);
+  std::string rgba(NUM_BLOCKS * NUM_BLOCKS * 16 * 4, 0);
+
+  TEST_BENCH("BlockDecoder/BC1/256x256", bc1.size(), {
+    for (uint32 h = 0; h < NUM_BLOCKS; h++) {
+      for (uint32 w = 0; w < NUM_BLOCKS; w++) {
+        DecodeBC1Block(bc1.data() + (h * NUM_BLOCKS + w) * 8, rgb.data(), w, h,
+                       NUM_BLOCKS);
+      }
+    }
+    es::DoNotOptimize(rgb);
+  });
+
+  TEST_BENCH("BlockDecoder/BC3/256x256", bc3.size(), {
+    for (uint32 h = 0; h < NUM_BLOCKS; h++) {
+      for (uint32 w = 0; w < NUM_BLOCKS; w++) {
+        DecodeBC3Block(bc3.data() + (h * NUM_BLOCKS + w) * 16, rgba.data(), w,
+                       h, NUM_BLOCKS);
+      }
+    }
+    es::DoNotOptimize(rgba);
+  });
+
+  return 0;
+}
+
+int bench_format_codec() {
+  using namespace uni;
+  constexpr size_t NUM_ELEMENTS = 0x10000;
+  const std::string halfs = RandomBuffer(NUM_ELEMENTS * 8);
+  const std::string bytes = RandomBuffer(NUM_ELEMENTS * 4);
+  FormatCodec::fvec out(NUM_ELEMENTS);
+
+  auto &halfCodec =
+      FormatCodec::Get({FormatType::FLOAT, DataType::R16G16B16A16});
+  TEST_BENCH("FormatCodec/FLOAT_R16G16B16A16/64K", halfs.size(), {
+    halfCodec.Sample(out, halfs.data(), NUM_ELEMENTS);
+    es::DoNotOptimize(out.data());
+  });
+
+  auto &unormCodec = FormatCodec::Get({FormatType::UNORM, DataType::R8G8B8A8});
+  TEST_BENCH("FormatCodec/UNORM_R8G8B8A8/64K", bytes.size(), {
+    unormCodec.Sample(out, bytes.data(), NUM_ELEMENTS);
+    es::DoNotOptimize(out.data());
+  });
+
+  return 0;
+}
+
+int bench_path_filter() {
+  const auto paths = RandomPaths(4096);
+  PathFilter filter;
+  filter.AddFilter(std::string("^data/folder_1"));
+  filter.AddFilter(std::string(".dds$"));
+  filter.AddFilter(std::string("sub_*/file_1"));
+
+  TEST_BENCH("PathFilter/IsFiltered/4096", 0, {
+    size_t numFiltered = 0;
+
+    for (auto &p : paths) {
+      numFiltered += filter.IsFiltered(p);
+    }
+
+    es::DoNotOptimize(numFiltered);
+  });
+
+  return 0;
+}
+
+int bench_cache_lookup() {
+  constexpr size_t NUM_FILES = 20000;
+  const auto paths = RandomPaths(NUM_FILES);
+  const std::string cachePath = es::GetTempFilename();
+
+  {
+    CacheGenerator cGen;
+
+    for (size_t i = 0; i < NUM_FILES; i++) {
+      cGen.AddFile(paths[i], i, i + 1);
+    }
+
+    BinWritter wr(cachePath);
+    cGen.WaitAndWrite(wr);
+  }
+
+  std::vector<std::string_view> queries;
+  std::uniform_int_distribution<size_t> dist(0, NUM_FILES - 1);
+
+  for (size_t i = 0; i < 4096; i++) {
+    queries.emplace_back(paths[dist(randomEngine)]);
+  }
+
+  {
+    es::MappedFile mf(cachePath);
+    Cache cache;
+    cache.Mount(mf.data);
+
+    TEST_BENCH("Cache/RequestFile/4096", 0, {
+      size_t sum = 0;
+
+      for (auto q : queries) {
+        sum += cache.RequestFile(q).size;
+      }
+
+      es::DoNotOptimize(sum);
+    });
+  }
+
+  es::RemoveFile(cachePath);
+
+  return 0;
+}
+
+struct BenchNumbers : ReflectorBase<BenchNumbers> {
+  bool flag;
+  int8 i8;
+  uint16 u16;
+  int32 i32;
+  uint64 u64;
+  float f32;
+  double f64;
+};
+
+REFLECT(CLASS(BenchNumbers), MEMBER(flag), MEMBER(i8), MEMBER(u16),
+        MEMBER(i32), MEMBER(u64), MEMBER(f32), MEMBER(f64));
+
+int bench_reflector_set_number() {
+  constexpr size_t NUM_VALUES = 1000000;
+  BenchNumbers numbers;
+  ReflectorMember members[]{
+      numbers["flag"], numbers["i8"],  numbers["u16"], numbers["i32"],
+      numbers["u64"],  numbers["f32"], numbers["f64"], numbers["i32"],
+  };
+  std::uniform_int_distribution<int64> intDist(-100000, 100000);
+  std::uniform_real_distribution<double> realDist(-1e6, 1e6);
+  std::string buffer;
+  std::vector<std::pair<size_t, size_t>> ranges;
+  ranges.reserve(NUM_VALUES);
+
+  for (size_t i = 0; i < NUM_VALUES; i++) {
+    const size_t begin = buffer.size();
+    const int64 value = intDist(randomEngine);
+
+    switch (i % std::size(members)) {
+    case 0:
+      buffer.append(value & 1 ? "true" : "False");
+      break;
+    case 1:
+      buffer.append(std::to_string(value % 128));
+      break;
+    case 2:
+      buffer.append("0x" + std::to_string(std::abs(value) % 10000));
+      break;
+    case 3:
+      buffer.append(std::to_string(value));
+      break;
+    case 4:
+      buffer.append(std::to_string(uint64(std::abs(value)) << 20));
+      break;
+    case 5:
+    case 6:
+      buffer.append(std::to_string(realDist(randomEngine)));
+      break;
+    default: {
+      char octal[32];
+      snprintf(octal, sizeof(octal), "-0o%o", unsigned(std::abs(value)));
+      buffer.append(octal);
+      break;
+    }
+    }
+
+    ranges.emplace_back(begin, buffer.size() - begin);
+  }
+
+  TEST_BENCH("Reflector/SetNumber/1M", buffer.size(), {
+    size_t numErrors = 0;
+
+    for (size_t i = 0; i < NUM_VALUES; i++) {
+      auto [begin, size] = ranges[i];
+      numErrors +=
+          members[i % std::size(members)].ReflectValue(
+              std::string_view(buffer.data() + begin, size)) !=
+          ReflectorMember::ErrorType::None;
+    }
+
+    es::DoNotOptimize(numErrors);
+  });
+
+  return 0;
+}
+
+int bench_reflector_io() {
+  std::vector<BenchNumbers> items(4096);
+  std::uniform_int_distribution<int32> dist(-100000, 100000);
+
+  for (auto &item : items) {
+    item.flag = dist(randomEngine) & 1;
+    item.i8 = int8(dist(randomEngine));
+    item.u16 = uint16(dist(randomEngine));
+    item.i32 = dist(randomEngine);
+    item.u64 = uint64(dist(randomEngine)) << 24;
+    item.f32 = float(dist(randomEngine));
+    item.f64 = double(dist(randomEngine));
+  }
+
+  std::stringstream stream;
+  BinWritterRef wr(stream);
+  ReflectorBinUtil::SaveArray(std::span<const BenchNumbers>(items), wr);
+  const size_t streamSize = stream.str().size();
+
+  TEST_BENCH("ReflectorBinUtil/SaveArray/4096", streamSize, {
+    stream.seekp(0);
+    es::DoNotOptimize(
+        ReflectorBinUtil::SaveArray(std::span<const BenchNumbers>(items), wr));
+  });
+
+  TEST_BENCH("ReflectorBinUtil/LoadArray/4096", streamSize, {
+    stream.seekg(0);
+    BinReaderRef rd(stream);
+    es::DoNotOptimize(
+        ReflectorBinUtil::LoadArray(std::span<BenchNumbers>(items), rd));
+  });
+
+  return 0;
+}
+
+// usage: bench_spike [results.json]
+int main(int argc, char *argv[]) {
+  es::SetupWinApiConsole();
+  es::print::AddPrinterFunction(es::Print);
+  InitTempStorage();
+
+  struct S {
+    ~S() { CleanCurrentTempStorage(); }
+  } s;
+
+  TEST_CASES(int testResult, TEST_FUNC(bench_crc32),
+             TEST_FUNC(bench_block_decode), TEST_FUNC(bench_format_codec),
+             TEST_FUNC(bench_path_filter), TEST_FUNC(bench_cache_lookup),
+             TEST_FUNC(bench_reflector_set_number),
+             TEST_FUNC(bench_reflector_io));
+
+  if (argc > 1) {
+    BinWritter_t<BinCoreOpenMode::Text> wr(argv[1]);
+    es::WriteBenchResults(wr.BaseStream());
+  }
+
+  return testResult;
+}
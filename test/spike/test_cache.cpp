@@ -1,11 +1,28 @@
+#include "daemon.hpp"
 #include "spike/app/cache.hpp"
 #include "spike/app/console.hpp"
+#include "spike/app/context.hpp"
+#include "spike/app/manifest.hpp"
+#include "spike/app/module_index.hpp"
+#include "spike/app/out_context.hpp"
 #include "spike/app/tmp_storage.hpp"
+#include "spike/io/binreader.hpp"
 #include "spike/io/binwritter.hpp"
 #include "spike/io/directory_scanner.hpp"
 #include "spike/io/stat.hpp"
+#include "spike/reflect/reflector.hpp"
 #include "spike/util/supercore.hpp"
 #include "spike/util/unit_testing.hpp"
+#include <filesystem>
+#include <thread>
+
+#if !defined(_MSC_VER) && !defined(__MINGW64__)
+#include <csignal>
+#include <dlfcn.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 int test_dirscan() {
   DirectoryScanner sc;
@@ -45,6 +62,456 @@ int test_dirscan() {
   return 0;
 }
 
+int test_manifest() {
+  const std::string input = RequestTempFile();
+  const std::string output = RequestTempFile();
+  const std::string manifestPath = RequestTempFile();
+  auto WriteFile = [](const std::string &path, std::string_view data) {
+    BinWritter wr(path);
+    wr.WriteContainer(data);
+  };
+
+  WriteFile(input, "input data");
+  WriteFile(output, "output data");
+
+  auto IsUpToDate = [&](std::string_view moduleId, bool contentHash) {
+    BatchManifest manifest(manifestPath, std::string(moduleId), contentHash);
+    auto iCtx = MakeIOContext(input);
+    return manifest.IsUpToDate(iCtx.get());
+  };
+
+  for (bool contentHash : {false, true}) {
+    {
+      BatchManifest manifest(manifestPath, "module", contentHash);
+      auto iCtx = MakeIOContext(input);
+      TEST_CHECK(!manifest.IsUpToDate(iCtx.get()));
+      iCtx->outputFiles.emplace({output});
+      manifest.Record(iCtx.get());
+      manifest.Save();
+    }
+
+    TEST_CHECK(IsUpToDate("module", contentHash));
+    TEST_CHECK(!IsUpToDate("module", !contentHash));
+    TEST_CHECK(!IsUpToDate("other module", contentHash));
+  }
+
+  // Missing output invalidates entry
+  es::RemoveFile(output);
+  TEST_CHECK(!IsUpToDate("module", true));
+  WriteFile(output, "output data");
+
+  // Rewritten with same contents
+  WriteFile(input, "input data");
+  TEST_CHECK(IsUpToDate("module", true));
+  WriteFile(input, "input dat4");
+  TEST_CHECK(!IsUpToDate("module", true));
+
+  // Changed companion file invalidates entry
+  const std::string companion = RequestTempFile();
+  WriteFile(companion, "companion");
+
+  {
+    BatchManifest manifest(manifestPath, "module", true);
+    auto iCtx = MakeIOContext(input);
+    TEST_CHECK(!manifest.IsUpToDate(iCtx.get()));
+    iCtx->outputFiles.emplace({output});
+    iCtx->requestedFiles.emplace();
+    iCtx->RequestFile(companion);
+    TEST_EQUAL(iCtx->requestedFiles->size(), 1);
+    manifest.Record(iCtx.get());
+    manifest.Save();
+  }
+
+  TEST_CHECK(IsUpToDate("module", true));
+  WriteFile(companion, "companion changed");
+  TEST_CHECK(!IsUpToDate("module", true));
+
+  // Damaged manifest is discarded
+  WriteFile(manifestPath, R"({"module": "module", "content_hash": true, )"
+                          R"("entries": {"a": {"size": "bad"}}})");
+  TEST_CHECK(!IsUpToDate("module", true));
+
+  return 0;
+}
+
+int test_dedup() {
+  const std::string data(0x1000, 'x');
+  auto WriteZIP = [&](const std::string &path, bool deduplicate) {
+    ZIPExtactContext ctx(path);
+    ctx.deduplicate = deduplicate;
+    ctx.NewFile("a.bin");
+    ctx.SendData(data);
+    ctx.NewFile("b.bin");
+    ctx.SendData(data);
+    ctx.NewFile("c.bin");
+    ctx.SendData("unique");
+    // Dropped at the end, must not leave data past central directory
+    ctx.NewFile("d.bin");
+    ctx.SendData(data.substr(0, 0x800));
+    ctx.SendData(data.substr(0x800));
+    ctx.FinishZIP([] {});
+    return std::filesystem::file_size(path);
+  };
+
+  const std::string plainZIP = RequestTempFile();
+  const std::string dedupZIP = RequestTempFile();
+  const size_t plainSize = WriteZIP(plainZIP, false);
+  TEST_EQUAL(DeduplicatedBytes(), 0);
+  const size_t dedupSize = WriteZIP(dedupZIP, true);
+  // Local header, file name and data
+  const size_t recordSize = 30 + 5 + data.size();
+  TEST_EQUAL(DeduplicatedBytes(), recordSize * 2);
+  TEST_EQUAL(plainSize - dedupSize, recordSize * 2);
+
+  const std::string outDir = RequestTempFile() + '/';
+  mkdirs(outDir);
+
+  {
+    IOExtractContext ctx(outDir);
+    ctx.deduplicate = true;
+    ctx.NewFile("a.bin");
+    ctx.SendData(data);
+    ctx.NewFile("b.bin");
+    ctx.SendData(data);
+  }
+
+  TEST_EQUAL(DeduplicatedBytes(), recordSize * 2 + data.size());
+
+  auto ReadFile = [](const std::string &path) {
+    BinReader rd(path);
+    std::string buffer;
+    rd.ReadContainer(buffer, rd.GetSize());
+    return buffer;
+  };
+
+  TEST_CHECK((ReadFile(outDir + "b.bin") == data));
+
+  {
+    IOExtractContext ctx(outDir);
+    ctx.deduplicate = true;
+    ctx.NewFile("b.bin");
+    ctx.SendData("unique");
+  }
+
+  // Rewriting linked file must not modify original
+  TEST_CHECK((ReadFile(outDir + "a.bin") == data));
+  TEST_CHECK((ReadFile(outDir + "b.bin") == "unique"));
+
+  // Original changed behind index, like hash collision of different contents
+  const std::string other(data.size(), 'y');
+
+  {
+    BinWritter wr(outDir + "a.bin");
+    wr.WriteContainer(other);
+  }
+
+  const size_t dedupBytes = DeduplicatedBytes();
+
+  {
+    IOExtractContext ctx(outDir);
+    ctx.deduplicate = true;
+    ctx.NewFile("c.bin");
+    ctx.SendData(data);
+  }
+
+  TEST_EQUAL(DeduplicatedBytes(), dedupBytes);
+  TEST_CHECK((ReadFile(outDir + "a.bin") == other));
+  TEST_CHECK((ReadFile(outDir + "c.bin") == data));
+
+  return 0;
+}
+
+int test_zip_merge() {
+  const std::string outZIP = RequestTempFile();
+  const size_t numWorkers = 8;
+  const size_t numFiles = 16;
+  auto FileData = [](size_t worker, size_t file) {
+    return std::string(worker * 1000 + file, char('a' + worker));
+  };
+  auto FileName = [](size_t worker, size_t file) {
+    return std::to_string(worker) + '/' + std::to_string(file) + ".bin";
+  };
+
+  {
+    ZIPMerger merger(outZIP, outZIP + ".entries");
+    std::vector<std::thread> workers;
+
+    for (size_t w = 0; w < numWorkers; w++) {
+      workers.emplace_back([&, w] {
+        const std::string recordsFile = outZIP + std::to_string(w);
+        ZIPExtactContext ctx(recordsFile, false);
+
+        for (size_t f = 0; f < numFiles; f++) {
+          ctx.NewFile(FileName(w, f));
+          ctx.SendData(FileData(w, f));
+        }
+
+        merger.Merge(ctx, recordsFile);
+      });
+    }
+
+    for (auto &w : workers) {
+      w.join();
+    }
+
+    merger.FinishMerge([] {});
+  }
+
+  es::MappedFile zipFile(outZIP);
+  es::MappedFile cacheFile(outZIP + ".cache");
+  Cache iCache;
+  iCache.Mount(cacheFile.data);
+
+  for (size_t w = 0; w < numWorkers; w++) {
+    for (size_t f = 0; f < numFiles; f++) {
+      ZipEntry entry = iCache.RequestFile(FileName(w, f));
+      const std::string data = FileData(w, f);
+      TEST_EQUAL(entry.size, data.size());
+      std::string_view stored(static_cast<const char *>(zipFile.data) +
+                                  entry.offset,
+                              entry.size);
+      TEST_CHECK((stored == data));
+    }
+  }
+
+  return 0;
+}
+
+int test_resident_mounts() {
+  auto WriteFile = [](const std::string &path, std::string_view data) {
+    BinWritter wr(path);
+    wr.WriteContainer(data);
+  };
+
+  const std::string files[]{RequestTempFile() + "a", RequestTempFile() + "b",
+                            RequestTempFile() + "c"};
+
+  for (auto &f : files) {
+    WriteFile(f, f);
+  }
+
+  SetResidentMounts(2);
+  auto mountA = MountFile(files[0]);
+  TEST_CHECK((MountFile(files[0]) == mountA));
+
+  // Least recently used mount is evicted
+  MountFile(files[1]);
+  MountFile(files[2]);
+  TEST_CHECK((MountFile(files[0]) != mountA));
+
+  // Changed file is mapped again
+  auto mountC = MountFile(files[2]);
+  TEST_CHECK((MountFile(files[2]) == mountC));
+  WriteFile(files[2], "changed contents");
+  auto newMountC = MountFile(files[2]);
+  TEST_CHECK((newMountC != mountC));
+  TEST_EQUAL(newMountC->fileSize, 16);
+
+  SetResidentMounts(0);
+  TEST_CHECK((MountFile(files[0]) != MountFile(files[0])));
+
+  return 0;
+}
+
+int test_module_index() {
+  const std::string appFolder = RequestTempFile() + '/';
+  const std::string modulePath = appFolder + "testmod.1.spk";
+  const std::string indexPath = appFolder + "test.modules";
+  mkdirs(appFolder);
+  std::filesystem::copy_file(TEST_MODULE_PATH, modulePath);
+  using Matches = std::vector<std::string>;
+
+  {
+    ModuleIndex index(appFolder, "test");
+    TEST_EQUAL(index.Entries().size(), 1);
+    TEST_CHECK(!index.Entries().at("testmod.1.spk").probed);
+    TEST_CHECK((index.Match("some/file.test") == Matches{"testmod"}));
+    TEST_CHECK(index.Match("some/file.test.other").empty());
+    TEST_CHECK(index.Match("some/file").empty());
+
+    auto &entry = index.Entries().at("testmod.1.spk");
+    TEST_CHECK(entry.probed);
+    TEST_EQUAL(entry.header, "Test module");
+    TEST_CHECK(!entry.batchControl);
+    TEST_CHECK((entry.filters == Matches{".test$"}));
+    index.Save();
+  }
+
+  TEST_CHECK((FileType(indexPath) == FileType_e::File));
+
+  auto LoadIndexFile = [&] {
+    BinReader rd(indexPath);
+    std::string data;
+    rd.ReadContainer(data, rd.GetSize());
+    return data;
+  };
+
+  // Unchanged module is not loaded again, filters are taken from index
+  std::string indexData = LoadIndexFile();
+  const size_t filterPos = indexData.find(".test$");
+  TEST_CHECK((filterPos != indexData.npos));
+  indexData.replace(filterPos, 6, ".othr$");
+
+  {
+    BinWritter wr(indexPath);
+    wr.WriteContainer(indexData);
+  }
+
+  {
+    ModuleIndex index(appFolder, "test");
+    TEST_CHECK(index.Entries().at("testmod.1.spk").probed);
+    TEST_CHECK((index.Match("file.othr") == Matches{"testmod"}));
+    TEST_CHECK(index.Match("file.test").empty());
+    // Nothing changed, index is not written
+    index.Save();
+    TEST_EQUAL(LoadIndexFile(), indexData);
+  }
+
+  // Changed module is loaded again
+  std::filesystem::last_write_time(
+      modulePath, std::filesystem::last_write_time(modulePath) +
+                      std::chrono::seconds(10));
+
+  {
+    ModuleIndex index(appFolder, "test");
+    TEST_CHECK(!index.Entries().at("testmod.1.spk").probed);
+    TEST_CHECK((index.Match("file.test") == Matches{"testmod"}));
+    TEST_CHECK(index.Match("file.othr").empty());
+    index.Save();
+  }
+
+  {
+    ModuleIndex index(appFolder, "test");
+    TEST_CHECK(index.Entries().at("testmod.1.spk").probed);
+    TEST_CHECK((index.Match("file.test") == Matches{"testmod"}));
+  }
+
+  // Removed module is dropped from index
+  std::filesystem::remove(modulePath);
+
+  {
+    ModuleIndex index(appFolder, "test");
+    TEST_CHECK(index.Entries().empty());
+    TEST_CHECK(index.Match("file.test").empty());
+  }
+
+  return 0;
+}
+
+#if !defined(_MSC_VER) && !defined(__MINGW64__)
+int test_resident_module() {
+  const std::string appFolder = RequestTempFile() + '/';
+  const std::string modulePath = appFolder + "testmod.1.spk";
+  mkdirs(appFolder);
+  std::filesystem::copy_file(TEST_MODULE_PATH, modulePath);
+
+  auto Value = [](APPContext &ctx) -> std::string {
+    return reinterpret_cast<const Reflector &>(ctx.Settings())["value"];
+  };
+
+  auto IsLoaded = [&] {
+    void *handle = dlopen(modulePath.c_str(), RTLD_NOW | RTLD_NOLOAD);
+
+    if (handle) {
+      dlclose(handle);
+    }
+
+    return handle != nullptr;
+  };
+
+  SetResidentModules(2);
+
+  {
+    APPContext ctx("testmod", appFolder, "test");
+    TEST_EQUAL(Value(ctx), "5");
+    ctx.ApplySetting("value", "42");
+    TEST_EQUAL(Value(ctx), "42");
+  }
+
+  // Module stays loaded, settings of previous context are dropped
+  TEST_CHECK(IsLoaded());
+
+  {
+    APPContext ctx("testmod", appFolder, "test");
+    TEST_EQUAL(Value(ctx), "5");
+  }
+
+  SetResidentModules(0);
+  TEST_CHECK(!IsLoaded());
+
+  return 0;
+}
+
+static std::string daemonLog;
+
+static void CaptureLog(const char *line) { daemonLog.append(line); }
+
+static int DaemonTestJob(int argc, char *argv[]) {
+  printline("job " << argv[1] << ' ' << argc << ' '
+                   << std::filesystem::current_path().string());
+  return 7;
+}
+
+int test_daemon() {
+  const std::string folder = RequestTempFile();
+  const std::string socketPath = folder + "/daemon.sock";
+  TEST_EQUAL(::mkdir(folder.c_str(), 0700), 0);
+  const pid_t pid = ::fork();
+
+  if (pid == 0) {
+    ::_exit(RunDaemon(socketPath, "test", DaemonTestJob));
+  }
+
+  for (size_t i = 0; i < 250 && !std::filesystem::exists(socketPath); i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+
+  auto Submit = [&](std::vector<std::string> args) {
+    std::vector<char *> argv;
+
+    for (auto &a : args) {
+      argv.push_back(a.data());
+    }
+
+    return SubmitJob(socketPath, int(argv.size()), argv.data());
+  };
+
+  es::print::AddPrinterFunction(CaptureLog, false);
+  const int jobStatus = Submit({"job", "arg"});
+  const int nestedStatus = Submit({"--daemon"});
+  const int stopStatus = Submit({"--stop-daemon"});
+  es::print::DrainQueues();
+
+  if (stopStatus != 0) {
+    ::kill(pid, SIGTERM);
+  }
+
+  int daemonStatus = -1;
+  ::waitpid(pid, &daemonStatus, 0);
+
+  TEST_EQUAL(jobStatus, 7);
+  TEST_EQUAL(nestedStatus, 1);
+  TEST_EQUAL(stopStatus, 0);
+  TEST_CHECK(WIFEXITED(daemonStatus));
+  TEST_EQUAL(WEXITSTATUS(daemonStatus), 0);
+  // Job log is streamed back and job runs in folder of client
+  const std::string expected =
+      "job job 3 " + std::filesystem::current_path().string() + '\n';
+  TEST_CHECK((daemonLog.find(expected) != daemonLog.npos));
+
+  // Socket folder accessible by other users is refused
+  TEST_EQUAL(::chmod(folder.c_str(), 0755), 0);
+  TEST_EQUAL(RunDaemon(socketPath, "test", DaemonTestJob), 1);
+  TEST_EQUAL(Submit({"job", "arg"}), 1);
+
+  return 0;
+}
+#else
+// Daemon and module residency checks rely on POSIX
+int test_resident_module() { return 0; }
+int test_daemon() { return 0; }
+#endif
+
 int main() {
   setlocale(LC_ALL, "C.UTF-8");
   setlocale(LC_NUMERIC, "en-US");
@@ -58,7 +525,10 @@ int main() {
 
   printline("Printed some line into console and logger.");
 
-  TEST_CASES(int testResult, TEST_FUNC(test_dirscan));
+  TEST_CASES(int testResult, TEST_FUNC(test_dirscan), TEST_FUNC(test_manifest),
+             TEST_FUNC(test_dedup), TEST_FUNC(test_zip_merge),
+             TEST_FUNC(test_resident_mounts), TEST_FUNC(test_module_index),
+             TEST_FUNC(test_resident_module), TEST_FUNC(test_daemon));
 
   return testResult;
 }
@@ -0,0 +1,21 @@
+#include "spike/app_context.hpp"
+#include "spike/reflect/reflector.hpp"
+
+// Minimal module for context tests
+struct TestModuleSettings : ReflectorBase<TestModuleSettings> {
+  uint32 value = 5;
+} settings;
+
+REFLECT(CLASS(TestModuleSettings), MEMBER(value));
+
+static std::string_view filters[]{".test$"};
+
+static AppInfo_s appInfo{
+    .header = "Test module",
+    .settings = reinterpret_cast<ReflectorFriend *>(&settings),
+    .filters = filters,
+};
+
+AppInfo_s *AppInitModule() { return &appInfo; }
+
+void AppProcessFile(AppContext *) {}
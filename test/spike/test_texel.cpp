@@ -4,6 +4,7 @@
 #include "spike/io/binreader.hpp"
 #include "spike/io/binwritter.hpp"
 #include "spike/io/fileinfo.hpp"
+#include "spike/util/unit_testing.hpp"
 
 TexelConf &TexelSettings() { return mainSettings.texelSettings; }
 
@@ -231,6 +232,169 @@ void ConvertNX(std::string_view path, TexelInputFormatType fmt) {
   }
 }
 
+struct CaptureOutput : TexelOutput {
+  std::string data;
+  void SendData(std::string_view data_) override { data.append(data_); }
+  void NewFile(std::string) override { data.clear(); }
+};
+
+int CheckEquirect(uint16 faceSize) {
+  const uint32 faceTexels = uint32(faceSize) * faceSize;
+  std::vector<uint32> faces(faceTexels * 6);
+
+  for (uint32 f = 0; f < 6; f++) {
+    std::fill_n(faces.begin() + f * faceTexels, faceTexels,
+                0xff000000 | (f * 5) << 16 | (255 - f * 30) << 8 | f * 40);
+  }
+
+  auto appContext = MakeIOContext("resources/rgba8_cube.dds");
+  CaptureOutput capture;
+  NewTexelContextCreate nctx{
+      .width = faceSize,
+      .height = faceSize,
+      .baseFormat =
+          {
+              .type = TexelInputFormatType::RGBA8,
+          },
+      .numFaces = 6,
+      .data = faces.data(),
+      .texelOutput = &capture,
+  };
+
+  TexelSettings().outputFormat = TexelContextFormat::DDS_Legacy;
+  appContext->NewImage(nctx);
+
+  DDS dds;
+  memcpy(static_cast<void *>(&dds), capture.data.data(), dds.LEGACY_SIZE);
+  TEST_EQUAL(dds.width, faceSize * 4);
+  TEST_EQUAL(dds.height, faceSize * 2);
+  TEST_EQUAL(capture.data.size(), dds.LEGACY_SIZE + faceTexels * 8 * 4);
+
+  auto Texel = [&](uint32 x, uint32 y) {
+    uint32 texel;
+    memcpy(&texel,
+           capture.data.data() + dds.LEGACY_SIZE + (y * dds.width + x) * 4, 4);
+    return texel;
+  };
+
+  auto Face = [&](CubemapFace face) {
+    return faces[(uint32(face) - 1) * faceTexels];
+  };
+
+  const uint32 midY = faceSize;
+  TEST_EQUAL(Texel(faceSize * 3, midY), Face(CubemapFace::Right));
+  TEST_EQUAL(Texel(faceSize, midY), Face(CubemapFace::Left));
+  TEST_EQUAL(Texel(faceSize * 2, 0), Face(CubemapFace::Up));
+  TEST_EQUAL(Texel(faceSize * 2, faceSize * 2 - 1), Face(CubemapFace::Down));
+  TEST_EQUAL(Texel(faceSize * 2, midY), Face(CubemapFace::Front));
+  TEST_EQUAL(Texel(0, midY), Face(CubemapFace::Back));
+
+  return 0;
+}
+
+int test_equirect() {
+  TexelSettings().cubemapToEquirectangular = true;
+  TEST_EQUAL(CheckEquirect(16), 0);
+  // Bigger than precomputed table limit
+  TEST_EQUAL(CheckEquirect(1028), 0);
+
+  // HDR cubemaps are kept native
+  constexpr uint16 FACE_SIZE = 4;
+  std::vector<uint64> faces(FACE_SIZE * FACE_SIZE * 6, 0x3c003c003c003c00);
+  auto appContext = MakeIOContext("resources/rgba8_cube.dds");
+  CaptureOutput capture;
+  NewTexelContextCreate nctx{
+      .width = FACE_SIZE,
+      .height = FACE_SIZE,
+      .baseFormat =
+          {
+              .type = TexelInputFormatType::RGBA16,
+          },
+      .numFaces = 6,
+      .data = faces.data(),
+      .texelOutput = &capture,
+  };
+
+  TexelSettings().outputFormat = TexelContextFormat::DDS;
+  appContext->NewImage(nctx);
+
+  DDS dds;
+  memcpy(static_cast<void *>(&dds), capture.data.data(), dds.LEGACY_SIZE);
+  TEST_EQUAL(dds.width, FACE_SIZE);
+  TEST_EQUAL(dds.height, FACE_SIZE);
+  TexelSettings().cubemapToEquirectangular = false;
+
+  return 0;
+}
+
+int test_mipmaps() {
+  constexpr uint16 WIDTH = 16;
+  constexpr uint16 HEIGHT = 8;
+  std::vector<uint8> texels(WIDTH * HEIGHT * 4);
+
+  for (size_t i = 0; i < texels.size(); i++) {
+    texels[i] = uint8(i * 7);
+  }
+
+  auto appContext = MakeIOContext("resources/rgba8.dds");
+  CaptureOutput capture;
+  NewTexelContextCreate nctx{
+      .width = WIDTH,
+      .height = HEIGHT,
+      .baseFormat =
+          {
+              .type = TexelInputFormatType::RGBA8,
+          },
+      .data = texels.data(),
+      .texelOutput = &capture,
+  };
+
+  TexelSettings().outputFormat = TexelContextFormat::DDS_Legacy;
+  TexelSettings().processMipMaps = true;
+  TexelSettings().generateMipMaps = true;
+  appContext->NewImage(nctx);
+
+  auto Mips = [&] {
+    DDS dds;
+    memcpy(static_cast<void *>(&dds), capture.data.data(), dds.LEGACY_SIZE);
+    const size_t headerSize =
+        dds.fourCC == DDSFormat_DX10.fourCC ? dds.DDS_SIZE : dds.LEGACY_SIZE;
+    return std::make_pair(dds.mipMapCount,
+                          std::string_view(capture.data).substr(headerSize));
+  };
+
+  auto [numMips, mipData] = Mips();
+  TEST_EQUAL(numMips, 5);
+  TEST_EQUAL(mipData.size(), (16 * 8 + 8 * 4 + 4 * 2 + 2 + 1) * 4);
+
+  // First texel of level 1 is average of top left 2x2 block
+  for (uint32 c = 0; c < 4; c++) {
+    const uint32 sum = texels[c] + texels[4 + c] + texels[WIDTH * 4 + c] +
+                       texels[WIDTH * 4 + 4 + c];
+    TEST_EQUAL(uint8(mipData[WIDTH * HEIGHT * 4 + c]), (sum + 2) / 4);
+  }
+
+  // Black and white texels are averaged in linear space for sRGB
+  const uint8 checker[]{0,   0,   0,   0,   255, 255, 255, 255,
+                        255, 255, 255, 255, 0,   0,   0,   0};
+  nctx.width = 2;
+  nctx.height = 2;
+  nctx.baseFormat.srgb = true;
+  nctx.data = checker;
+  appContext->NewImage(nctx);
+
+  std::tie(numMips, mipData) = Mips();
+  TEST_EQUAL(numMips, 2);
+  TEST_EQUAL(mipData.size(), 5 * 4);
+  TEST_EQUAL(uint8(mipData[16]), 188);
+  TEST_EQUAL(uint8(mipData[18]), 188);
+  TEST_EQUAL(uint8(mipData[19]), 128);
+
+  TexelSettings().generateMipMaps = false;
+
+  return 0;
+}
+
 int main() {
   Convert("resources/rgba8.dds", TexelInputFormatType::RGBA8);
   Convert("resources/rgba4.dds", TexelInputFormatType::RGBA4);
@@ -265,5 +429,14 @@ int main() {
   ConvertCubemap("resources/rgba8_cube.dds", TexelInputFormatType::RGBA8);
   ConvertCubemap("resources/bc3_cube_mip.dds", TexelInputFormatType::BC3);
 
-  return 0;
+  TexelSettings().cubemapToEquirectangular = true;
+  TexelSettings().processMipMaps = false;
+  ConvertCubemap("resources/rgba8_cube.dds", TexelInputFormatType::RGBA8);
+  ConvertCubemap("resources/bc3_cube_mip.dds", TexelInputFormatType::BC3);
+  TexelSettings().cubemapToEquirectangular = false;
+
+  TEST_CASES(int testResult, TEST_FUNC(test_equirect),
+             TEST_FUNC(test_mipmaps));
+
+  return testResult;
 }
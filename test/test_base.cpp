@@ -3,13 +3,18 @@
 
 //#include "allocator_hybrid.inl"
 #include "bitfield.inl"
+#include "classgen.inl"
 #include "endian.inl"
 #include "fileinfo.inl"
 #include "flags.inl"
 #include "float.inl"
 #include "matrix44.inl"
 #include "multi_thread.inl"
+#include "murmur3.inl"
+#include "scratch.inl"
+#include "trace.inl"
 #include "vector_simd.inl"
+#include "xorenc.inl"
 
 #include "base128.inl"
 #include "bincore.inl"
@@ -38,8 +43,12 @@ int main() {
              TEST_FUNC(test_vector_simd_02), TEST_FUNC(test_vector_simd_03),
              TEST_FUNC(test_vector_simd_10), TEST_FUNC(test_vector_simd_11),
              TEST_FUNC(test_vector_simd_12), TEST_FUNC(test_mt_thread00),
-             TEST_FUNC(test_mt_thread01), TEST_FUNC(test_base128),
-             TEST_FUNC(test_ubase128));
+             TEST_FUNC(test_mt_thread01), TEST_FUNC(test_mt_thread_nested),
+             TEST_FUNC(test_base128), TEST_FUNC(test_ubase128),
+             TEST_FUNC(test_base128_bulk), TEST_FUNC(test_classgen),
+             TEST_FUNC(test_classgen_reused_storage),
+             TEST_FUNC(test_xorenc), TEST_FUNC(test_trace),
+             TEST_FUNC(test_scratch), TEST_FUNC(test_murmur3));
 
   return testResult;
 }
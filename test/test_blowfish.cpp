@@ -1,7 +1,11 @@
 #include "spike/crypto/blowfish2.h"
 #include "spike/io/stat.hpp"
 #include "spike/util/unit_testing.hpp"
+#include <chrono>
 #include <cstring>
+#include <random>
+#include <string>
+#include <vector>
 
 using namespace std::string_view_literals;
 
@@ -142,6 +146,156 @@ int test_blowfish2() {
   return 0;
 }
 
+static std::vector<uint64> MakeBulkBuffer(size_t size) {
+  std::vector<uint64> buffer(size / 8);
+  std::mt19937_64 eng(0x1234);
+
+  for (auto &b : buffer) {
+    b = eng();
+  }
+
+  return buffer;
+}
+
+// Per block paths that bulk paths don't use, CFB encodes its vector and
+// PCBC decodes first block xored with vector
+template <class Encoder> static uint64 ReferenceEncode(uint64 block) {
+  Encoder bf;
+  bf.SetKey(KEY);
+  bf.mode = IBlockEncryptor::Mode::CFB;
+  bf.Vector(block);
+  uint64 retVal = 0;
+  bf.Encode(reinterpret_cast<char *>(&retVal), sizeof(retVal));
+  return retVal;
+}
+
+template <class Encoder> static uint64 ReferenceDecode(uint64 block) {
+  Encoder bf;
+  bf.SetKey(KEY);
+  bf.mode = IBlockEncryptor::Mode::PCBC;
+  bf.Vector(0);
+  bf.Decode(reinterpret_cast<char *>(&block), sizeof(block));
+  return block;
+}
+
+// First blocks, blocks spread over all thread ranges and last block
+static std::vector<size_t> SampleBlocks(size_t numBlocks) {
+  std::vector<size_t> retVal;
+
+  for (size_t b = 0; b < 64; b++) {
+    retVal.push_back(b);
+  }
+
+  for (size_t b = 64; b < numBlocks; b += numBlocks / 61 + 3) {
+    retVal.push_back(b);
+  }
+
+  retVal.push_back(numBlocks - 1);
+
+  return retVal;
+}
+
+template <class Encoder> int test_bulk(IBlockEncryptor::Mode mode) {
+  Encoder bf;
+  bf.SetKey(KEY);
+  bf.Vector(VECTOR);
+  bf.mode = mode;
+  // Large enough to be split between threads
+  const size_t bufferSize = 0x1000000;
+  const auto source = MakeBulkBuffer(bufferSize);
+  auto buffer = source;
+  char *data = reinterpret_cast<char *>(buffer.data());
+
+  bf.Encode(data, bufferSize);
+
+  const auto samples = SampleBlocks(source.size());
+
+  if (mode == IBlockEncryptor::Mode::ECB) {
+    for (size_t b : samples) {
+      TEST_EQUAL(buffer[b], ReferenceEncode<Encoder>(source[b]));
+    }
+  }
+
+  {
+    // Source taken as cipher text
+    auto decoded = source;
+    bf.Decode(reinterpret_cast<char *>(decoded.data()), bufferSize);
+
+    for (size_t b : samples) {
+      uint64 expected = ReferenceDecode<Encoder>(source[b]);
+
+      if (mode == IBlockEncryptor::Mode::CBC) {
+        expected ^= b ? source[b - 1] : VECTOR;
+      }
+
+      TEST_EQUAL(decoded[b], expected);
+    }
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  bf.Decode(data, bufferSize);
+  const std::chrono::duration<double> delta =
+      std::chrono::steady_clock::now() - start;
+
+  TEST_CHECK((buffer == source));
+  printline("Decoded " << (bufferSize >> 20) << " MB at "
+                       << (bufferSize / (1024 * 1024)) / delta.count()
+                       << " MB/s");
+
+  return 0;
+}
+
+// Published test vectors for key 1111111111111111, blocks are stored as two
+// little endian halves
+int test_blowfish_bulk_vectors() {
+  struct {
+    uint64 plain;
+    uint64 cipher;
+  } static constexpr VECTORS[]{
+      {0x1111111111111111, 0x8B963C9D2466DD87},
+      {0x89ABCDEF01234567, 0xAFDA1EC77D0CC630},
+  };
+
+  BlowfishEncoder bf;
+  bf.SetKey(std::string(8, '\x11'));
+  bf.mode = IBlockEncryptor::Mode::ECB;
+  std::vector<uint64> buffer(0x200000);
+  std::mt19937 eng(0x1234);
+
+  for (auto &b : buffer) {
+    b = VECTORS[eng() & 1].plain;
+  }
+
+  const auto source = buffer;
+  bf.Encode(reinterpret_cast<char *>(buffer.data()), buffer.size() * 8);
+
+  for (size_t b = 0; b < buffer.size(); b++) {
+    const size_t v = source[b] == VECTORS[0].plain ? 0 : 1;
+    TEST_EQUAL(buffer[b], VECTORS[v].cipher);
+  }
+
+  bf.Decode(reinterpret_cast<char *>(buffer.data()), buffer.size() * 8);
+  TEST_CHECK((buffer == source));
+
+  return 0;
+}
+
+int test_blowfish_bulk_ECB() {
+  return test_bulk<BlowfishEncoder>(IBlockEncryptor::Mode::ECB);
+}
+
+int test_blowfish_bulk_CBC() {
+  return test_bulk<BlowfishEncoder>(IBlockEncryptor::Mode::CBC);
+}
+
+int test_blowfish2_bulk_ECB() {
+  return test_bulk<BlowfishEncoder2>(IBlockEncryptor::Mode::ECB);
+}
+
+int test_blowfish2_bulk_CBC() {
+  return test_bulk<BlowfishEncoder2>(IBlockEncryptor::Mode::CBC);
+}
+
 int main() {
   es::SetupWinApiConsole();
   es::print::AddPrinterFunction(es::Print);
@@ -149,7 +303,11 @@ int main() {
   TEST_CASES(int testResult, TEST_FUNC(test_blowfish_ECB),
              TEST_FUNC(test_blowfish_CBC), TEST_FUNC(test_blowfish_CFB),
              TEST_FUNC(test_blowfish_OFB), TEST_FUNC(test_blowfish_PCBC),
-             TEST_FUNC(test_blowfish2));
+             TEST_FUNC(test_blowfish2), TEST_FUNC(test_blowfish_bulk_vectors),
+             TEST_FUNC(test_blowfish_bulk_ECB),
+             TEST_FUNC(test_blowfish_bulk_CBC),
+             TEST_FUNC(test_blowfish2_bulk_ECB),
+             TEST_FUNC(test_blowfish2_bulk_CBC));
 
   return testResult;
 }
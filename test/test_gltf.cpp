@@ -0,0 +1,1080 @@
+#include "spike/except.hpp"
+#include "spike/gltf.hpp"
+#include "spike/io/binwritter_stream.hpp"
+#include "spike/io/stat.hpp"
+#include "spike/uni/motion.hpp"
+#include "spike/util/unit_testing.hpp"
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <random>
+#include <sstream>
+
+struct Vertex {
+  float position[3];
+  int16 normal[4];
+  uint16 uv[2];
+  uint8 color[4];
+  uint8 bones[4];
+  uint8 weights[4];
+};
+
+static const Attribute ATTRIBUTES[]{
+    {uni::DataType::R32G32B32, uni::FormatType::FLOAT, AttributeType::Position},
+    {uni::DataType::R16G16B16A16, uni::FormatType::NORM, AttributeType::Normal},
+    {uni::DataType::R16G16, uni::FormatType::UNORM,
+     AttributeType::TextureCoordiante},
+    {uni::DataType::R8G8B8A8, uni::FormatType::UNORM,
+     AttributeType::VertexColor},
+    {uni::DataType::R8G8B8A8, uni::FormatType::UINT,
+     AttributeType::BoneIndices},
+    {uni::DataType::R8G8B8A8, uni::FormatType::UNORM,
+     AttributeType::BoneWeights},
+};
+
+static void SavePrimitive(GLTFModel &main, size_t index) {
+  std::mt19937 engine(index);
+  const size_t numVertices = 100 + engine() % 3000;
+  std::vector<Vertex> vertices(numVertices);
+
+  for (auto &v : vertices) {
+    for (auto &p : v.position) {
+      p = float(int32(engine() % 2000) - 1000) / 1000;
+    }
+
+    for (auto &n : v.normal) {
+      n = int16(engine());
+    }
+
+    v.uv[0] = engine();
+    v.uv[1] = engine();
+    memset(v.color, int(engine()), 4);
+    v.bones[0] = engine() % 64;
+    v.bones[1] = engine() % 64;
+    v.bones[2] = v.bones[3] = 0;
+    v.weights[0] = engine() % 256;
+    v.weights[1] = 255 - v.weights[0];
+    v.weights[2] = v.weights[3] = 0;
+  }
+
+  gltf::Primitive prim;
+  prim.attributes = main.SaveVertices(vertices.data(), numVertices, ATTRIBUTES,
+                                      sizeof(Vertex));
+
+  // Odd 16 bit index counts and 32 bit indices force unaligned accessors
+  if (index % 3 == 2) {
+    std::vector<uint32> indices(numVertices * 3 + 1);
+
+    for (auto &i : indices) {
+      i = 0x10000 + engine() % numVertices;
+    }
+
+    prim.indices =
+        main.SaveIndices(indices.data(), indices.size(), 4).accessorIndex;
+  } else {
+    std::vector<uint16> indices(numVertices * 3 + index % 2);
+
+    for (auto &i : indices) {
+      i = engine() % numVertices;
+    }
+
+    prim.indices =
+        main.SaveIndices(indices.data(), indices.size(), 2).accessorIndex;
+  }
+
+  main.meshes.emplace_back().primitives.emplace_back(std::move(prim));
+}
+
+static void OffsetPrimitive(gltf::Primitive &prim, size_t accessorBase) {
+  for (auto &[_, a] : prim.attributes) {
+    a += accessorBase;
+  }
+
+  prim.indices += accessorBase;
+}
+
+static std::string Export(GLTFModel &main) {
+  std::stringstream str;
+  BinWritterRef wr(str);
+  main.FinishAndSave(wr, "");
+  return std::move(str).str();
+}
+
+static void SetupModel(GLTFModel &main, bool quantize) {
+  if (quantize) {
+    main.QuantizeMesh(false);
+    main.transform = es::Matrix44();
+    main.transform->r4() = Vector4A16(1, 2, 3, 1);
+  }
+}
+
+static int CompareParallel(bool quantize) {
+  constexpr size_t NUM_PRIMITIVES = 24;
+  GLTFModel serial;
+  SetupModel(serial, quantize);
+
+  for (size_t i = 0; i < NUM_PRIMITIVES; i++) {
+    SavePrimitive(serial, i);
+  }
+
+  GLTFModel parallel;
+  SetupModel(parallel, quantize);
+  std::vector<gltf::Mesh> meshes(NUM_PRIMITIVES);
+
+  auto bases = parallel.SaveParallel(NUM_PRIMITIVES, [&](GLTFModel &fork,
+                                                         size_t index) {
+    SavePrimitive(fork, index);
+    meshes.at(index) = std::move(fork.meshes.front());
+    fork.meshes.clear();
+  });
+
+  TEST_EQUAL(bases.size(), NUM_PRIMITIVES);
+
+  for (size_t i = 0; i < NUM_PRIMITIVES; i++) {
+    OffsetPrimitive(meshes.at(i).primitives.front(), bases.at(i));
+    parallel.meshes.emplace_back(std::move(meshes.at(i)));
+  }
+
+  TEST_EQUAL(serial.accessors.size(), parallel.accessors.size());
+  const bool identical = Export(serial) == Export(parallel);
+  TEST_CHECK(identical);
+
+  return 0;
+}
+
+int test_gltf_merge_views() {
+  GLTFModel main;
+  SavePrimitive(main, 0);
+  const size_t numAccessors = main.accessors.size();
+  const size_t numViews = main.bufferViews.size();
+
+  // Sparse accessor views are remapped too
+  GLTFModel fork = main.Fork();
+  // Streams are created in different order than in main
+  fork.GetVt16();
+  SavePrimitive(fork, 1);
+  fork.meshes.clear();
+  TEST_CHECK((fork.GetIndexStream().index != main.GetIndexStream().index));
+  TEST_CHECK((fork.GetVt12().index != main.GetVt12().index));
+  gltf::Accessor &sparse = fork.accessors.emplace_back();
+  sparse.sparse.count = 1;
+  sparse.sparse.indices.bufferView = fork.GetIndexStream().index;
+  sparse.sparse.values.bufferView = fork.GetVt12().index;
+  const size_t base = main.Merge(std::move(fork));
+  const gltf::Accessor &merged = main.accessors.back();
+  TEST_EQUAL(base, numAccessors);
+  TEST_EQUAL(merged.bufferView, -1);
+  TEST_EQUAL(merged.sparse.indices.bufferView, main.GetIndexStream().index);
+  TEST_EQUAL(merged.sparse.values.bufferView, main.GetVt12().index);
+  // Only stream missing in main is added
+  TEST_EQUAL(main.bufferViews.size(), numViews + 1);
+
+  // Views that are not backed by streams cannot be merged
+  GLTFModel foreign = main.Fork();
+  SavePrimitive(foreign, 2);
+  foreign.meshes.clear();
+  foreign.bufferViews.emplace_back();
+  foreign.accessors.emplace_back().bufferView = foreign.bufferViews.size() - 1;
+  const size_t numMerged = main.accessors.size();
+  TEST_THROW(es::RuntimeError, main.Merge(std::move(foreign)););
+  TEST_EQUAL(main.accessors.size(), numMerged);
+
+  // Meshes and nodes are not merged, fork cannot create them
+  const size_t numMeshes = main.meshes.size();
+  GLTFModel withMesh = main.Fork();
+  SavePrimitive(withMesh, 3);
+  withMesh.nodes.emplace_back().mesh = 0;
+  TEST_THROW(es::RuntimeError, main.Merge(std::move(withMesh)););
+  TEST_EQUAL(main.accessors.size(), numMerged);
+  TEST_EQUAL(main.meshes.size(), numMeshes);
+
+  return 0;
+}
+
+int test_gltf_parallel() { return CompareParallel(false); }
+
+int test_gltf_parallel_quantized() { return CompareParallel(true); }
+
+// Triangles with rotated vertices to start with lowest one, sorted
+static std::vector<std::array<uint32, 3>>
+CanonicalTriangles(std::span<const uint32> indices) {
+  std::vector<std::array<uint32, 3>> retVal;
+
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    std::array<uint32, 3> tri{indices[i], indices[i + 1], indices[i + 2]};
+    std::rotate(tri.begin(), std::min_element(tri.begin(), tri.end()),
+                tri.end());
+    retVal.push_back(tri);
+  }
+
+  std::sort(retVal.begin(), retVal.end());
+
+  return retVal;
+}
+
+int test_gltf_vertex_cache() {
+  constexpr uint32 GRID = 64;
+  std::vector<uint32> indices;
+
+  for (uint32 y = 0; y < GRID - 1; y++) {
+    for (uint32 x = 0; x < GRID - 1; x++) {
+      const uint32 v = y * GRID + x;
+      indices.insert(indices.end(), {v, v + GRID, v + 1});
+      indices.insert(indices.end(), {v + 1, v + GRID, v + GRID + 1});
+    }
+  }
+
+  std::vector<std::array<uint32, 3>> tris(indices.size() / 3);
+  memcpy(tris.data(), indices.data(), indices.size() * sizeof(uint32));
+  std::shuffle(tris.begin(), tris.end(), std::mt19937(7));
+  memcpy(indices.data(), tris.data(), indices.size() * sizeof(uint32));
+
+  const auto reference = CanonicalTriangles(indices);
+  const size_t numVertices = GRID * GRID;
+  const size_t missesBefore =
+      gltfutils::AnalyzeVertexCache(indices, numVertices);
+  gltfutils::OptimizeVertexCache(indices, numVertices);
+  const size_t missesAfter =
+      gltfutils::AnalyzeVertexCache(indices, numVertices);
+
+  TEST_CHECK((CanonicalTriangles(indices) == reference));
+  TEST_LT(missesAfter * 2, missesBefore);
+  PrintInfo("Grid ACMR: ", float(missesBefore) / tris.size(), " -> ",
+            float(missesAfter) / tris.size());
+
+  std::vector<uint32> remapped(indices);
+  auto remap = gltfutils::OptimizeVertexFetch(remapped, numVertices);
+
+  for (size_t i = 0; i < indices.size(); i++) {
+    TEST_EQUAL(remapped[i], remap[indices[i]]);
+  }
+
+  TEST_EQUAL(remapped.front(), 0);
+  TEST_EQUAL(*std::max_element(remap.begin(), remap.end()), numVertices - 1);
+
+  return 0;
+}
+
+template <class T>
+static std::vector<T> ReadAccessor(GLTFModel &main, size_t accessorIndex) {
+  const gltf::Accessor &acc = main.accessors.at(accessorIndex);
+  std::vector<T> retVal(acc.count);
+
+  for (size_t s = 0; s < main.NumStreams(); s++) {
+    GLTFStream &stream = main.Stream(s);
+
+    if (stream.index != uint32(acc.bufferView)) {
+      continue;
+    }
+
+    const size_t stride = stream.byteStride ? stream.byteStride : sizeof(T);
+
+    for (size_t i = 0; i < acc.count; i++) {
+      // Item can be split between chunks
+      char *item = reinterpret_cast<char *>(&retVal[i]);
+      stream.arena.Read(acc.byteOffset + i * stride, sizeof(T),
+                        [&](const char *data, size_t size) {
+                          memcpy(item, data, size);
+                          item += size;
+                        });
+    }
+  }
+
+  return retVal;
+}
+
+struct EncodedVertex {
+  float position[3];
+  int16 positionNorm[4];
+  int16 normal[4];
+  float normalFloat[3];
+  uint8 uv[2];
+  float color[4];
+};
+
+// Vertex writers must produce same output as scalar encoding
+int test_gltf_vertex_encode() {
+  // Crosses chunk boundaries and ends with partial chunk
+  const size_t numVertices = 2 * 1024 + 77;
+  std::mt19937 engine(7);
+  std::vector<EncodedVertex> vertices(numVertices);
+
+  for (auto &v : vertices) {
+    for (auto &p : v.position) {
+      p = float(int32(engine() % 2000) - 1000) / 100;
+    }
+
+    for (auto &p : v.positionNorm) {
+      p = int16(int32(engine() % 0xffff) - 0x7fff);
+    }
+
+    for (auto &n : v.normal) {
+      n = int16(int32(engine() % 0xffff) - 0x7fff);
+    }
+
+    // Avoid zero length normals
+    v.normal[0] |= 1;
+
+    for (auto &n : v.normalFloat) {
+      n = float(int32(engine() % 2000) - 1000) / 1000;
+    }
+
+    v.normalFloat[1] = 0.5f;
+    v.uv[0] = engine();
+    v.uv[1] = engine();
+
+    for (auto &c : v.color) {
+      c = float(engine() % 1001) / 1000;
+    }
+  }
+
+  const size_t stride = sizeof(EncodedVertex);
+  auto Data = [&](auto member) {
+    return reinterpret_cast<const char *>(&(vertices.front().*member));
+  };
+
+  GLTFModel main;
+  GLTFModel quantized;
+  quantized.QuantizeMesh(false);
+
+  const size_t positions = main.SaveVertices(
+      Data(&EncodedVertex::position), numVertices,
+      Attribute{uni::DataType::R32G32B32, uni::FormatType::FLOAT,
+                AttributeType::Position},
+      stride);
+  const size_t positionsNorm = quantized.SaveVertices(
+      Data(&EncodedVertex::positionNorm), numVertices,
+      Attribute{uni::DataType::R16G16B16A16, uni::FormatType::NORM,
+                AttributeType::Position},
+      stride);
+  const size_t normals16 = quantized.SaveVertices(
+      Data(&EncodedVertex::normal), numVertices,
+      Attribute{uni::DataType::R16G16B16A16, uni::FormatType::NORM,
+                AttributeType::Normal},
+      stride);
+  const size_t normals32 = main.SaveVertices(
+      Data(&EncodedVertex::normalFloat), numVertices,
+      Attribute{uni::DataType::R32G32B32, uni::FormatType::FLOAT,
+                AttributeType::Normal},
+      stride);
+  const size_t uvs = main.SaveVertices(
+      Data(&EncodedVertex::uv), numVertices,
+      Attribute{uni::DataType::R8G8, uni::FormatType::UNORM,
+                AttributeType::TextureCoordiante},
+      stride);
+  const size_t colors = main.SaveVertices(
+      Data(&EncodedVertex::color), numVertices,
+      Attribute{uni::DataType::R32G32B32A32, uni::FormatType::FLOAT,
+                AttributeType::VertexColor},
+      stride);
+
+  using Vec3 = std::array<float, 3>;
+  using Short4 = std::array<int16, 4>;
+  auto outPositions = ReadAccessor<Vec3>(main, positions);
+  auto outPositionsNorm = ReadAccessor<Short4>(quantized, positionsNorm);
+  auto outNormals16 = ReadAccessor<Short4>(quantized, normals16);
+  auto outNormals32 = ReadAccessor<Vec3>(main, normals32);
+  auto outUvs = ReadAccessor<std::array<uint16, 2>>(main, uvs);
+  auto outColors = ReadAccessor<std::array<uint8, 4>>(main, colors);
+  Vec3 min{FLT_MAX, FLT_MAX, FLT_MAX};
+  Vec3 max{-FLT_MAX, -FLT_MAX, -FLT_MAX};
+  Vec3 minNorm = min;
+  Vec3 maxNorm = max;
+
+  for (size_t i = 0; i < numVertices; i++) {
+    const EncodedVertex &v = vertices[i];
+
+    for (size_t c = 0; c < 3; c++) {
+      TEST_EQUAL(outPositions[i][c], v.position[c]);
+      min[c] = std::min(min[c], v.position[c]);
+      max[c] = std::max(max[c], v.position[c]);
+
+      // Normalized shorts are decoded and encoded back losslessly
+      TEST_EQUAL(outPositionsNorm[i][c], v.positionNorm[c]);
+      minNorm[c] = std::min(minNorm[c], float(v.positionNorm[c]));
+      maxNorm[c] = std::max(maxNorm[c], float(v.positionNorm[c]));
+    }
+
+    const double normalLength = std::sqrt(
+        double(v.normal[0]) * v.normal[0] + double(v.normal[1]) * v.normal[1] +
+        double(v.normal[2]) * v.normal[2]);
+    const double normalFloatLength =
+        std::sqrt(double(v.normalFloat[0]) * v.normalFloat[0] +
+                  double(v.normalFloat[1]) * v.normalFloat[1] +
+                  double(v.normalFloat[2]) * v.normalFloat[2]);
+
+    for (size_t c = 0; c < 3; c++) {
+      const double normal = v.normal[c] / normalLength * 0x7fff;
+      TEST_LT(std::abs(outNormals16[i][c] - normal), 1.01);
+      const double normalFloat = v.normalFloat[c] / normalFloatLength;
+      TEST_LT(std::abs(outNormals32[i][c] - normalFloat), 1e-5);
+    }
+
+    TEST_EQUAL(outNormals16[i][3], int16(0x7fff + (v.normal[3] < 0)));
+
+    for (size_t c = 0; c < 2; c++) {
+      TEST_EQUAL(outUvs[i][c], v.uv[c] * 0x101);
+    }
+
+    for (size_t c = 0; c < 4; c++) {
+      TEST_EQUAL(outColors[i][c], uint8(v.color[c] * 0xff));
+    }
+  }
+
+  const gltf::Accessor &posAcc = main.accessors.at(positions);
+  const gltf::Accessor &posNormAcc = quantized.accessors.at(positionsNorm);
+
+  for (size_t c = 0; c < 3; c++) {
+    TEST_EQUAL(posAcc.min.at(c), min[c]);
+    TEST_EQUAL(posAcc.max.at(c), max[c]);
+    TEST_EQUAL(posNormAcc.min.at(c), minNorm[c]);
+    TEST_EQUAL(posNormAcc.max.at(c), maxNorm[c]);
+  }
+
+  return 0;
+}
+
+// Scalar restart strip conversion, restarts become degenerate triangles
+static std::vector<uint32> ReferenceStrip(std::span<const uint32> indices,
+                                          uint32 reset) {
+  std::vector<uint32> retVal{indices[0], indices[1]};
+  bool inverted = false;
+
+  for (size_t i = 2; i < indices.size() - 1; i++) {
+    if (indices[i] != reset) {
+      retVal.push_back(indices[i]);
+      inverted = !inverted;
+      continue;
+    }
+
+    retVal.push_back(indices[i - 1]);
+
+    while (i < indices.size() - 1 && indices[i + 1] == reset) {
+      i++;
+    }
+
+    // Strip ends with restarts
+    if (i >= indices.size() - 1) {
+      break;
+    }
+
+    if (inverted) {
+      retVal.push_back(indices[i + 1]);
+      inverted = false;
+    }
+
+    retVal.push_back(indices[i + 1]);
+  }
+
+  if (indices.back() != reset) {
+    retVal.push_back(indices.back());
+  }
+
+  return retVal;
+}
+
+template <class T>
+static int CompareIndices(std::span<const uint32> indices, bool asStrip) {
+  const uint32 reset = T(-1);
+  std::vector<T> input(indices.begin(), indices.end());
+  std::vector<uint32> reference(indices.begin(), indices.end());
+  const bool hasReset =
+      std::find(indices.begin(), indices.end(), reset) != indices.end();
+
+  if (asStrip && hasReset) {
+    reference = ReferenceStrip(indices, reset);
+  }
+
+  GLTFModel main;
+  const SavedIndices saved =
+      main.SaveIndices(input.data(), input.size(), sizeof(T));
+  const gltf::Accessor &acc = main.accessors.at(saved.accessorIndex);
+  std::vector<uint32> output;
+
+  if (acc.componentType == gltf::Accessor::ComponentType::UnsignedShort) {
+    auto read = ReadAccessor<uint16>(main, saved.accessorIndex);
+    output.assign(read.begin(), read.end());
+  } else {
+    TEST_EQUAL(sizeof(T), 4);
+    output = ReadAccessor<uint32>(main, saved.accessorIndex);
+  }
+
+  // 32 bit indices are narrowed whenever they fit without restarts
+  const bool fits16 = std::all_of(indices.begin(), indices.end(),
+                                  [](uint32 i) { return i < 0xffff; });
+  const bool as16bit =
+      acc.componentType == gltf::Accessor::ComponentType::UnsignedShort;
+  TEST_EQUAL(as16bit, (sizeof(T) < 4 || fits16));
+  TEST_CHECK((output == reference));
+  TEST_EQUAL(saved.minIndex,
+             *std::min_element(reference.begin(), reference.end()));
+  TEST_EQUAL(saved.maxIndex,
+             *std::max_element(reference.begin(), reference.end()));
+
+  return 0;
+}
+
+// Bulk index conversion must produce same output as scalar one
+int test_gltf_indices() {
+  std::mt19937 engine(11);
+  const size_t lengths[]{1, 2, 3, 7, 8, 9, 15, 16, 17, 31, 33, 1003};
+
+  for (size_t length : lengths) {
+    std::vector<uint32> indices(length);
+
+    // Triangle lists without restarts
+    for (auto &i : indices) {
+      i = engine() % 250;
+    }
+
+    TEST_EQUAL(CompareIndices<uint8>(indices, false), 0);
+    TEST_EQUAL(CompareIndices<uint16>(indices, false), 0);
+    TEST_EQUAL(CompareIndices<uint32>(indices, false), 0);
+
+    // Index over 16 bit range at any position keeps 32 bit indices
+    std::vector<uint32> wide(indices);
+    wide[engine() % length] = 0xffff + engine() % 2;
+    TEST_EQUAL(CompareIndices<uint32>(wide, false), 0);
+
+    for (auto &i : indices) {
+      i = engine() % 0xfff0;
+    }
+
+    TEST_EQUAL(CompareIndices<uint16>(indices, false), 0);
+    TEST_EQUAL(CompareIndices<uint32>(indices, false), 0);
+
+    if (length < 5) {
+      continue;
+    }
+
+    // Strips with restarts, repeated restarts and degenerate triangles
+    for (size_t s = 0; s < 4; s++) {
+      std::vector<uint32> strip(length);
+
+      for (size_t i = 0; i < length; i++) {
+        const uint32 roll = engine() % 8;
+        strip[i] = roll == 0 ? uint32(-1) : roll == 1 && i ? strip[i - 1]
+                                                            : engine() % 200;
+      }
+
+      // First 2 indices are never restarts, last one is for some strips
+      strip[0] = strip[0] == uint32(-1) ? 1 : strip[0];
+      strip[1] = strip[1] == uint32(-1) ? 2 : strip[1];
+      strip[2] = uint32(-1);
+
+      if (s & 1) {
+        strip.back() = uint32(-1);
+      }
+
+      auto AsWidth = [&](uint32 reset) {
+        std::vector<uint32> retVal(strip);
+        std::replace(retVal.begin(), retVal.end(), uint32(-1), reset);
+        return retVal;
+      };
+
+      TEST_EQUAL(CompareIndices<uint8>(AsWidth(0xff), true), 0);
+      TEST_EQUAL(CompareIndices<uint16>(AsWidth(0xffff), true), 0);
+      TEST_EQUAL(CompareIndices<uint32>(AsWidth(0xffffffff), true), 0);
+    }
+  }
+
+  return 0;
+}
+
+// Every triangle as positions of its vertices
+static std::vector<std::array<float, 9>> TrianglePositions(GLTFModel &main) {
+  std::vector<std::array<float, 9>> retVal;
+
+  for (auto &m : main.meshes) {
+    for (auto &p : m.primitives) {
+      auto positions =
+          ReadAccessor<std::array<float, 3>>(main, p.attributes.at("POSITION"));
+      auto indices = ReadAccessor<uint16>(main, p.indices);
+      std::vector<uint32> list(indices.begin(), indices.end());
+
+      if (p.mode == gltf::Primitive::Mode::TriangleStrip) {
+        list.clear();
+
+        for (size_t i = 0; i + 2 < indices.size(); i++) {
+          std::array<uint32, 3> tri{indices[i], indices[i + 1 + (i & 1)],
+                                    indices[i + 2 - (i & 1)]};
+
+          if (tri[0] != tri[1] && tri[1] != tri[2] && tri[0] != tri[2]) {
+            list.insert(list.end(), tri.begin(), tri.end());
+          }
+        }
+      }
+
+      for (size_t t = 0; t + 2 < list.size(); t += 3) {
+        std::array<float, 9> best{};
+
+        for (size_t r = 0; r < 3; r++) {
+          std::array<float, 9> item;
+
+          for (size_t v = 0; v < 3; v++) {
+            memcpy(item.data() + v * 3,
+                   positions.at(list[t + (v + r) % 3]).data(), 12);
+          }
+
+          if (!r || item < best) {
+            best = item;
+          }
+        }
+
+        retVal.push_back(best);
+      }
+    }
+  }
+
+  std::sort(retVal.begin(), retVal.end());
+
+  return retVal;
+}
+
+int test_gltf_optimize_meshes() {
+  GLTFModel main;
+
+  for (size_t i = 0; i < 4; i++) {
+    SavePrimitive(main, i * 3);
+  }
+
+  main.meshes.at(1).primitives.front().mode =
+      gltf::Primitive::Mode::TriangleStrip;
+
+  const auto reference = TrianglePositions(main);
+  const VertexCacheStats stats = main.OptimizeMeshes();
+
+  TEST_EQUAL(stats.numPrimitives, 4);
+  TEST_LT(stats.ACMRAfter(), stats.ACMRBefore());
+  TEST_EQUAL(main.meshes.at(1).primitives.front().mode,
+             gltf::Primitive::Mode::Triangles);
+  TEST_CHECK((TrianglePositions(main) == reference));
+  PrintInfo("Primitives ACMR: ", stats.ACMRBefore(), " -> ",
+            stats.ACMRAfter());
+
+  main.StripBuffers();
+  TEST_CHECK((TrianglePositions(main) == reference));
+
+  return 0;
+}
+
+// Min/max of stripped accessors are read from buffers split between chunks
+// and spilled into temporary file
+int test_gltf_strip_buffers() {
+  GLTFModel main;
+  main.streamMemoryBudget = GLTFStreamBuffer::CHUNK_SIZE;
+
+  for (size_t i = 0; i < 40; i++) {
+    SavePrimitive(main, i * 3);
+  }
+
+  using Vec3 = std::array<float, 3>;
+  std::map<size_t, std::vector<Vec3>> positions;
+
+  for (auto &mesh : main.meshes) {
+    const size_t accIndex = mesh.primitives.front().attributes.at("POSITION");
+    // Leaves unused data in buffer
+    main.accessors.at(accIndex).count -= accIndex % 5;
+    positions[accIndex] = ReadAccessor<Vec3>(main, accIndex);
+  }
+
+  TEST_LT(GLTFStreamBuffer::CHUNK_SIZE, main.GetVt12().str.str().size());
+  main.StripBuffers();
+
+  for (auto &[accIndex, reference] : positions) {
+    TEST_CHECK((ReadAccessor<Vec3>(main, accIndex) == reference));
+    const gltf::Accessor &acc = main.accessors.at(accIndex);
+    TEST_EQUAL(acc.min.size(), 3);
+    TEST_EQUAL(acc.max.size(), 3);
+
+    for (size_t c = 0; c < 3; c++) {
+      float min = FLT_MAX;
+      float max = -FLT_MAX;
+
+      for (auto &p : reference) {
+        min = std::min(min, p[c]);
+        max = std::max(max, p[c]);
+      }
+
+      TEST_EQUAL(acc.min[c], min);
+      TEST_EQUAL(acc.max[c], max);
+    }
+  }
+
+  return 0;
+}
+
+// Stripped fork is merged with its moved segments
+int test_gltf_strip_merge() {
+  GLTFModel main;
+  SavePrimitive(main, 0);
+  GLTFModel fork = main.Fork();
+  std::map<size_t, std::vector<std::array<float, 3>>> positions;
+
+  for (size_t i = 0; i < 6; i++) {
+    SavePrimitive(fork, i + 1);
+  }
+
+  for (auto &mesh : fork.meshes) {
+    const size_t accIndex = mesh.primitives.front().attributes.at("POSITION");
+    fork.accessors.at(accIndex).count /= 2;
+    positions[accIndex] = ReadAccessor<std::array<float, 3>>(fork, accIndex);
+  }
+
+  const size_t forkSize = fork.GetVt12().str.str().size();
+  fork.StripBuffers();
+  TEST_LT(fork.GetVt12().str.str().size(), forkSize);
+  fork.meshes.clear();
+  const size_t base = main.Merge(std::move(fork));
+
+  for (auto &[accIndex, reference] : positions) {
+    TEST_CHECK((ReadAccessor<std::array<float, 3>>(main, base + accIndex) ==
+                reference));
+  }
+
+  return 0;
+}
+
+// Stream can be read and patched everywhere, even in spilled chunks
+int test_gltf_stream_seek() {
+  constexpr size_t CHUNK_SIZE = GLTFStreamBuffer::CHUNK_SIZE;
+  GLTFStreamBuffer arena(CHUNK_SIZE);
+  GLTFStreamIO str(&arena);
+  std::string reference(CHUNK_SIZE * 4 + 100, 0);
+
+  for (size_t i = 0; i < reference.size(); i++) {
+    reference[i] = char(i * 7 + i / 251);
+  }
+
+  str.write(reference.data(), reference.size());
+  TEST_CHECK((str.str() == reference));
+
+  auto Patch = [&](size_t offset, std::string_view data) {
+    str.seekp(offset);
+    str.write(data.data(), data.size());
+    reference.replace(offset, data.size(), data);
+  };
+
+  // Spilled, across spilled and in memory chunk, in memory
+  Patch(10, "first patch");
+  Patch(CHUNK_SIZE * 3 - 5, "boundary patch");
+  Patch(CHUNK_SIZE * 4 + 20, "last");
+  TEST_CHECK(str.good());
+  TEST_EQUAL(str.tellp(), CHUNK_SIZE * 4 + 24);
+
+  std::string read(reference.size(), 0);
+  str.seekg(0);
+  str.read(read.data(), read.size());
+  TEST_CHECK(str.good());
+  TEST_CHECK((read == reference));
+
+  // Get area of spilled chunk must see later writes
+  str.seekg(5);
+  TEST_EQUAL(str.get(), uint8(reference[5]));
+  Patch(6, "x");
+  TEST_EQUAL(str.get(), 'x');
+  TEST_EQUAL(str.tellg(), 7);
+
+  // Appending continues from end
+  str.seekp(0, std::ios_base::end);
+  str.write("tail", 4);
+  reference.append("tail");
+  TEST_CHECK((str.str() == reference));
+
+  return 0;
+}
+
+static void WriteFile(const std::string &path, std::string_view data) {
+  std::ofstream str(path, std::ios::binary);
+  str.write(data.data(), data.size());
+}
+
+static std::string SaveDocument(const gltf::Document &doc) {
+  std::stringstream str;
+  gltf::Save(doc, str, "", true);
+  return std::move(str).str();
+}
+
+int test_gltf_load_mapped() {
+  const std::string path =
+      (std::filesystem::temp_directory_path() / "spike_test_gltf.glb")
+          .string();
+  std::string glb;
+
+  {
+    GLTFModel main;
+    SavePrimitive(main, 0);
+    SavePrimitive(main, 2);
+    glb = Export(main);
+  }
+
+  WriteFile(path, glb);
+
+  {
+    const gltf::Document loaded = gltf::LoadFromBinary(path);
+    const gltf::Document mapped = gltf::LoadFromBinaryMapped(path);
+    TEST_EQUAL(mapped.buffers.size(), loaded.buffers.size());
+    TEST_EQUAL(mapped.accessors.size(), loaded.accessors.size());
+    TEST_CHECK(mapped.buffers.front().data.empty());
+    TEST_CHECK(std::ranges::equal(mapped.buffers.front().GetData(),
+                                  loaded.buffers.front().GetData()));
+    TEST_CHECK((SaveDocument(mapped) == SaveDocument(loaded)));
+
+    // Mapped buffers are written back as they are
+    GLTFModel model(path);
+    TEST_CHECK(model.buffers.front().data.empty());
+    TEST_EQUAL(Export(model), glb);
+  }
+
+  auto ThrowsInvalid = [&](std::string_view data) {
+    WriteFile(path, data);
+
+    try {
+      gltf::LoadFromBinaryMapped(path);
+    } catch (const std::system_error &) {
+      return false;
+    } catch (const std::runtime_error &) {
+      return true;
+    }
+
+    return false;
+  };
+
+  const size_t jsonSize = *reinterpret_cast<const uint32 *>(glb.data() + 12);
+  const size_t truncated[]{0,  4,  12, 19, 20, 20 + jsonSize / 2,
+                           20 + jsonSize, 28 + jsonSize, glb.size() - 1};
+
+  for (size_t size : truncated) {
+    TEST_CHECK(ThrowsInvalid(std::string_view(glb).substr(0, size)));
+  }
+
+  std::string badMagic(glb);
+  badMagic[0] = 'x';
+  TEST_CHECK(ThrowsInvalid(badMagic));
+
+  std::string badChunk(glb);
+  badChunk[20 + jsonSize + 4] = 'x';
+  TEST_CHECK(ThrowsInvalid(badChunk));
+
+  std::filesystem::remove(path);
+
+  try {
+    gltf::LoadFromBinaryMapped(path);
+    TEST_CHECK(false);
+  } catch (const std::system_error &) {
+  }
+
+  return 0;
+}
+
+// Evaluates reduced keys the way glTF LINEAR sampler does
+static Vector4A16 Interpolate(const gltfutils::StripResult &keys,
+                              std::span<const float> times, float time,
+                              bool rotation) {
+  size_t k = 1;
+
+  while (k < keys.timeIndices.size() - 1 &&
+         times[keys.timeIndices[k]] < time) {
+    k++;
+  }
+
+  const float t0 = times[keys.timeIndices[k - 1]];
+  const float t1 = times[keys.timeIndices[k]];
+  const float t = (time - t0) / (t1 - t0);
+  const Vector4A16 a = keys.values[k - 1];
+  Vector4A16 b = keys.values[k];
+
+  if (!rotation) {
+    return a + (b - a) * t;
+  }
+
+  float dot = a.Dot(b);
+
+  if (dot < 0) {
+    b = -b;
+    dot = -dot;
+  }
+
+  const float theta = std::acos(std::min(dot, 1.f));
+
+  if (theta < 0.001f) {
+    return (a * (1 - t) + b * t).Normalize();
+  }
+
+  return (a * std::sin((1 - t) * theta) + b * std::sin(t * theta)) /
+         std::sin(theta);
+}
+
+// Rotation angle between quaternions, precise for small angles
+static float AngleBetween(Vector4A16 q0, Vector4A16 q1) {
+  if (q0.Dot(q1) < 0) {
+    q1 = -q1;
+  }
+
+  return 4 * std::asin((q0 - q1).Length() / 2);
+}
+
+static Vector4A16 RotationZ(float angle) {
+  return {0, 0, std::sin(angle / 2), std::cos(angle / 2)};
+}
+
+class CurveTrack : public uni::MotionTrack {
+public:
+  TrackType_e type;
+  TrackType_e TrackType() const override { return type; }
+  size_t BoneIndex() const override { return 0; }
+  void GetValue(Vector4A16 &output, float time) const override {
+    if (type == Rotation) {
+      output = RotationZ(time * time * 0.1f);
+    } else {
+      output = Vector4A16(std::sin(time), time, time < 1 ? time : 1, 0);
+    }
+  }
+};
+
+int test_gltf_keyframes_linear() {
+  std::vector<float> times = gltfutils::MakeSamples(60, 3);
+  std::vector<Vector4A16> values;
+
+  // 3 linear segments
+  for (float t : times) {
+    const float y = t < 1 ? t : t < 2 ? 1 + (t - 1) * 4 : 5 - (t - 2);
+    values.emplace_back(t * 2, y, -t, 1);
+  }
+
+  const auto keys = gltfutils::ReduceKeys(times, values, false);
+  TEST_EQUAL(keys.timeIndices.size(), 4);
+  TEST_EQUAL(keys.timeIndices[1], 60);
+  TEST_EQUAL(keys.timeIndices[2], 120);
+  TEST_EQUAL(keys.timeIndices.back(), times.size() - 1);
+
+  std::vector<Vector4A16> constant(times.size(), Vector4A16(1, 2, 3, 4));
+  TEST_EQUAL(gltfutils::ReduceKeys(times, constant, false).timeIndices.size(),
+             1);
+
+  return 0;
+}
+
+int test_gltf_keyframes_unaligned() {
+  // Constant check spans samples [1, 8), not a multiple of block size
+  std::vector<float> times{0, 1, 2, 3, 4, 5, 6, 7};
+  std::vector<Vector4A16> constant(times.size(), Vector4A16(1, 2, 3, 4));
+  TEST_EQUAL(gltfutils::ReduceKeys(times, constant, false).timeIndices.size(),
+             1);
+
+  // Odd length with single corner
+  times.push_back(8);
+  std::vector<Vector4A16> values;
+
+  for (float t : times) {
+    values.emplace_back(t, t < 3 ? t : 6 - t, 0, 0);
+  }
+
+  auto keys = gltfutils::ReduceKeys(times, values, false);
+  TEST_EQUAL(keys.timeIndices.size(), 3);
+  TEST_EQUAL(keys.timeIndices[1], 3);
+  TEST_EQUAL(keys.timeIndices[2], 8);
+
+  // Span that doesn't begin at start of allocation
+  std::span<const float> subTimes(times.data() + 1, 7);
+  std::span<const Vector4A16> subValues(values.data() + 1, 7);
+  keys = gltfutils::ReduceKeys(subTimes, subValues, false);
+  TEST_EQUAL(keys.timeIndices.size(), 3);
+  TEST_EQUAL(keys.timeIndices[1], 2);
+  TEST_EQUAL(keys.timeIndices[2], 6);
+
+  return 0;
+}
+
+int test_gltf_keyframes_rotation() {
+  std::vector<float> times = gltfutils::MakeSamples(60, 1.5f);
+  std::vector<Vector4A16> values;
+
+  // Constant angular velocity, slerp needs only end keys
+  for (float t : times) {
+    values.push_back(RotationZ(t * 2));
+  }
+
+  const gltfutils::KeyframeTolerance tolerance{0.0001f, 0.0005f};
+  TEST_EQUAL(gltfutils::ReduceKeys(times, values, true, tolerance)
+                 .timeIndices.size(),
+             2);
+
+  // Accelerating rotation with sign flips, error must stay within tolerance
+  for (size_t i = 0; i < times.size(); i++) {
+    values[i] = RotationZ(times[i] * times[i]) * (i % 3 ? 1 : -1);
+  }
+
+  const auto keys = gltfutils::ReduceKeys(times, values, true, tolerance);
+  TEST_LT(keys.timeIndices.size(), times.size());
+
+  for (size_t i = 0; i < times.size(); i++) {
+    const Vector4A16 value = Interpolate(keys, times, times[i], true);
+    TEST_LT(AngleBetween(value, values[i]), tolerance.angular * 1.01f);
+  }
+
+  return 0;
+}
+
+int test_gltf_keyframes_tracks() {
+  std::vector<float> times = gltfutils::MakeSamples(30, 4);
+  CurveTrack tracks[2];
+  tracks[0].type = uni::MotionTrack::Position;
+  tracks[1].type = uni::MotionTrack::Rotation;
+  const uni::MotionTrack *trackPtrs[]{tracks, tracks + 1};
+  const gltfutils::KeyframeTolerance tolerance{0.001f, 0.001f};
+
+  const auto results =
+      gltfutils::StripTracks(times, times.size(), trackPtrs, tolerance);
+  TEST_EQUAL(results.size(), 2);
+
+  for (size_t t = 0; t < 2; t++) {
+    const bool rotation = t == 1;
+    TEST_LT(results[t].timeIndices.size(), times.size());
+
+    for (float time : times) {
+      Vector4A16 reference;
+      tracks[t].GetValue(reference, time);
+      const Vector4A16 value =
+          Interpolate(results[t], times, time, rotation);
+
+      if (rotation) {
+        TEST_LT(AngleBetween(value, reference), tolerance.angular * 1.01f);
+      } else {
+        TEST_LT((value - reference).Length(), tolerance.linear * 1.01f);
+      }
+    }
+
+    PrintInfo("Track ", t, " keys: ", times.size(), " -> ",
+              results[t].timeIndices.size());
+  }
+
+  return 0;
+}
+
+int main() {
+  es::SetupWinApiConsole();
+  es::print::AddPrinterFunction(es::Print);
+
+  TEST_CASES(int testResult, TEST_FUNC(test_gltf_parallel),
+             TEST_FUNC(test_gltf_parallel_quantized),
+             TEST_FUNC(test_gltf_merge_views),
+             TEST_FUNC(test_gltf_vertex_cache),
+             TEST_FUNC(test_gltf_vertex_encode),
+             TEST_FUNC(test_gltf_indices),
+             TEST_FUNC(test_gltf_optimize_meshes),
+             TEST_FUNC(test_gltf_strip_buffers),
+             TEST_FUNC(test_gltf_strip_merge),
+             TEST_FUNC(test_gltf_stream_seek),
+             TEST_FUNC(test_gltf_load_mapped),
+             TEST_FUNC(test_gltf_keyframes_linear),
+             TEST_FUNC(test_gltf_keyframes_unaligned),
+             TEST_FUNC(test_gltf_keyframes_rotation),
+             TEST_FUNC(test_gltf_keyframes_tracks));
+
+  return testResult;
+}
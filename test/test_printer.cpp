@@ -0,0 +1,127 @@
+#include "spike/io/stat.hpp"
+#include "spike/util/unit_testing.hpp"
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <thread>
+#include <vector>
+
+static std::atomic_bool capturing;
+static std::vector<es::print::Queuer> captured;
+
+static void PrintFiltered(const char *str) {
+  if (!capturing) {
+    es::Print(str);
+  }
+}
+
+static void CaptureQueue(const es::print::Queuer &que) {
+  if (capturing) {
+    captured.push_back(que);
+  }
+}
+
+constexpr size_t NUM_THREADS = 8;
+constexpr size_t NUM_LINES = 20000;
+
+static double RunProducers() {
+  std::vector<std::thread> threads;
+  auto start = std::chrono::steady_clock::now();
+
+  for (size_t t = 0; t < NUM_THREADS; t++) {
+    threads.emplace_back([] {
+      for (size_t i = 0; i < NUM_LINES; i++) {
+        printline(i);
+      }
+    });
+  }
+
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  return (NUM_THREADS * NUM_LINES) / elapsed.count();
+}
+
+static int CheckCaptured() {
+  TEST_EQUAL(captured.size(), NUM_THREADS * NUM_LINES);
+  std::map<uint32, size_t> nextLine;
+
+  for (auto &c : captured) {
+    TEST_EQUAL(std::stoull(c.payload), nextLine[c.threadId]++);
+  }
+
+  TEST_EQUAL(nextLine.size(), NUM_THREADS);
+  captured.clear();
+
+  return 0;
+}
+
+int test_printer_sync() {
+  capturing = true;
+  const double callsPerSecond = RunProducers();
+  capturing = false;
+
+  PrintInfo("Sync drain: ", size_t(callsPerSecond), " calls/s");
+
+  return CheckCaptured();
+}
+
+int test_printer_async() {
+  std::atomic_bool stopDrain{false};
+  es::print::SetAsyncDrain(true);
+  capturing = true;
+
+  std::thread drainer([&] {
+    while (!stopDrain) {
+      es::print::DrainQueues();
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  });
+
+  const double callsPerSecond = RunProducers();
+  stopDrain = true;
+  drainer.join();
+  es::print::SetAsyncDrain(false);
+  capturing = false;
+
+  PrintInfo("Async drain: ", size_t(callsPerSecond), " calls/s");
+
+  return CheckCaptured();
+}
+
+int test_printer_throttled() {
+  es::print::SetThrottleInterval(200);
+  capturing = true;
+
+  for (size_t i = 0; i < 10; i++) {
+    printthrottled("Processing: " << i);
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(250));
+  printthrottled("Processing: last");
+  capturing = false;
+  es::print::SetThrottleInterval(0);
+
+  TEST_EQUAL(captured.size(), 2);
+  TEST_EQUAL(captured[0].payload, std::string("Processing: 0\n"));
+  TEST_EQUAL(captured[1].payload,
+             std::string("Processing: last (+9 skipped)\n"));
+  captured.clear();
+
+  return 0;
+}
+
+int main() {
+  es::SetupWinApiConsole();
+  es::print::AddPrinterFunction(PrintFiltered);
+  es::print::AddQueuer(CaptureQueue);
+
+  TEST_CASES(int testResult, TEST_FUNC(test_printer_sync),
+             TEST_FUNC(test_printer_async), TEST_FUNC(test_printer_throttled));
+
+  return testResult;
+}
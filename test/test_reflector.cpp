@@ -49,7 +49,10 @@ int main() {
       TEST_FUNC(test_custom_float, rClass),
       TEST_FUNC(test_reflector_bitfield_custom_float, rClass),
       TEST_FUNC(test_reflector_string, rClass), TEST_FUNC(test_reflector_alias),
-      TEST_FUNC(test_reflector_desc), TEST_FUNC(test_reflector_io, rClass),
+      TEST_FUNC(test_reflector_hash_tables), TEST_FUNC(test_reflector_desc),
+      TEST_FUNC(test_reflector_io, rClass),
+      TEST_FUNC(test_reflector_io_array, rClass),
+      TEST_FUNC(test_reflector_io_corrupt, rClass),
       TEST_FUNC(test_binwritter, rClass), TEST_FUNC(test_binreader, rClass));
 
   return testResult;
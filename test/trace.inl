@@ -0,0 +1,47 @@
+#include "spike/util/multi_thread.hpp"
+#include "spike/util/trace.hpp"
+#include "spike/util/unit_testing.hpp"
+#include <sstream>
+
+int test_trace() {
+  {
+    TRACE_ZONE("test_trace::disabled");
+  }
+
+  es::trace::Enable(true);
+
+  RunThreadedQueue(4, [](size_t) {
+    TRACE_ZONE("test_trace::outer");
+    TRACE_ZONE("test_trace::inner");
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  });
+
+  es::trace::Enable(false);
+
+  std::stringstream str;
+  es::trace::WriteChromeTrace(str);
+  std::string trace = str.str();
+
+  TEST_CHECK(trace.starts_with("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["));
+  TEST_CHECK(trace.ends_with("]}\n"));
+  TEST_EQUAL(trace.find("test_trace::disabled"), trace.npos);
+
+  auto Count = [&](std::string_view what) {
+    size_t count = 0;
+
+    for (size_t pos = trace.find(what); pos != trace.npos;
+         pos = trace.find(what, pos + 1)) {
+      count++;
+    }
+
+    return count;
+  };
+
+  TEST_EQUAL(Count("\"test_trace::outer\""), 4);
+  TEST_EQUAL(Count("\"test_trace::inner\""), 4);
+  TEST_EQUAL(Count("\"ph\":\"X\""), 8);
+
+  es::trace::PrintSummary();
+
+  return 0;
+}
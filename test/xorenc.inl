@@ -0,0 +1,50 @@
+#include "spike/crypto/xorenc.hpp"
+#include "spike/util/unit_testing.hpp"
+#include <sstream>
+#include <string>
+
+int test_xorenc() {
+  std::string source;
+
+  for (size_t i = 0; i < 1000; i++) {
+    source.push_back(char(i * 7 + (i >> 3)));
+  }
+
+  for (std::string_view key : {"k", "Sample Key", "0123456789abcdef",
+                               "A key longer than a single SSE register"}) {
+    XOREncoder enc;
+    enc.SetKey(key);
+
+    std::string reference = source;
+
+    for (size_t i = 0; i < reference.size(); i++) {
+      reference[i] ^= key[i % key.size()];
+    }
+
+    std::string encoded = source;
+    enc.Encode(encoded.data(), encoded.size());
+    TEST_CHECK((encoded == reference));
+
+    // Odd chunking must produce same result
+    encoded = source;
+
+    for (size_t offset = 0; offset < encoded.size();) {
+      const size_t chunk = std::min<size_t>(encoded.size() - offset, 77);
+      enc.Encode(encoded.data() + offset, chunk, offset);
+      offset += chunk;
+    }
+
+    TEST_CHECK((encoded == reference));
+
+    std::stringstream str(reference);
+    std::string decoded;
+    enc.Decode(BinReaderRef(str), reference.size(),
+               [&](const char *data, size_t size) {
+                 decoded.append(data, size);
+               });
+
+    TEST_CHECK((decoded == source));
+  }
+
+  return 0;
+}